@@ -14,15 +14,26 @@
 
 #include "bolson/bench.h"
 
+#include <arpa/inet.h>
 #include <blockingconcurrentqueue.h>
 #include <illex/arrow.h>
+#include <netinet/in.h>
 #include <putong/timer.h>
+#include <sys/socket.h>
+#include <unistd.h>
 
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <future>
 #include <iostream>
 #include <memory>
+#include <mutex>
+#include <string_view>
 #include <thread>
 
 #include "bolson/buffer/allocator.h"
+#include "bolson/client/client.h"
 #include "bolson/convert/converter.h"
 #include "bolson/convert/metrics.h"
 #include "bolson/parse/parser.h"
@@ -129,6 +140,15 @@ auto BenchConvert(const ConvertBenchOptions& opts) -> Status {
     buffer_seq_ranges.push_back(buf->range());
   }
 
+  // Parsers that modify the buffers need their contents restored when repeating.
+  auto ctx = converter->parser_context();
+  std::vector<std::vector<std::byte>> buffer_contents;
+  if (ctx->ModifiesBuffers() && (opts.repeats > 1)) {
+    for (const auto& buf : buffers) {
+      buffer_contents.emplace_back(buf->data(), buf->data() + buf->size());
+    }
+  }
+
   // Reserve a vector for latency measurements.
   LatencyMeasurements latencies;
   latencies.reserve(opts.repeats * buffers.size());
@@ -141,14 +161,20 @@ auto BenchConvert(const ConvertBenchOptions& opts) -> Status {
   // Start converter threads.
   std::atomic<bool> shutdown = false;
 
-  // Lock all buffers, so the threads don't start parsing until we unlock all buffers
-  // at the same time.
-  converter->parser_context()->LockBuffers();
+  // Take all buffers away from the converter threads, so they don't start parsing until
+  // we hand them over all at the same time.
+  const bool queued = converter->handoff() == parse::Handoff::QUEUE;
+  if (queued) {
+    ctx->ClaimBuffers();
+  } else {
+    ctx->LockBuffers();
+  }
 
   converter->Start(&shutdown);
   t_init.Stop();
 
-  spdlog::info("All threads spawned. Unlocking buffers and start converting...");
+  spdlog::info("All threads spawned. Handing over buffers ({}) and start converting...",
+               parse::ToString(converter->handoff()));
 
   t_conv.Start();
   // Repeat measurement.
@@ -158,14 +184,22 @@ auto BenchConvert(const ConvertBenchOptions& opts) -> Status {
     size_t num_messages_dequeued = 0;
 
     for (size_t b = 0; b < buffers.size(); b++) {
-      // Set the size/seq range of the buffer in case we repeat.
+      // Set the contents/size/seq range of the buffer in case we repeat.
+      if (!buffer_contents.empty()) {
+        std::memcpy(buffers[b]->mutable_data(), buffer_contents[b].data(),
+                    buffer_contents[b].size());
+      }
       buffers[b]->SetSize(buffer_sizes[b]);
       buffers[b]->SetRange(buffer_seq_ranges[b]);
       // Mark "receive time" point for buffer to be converted, just before we unlock.
       buffers[b]->SetRecvTime(illex::Timer::now());
     }
-    // Start conversion by unlocking the buffers.
-    converter->parser_context()->UnlockBuffers();
+    // Start conversion by handing over the buffers.
+    if (queued) {
+      ctx->PublishBuffers();
+    } else {
+      ctx->UnlockBuffers();
+    }
 
     // Pull JSON ipc items from the queue to check when we are done.
     while ((num_records_dequeued != o.num_jsons) && !shutdown.load()) {
@@ -177,18 +211,29 @@ auto BenchConvert(const ConvertBenchOptions& opts) -> Status {
         ipc_item.time_points[TimePoints::popped] = illex::Timer::now();
         // Update some metrics.
         num_records_dequeued += RecordSizeOf(ipc_item);
-        num_bytes_dequeued += ipc_item.message->size();
+        if (ipc_item.message != nullptr) {
+          num_bytes_dequeued += ipc_item.message->size();
+        }
         num_messages_dequeued++;
         latencies.emplace_back(
             LatencyMeasurement{ipc_item.seq_range, ipc_item.time_points});
       }
     }
-    converter->parser_context()->LockBuffers();
+    if (queued) {
+      ctx->ClaimBuffers();
+    } else {
+      ctx->LockBuffers();
+    }
     total_bytes_dequeued += num_bytes_dequeued;
     total_messages_dequeued += num_messages_dequeued;
     total_records_dequeued += num_records_dequeued;
   }
-  converter->parser_context()->UnlockBuffers();
+  if (queued) {
+    // Buffers are all empty now, so they just go back to the free queue.
+    ctx->PublishBuffers();
+  } else {
+    ctx->UnlockBuffers();
+  }
 
   t_conv.Stop();
 
@@ -270,8 +315,234 @@ auto BenchQueue(const QueueBenchOptions& opt) -> Status {
   return Status::OK();
 }
 
-auto BenchClient(const illex::ClientOptions& opt) -> Status {
-  return Status(Error::GenericError, "Not implemented.");
+/// \brief Open a listening socket for the loopback server.
+static auto Listen(uint16_t port, int* fd) -> Status {
+  *fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (*fd < 0) {
+    return Status(Error::IOError,
+                  "Unable to create socket: " + std::string(strerror(errno)));
+  }
+  int reuse = 1;
+  setsockopt(*fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+  sockaddr_in addr{};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if ((bind(*fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) ||
+      (listen(*fd, SOMAXCONN) != 0)) {
+    auto msg = std::string(strerror(errno));
+    close(*fd);
+    return Status(Error::IOError, "Unable to listen on port " + std::to_string(port) +
+                                      ": " + msg);
+  }
+  return Status::OK();
+}
+
+/// \brief Accept a connection, send all data, and close the connection.
+static auto Serve(int listen_fd, std::string_view data) -> Status {
+  int fd = accept(listen_fd, nullptr, nullptr);
+  if (fd < 0) {
+    return Status(Error::IOError, "Unable to accept: " + std::string(strerror(errno)));
+  }
+  while (!data.empty()) {
+    auto sent = send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+    if (sent < 0) {
+      if (errno == EINTR) continue;
+      auto msg = std::string(strerror(errno));
+      close(fd);
+      return Status(Error::IOError, "Unable to send: " + msg);
+    }
+    data.remove_prefix(sent);
+  }
+  close(fd);
+  return Status::OK();
+}
+
+/**
+ * \brief Drain filled buffers like converter threads would, without parsing.
+ * \param ctx       The parser context.
+ * \param handoff   The buffer handoff mechanism.
+ * \param num_jsons Number of JSONs to drain before returning.
+ * \param shutdown  Signal to stop draining early.
+ * \param fill      Time from receiving the oldest JSON of a buffer to draining it.
+ */
+static void Drain(parse::ParserContext* ctx, parse::Handoff handoff, size_t num_jsons,
+                  std::atomic<bool>* shutdown, std::vector<double>* fill) {
+  size_t drained = 0;
+  auto buffers = ctx->mutable_buffers();
+  auto mutexes = ctx->mutexes();
+  auto drain = [&](illex::JSONBuffer* buf) {
+    fill->push_back(
+        std::chrono::duration<double>(illex::Timer::now() - buf->recv_time()).count());
+    drained += buf->num_jsons();
+    buf->Reset();
+  };
+  while ((drained != num_jsons) && !shutdown->load()) {
+    if (handoff == parse::Handoff::QUEUE) {
+      illex::JSONBuffer* buf = nullptr;
+      if (ctx->ready_queue()->wait_dequeue_timed(
+              buf, std::chrono::microseconds(BOLSON_READY_QUEUE_WAIT_US))) {
+        drain(buf);
+        ctx->free_queue()->enqueue(buf);
+      }
+    } else {
+      for (size_t b = 0; b < buffers.size(); b++) {
+        if (mutexes[b]->try_lock()) {
+          if (!buffers[b]->empty()) {
+            drain(buffers[b]);
+          }
+          mutexes[b]->unlock();
+        }
+      }
+    }
+  }
+}
+
+/// Results of the client benchmark for a single buffer configuration.
+struct ClientBenchResult {
+  size_t num_buffers = 0;
+  size_t capacity = 0;
+  size_t bytes = 0;
+  size_t jsons = 0;
+  double seconds = 0.0;
+  /// Time from receiving the oldest JSON of a buffer to draining it, for all buffers.
+  std::vector<double> fill;
+};
+
+/// \brief Return the p-th quantile of sorted values.
+static auto Quantile(const std::vector<double>& sorted, double p) -> double {
+  if (sorted.empty()) return 0.0;
+  auto i = std::min(sorted.size() - 1, static_cast<size_t>(p * sorted.size()));
+  return sorted[i];
+}
+
+/// \brief Stream JSONs over loopback connections into a fresh set of buffers.
+static auto RunClientBench(const ClientBenchOptions& opt,
+                           const std::vector<std::string>& streams,
+                           ClientBenchResult* result) -> Status {
+  putong::Timer<> t_recv;
+
+  parse::ArrowOptions arrow = opt.arrow;
+  arrow.num_buffers = result->num_buffers;
+  arrow.buf_capacity = result->capacity;
+  std::shared_ptr<parse::ParserContext> ctx;
+  BOLSON_ROE(parse::ArrowParserContext::Make(arrow, 1, &ctx));
+
+  // Start the loopback server.
+  int listen_fd = -1;
+  BOLSON_ROE(Listen(opt.port, &listen_fd));
+  std::vector<std::future<Status>> servers;
+  for (const auto& stream : streams) {
+    servers.push_back(std::async(std::launch::async, Serve, listen_fd,
+                                 std::string_view(stream)));
+  }
+
+  // Start draining buffers.
+  std::atomic<bool> shutdown = false;
+  result->fill.reserve(opt.num_jsons);
+  auto drain =
+      std::thread(Drain, ctx.get(), opt.handoff, opt.num_jsons, &shutdown, &result->fill);
+
+  // Connect and receive.
+  client::Clients clients;
+  std::atomic<uint64_t> seq = 0;
+  illex::ClientOptions loopback;
+  loopback.host = "127.0.0.1";
+  loopback.port = opt.port;
+  std::vector<illex::ClientOptions> connections(opt.connections, loopback);
+  auto status = client::MakeClients(connections, opt.engine, opt.handoff,
+                                    std::chrono::microseconds(opt.max_buffer_delay_us),
+                                    ctx.get(), &seq, &clients);
+  if (status.ok()) {
+    t_recv.Start();
+    status = client::ReceiveJSONs(clients);
+    t_recv.Stop();
+  }
+
+  // Wait for all buffers to be drained, unless something went wrong.
+  if (!status.ok()) shutdown.store(true);
+  drain.join();
+  // Unblock servers that were never connected to.
+  ::shutdown(listen_fd, SHUT_RDWR);
+  close(listen_fd);
+  MultiThreadStatus server_status;
+  for (auto& s : servers) {
+    server_status.push_back(s.get());
+  }
+  BOLSON_ROE(status);
+  BOLSON_ROE(Aggregate(server_status, "Loopback server: "));
+
+  result->bytes = client::BytesReceived(clients);
+  result->jsons = client::JSONsReceived(clients);
+  result->seconds = t_recv.seconds();
+  std::sort(result->fill.begin(), result->fill.end());
+  return Status::OK();
+}
+
+auto BenchClient(const ClientBenchOptions& opt) -> Status {
+  putong::Timer<> t_gen;
+  auto o = opt;
+
+  spdlog::info("Receiving {} randomly generated JSONs over {} loopback connection(s)...",
+               o.num_jsons, o.connections);
+  BOLSON_ROE(o.arrow.ReadSchema());
+
+  // Generate JSONs and split them into one newline-delimited stream per connection.
+  t_gen.Start();
+  std::vector<illex::JSONItem> items;
+  auto gen_bytes = GenerateJSONs(o.num_jsons, *o.arrow.schema, o.generate, &items).first;
+  std::vector<std::string> streams(o.connections);
+  for (size_t i = 0; i < items.size(); i++) {
+    streams[i % o.connections] += items[i].string + "\n";
+  }
+  items.clear();
+  t_gen.Stop();
+
+  spdlog::info("JSON Generation:");
+  spdlog::info("  Bytes (no newlines) : {} B", gen_bytes);
+  spdlog::info("  Time                : {} s", t_gen.seconds());
+  spdlog::info("Client:");
+  spdlog::info("  Engine              : {}", ToString(o.engine));
+  spdlog::info("  Buffer handoff      : {}", ToString(o.handoff));
+  spdlog::info("  Connections         : {}", o.connections);
+  spdlog::info("  Max. buffer delay   : {} us", o.max_buffer_delay_us);
+
+  // Run all combinations of buffer counts and capacities.
+  auto capacities =
+      o.capacities.empty() ? std::vector{o.arrow.buf_capacity} : o.capacities;
+  std::vector<ClientBenchResult> results;
+  for (auto num_buffers : o.buffers) {
+    for (auto capacity : capacities) {
+      ClientBenchResult r;
+      r.num_buffers = num_buffers;
+      r.capacity = capacity;
+      BOLSON_ROE(RunClientBench(o, streams, &r));
+      spdlog::info("  {} x {} B buffers: {} MB/s, {} MJ/s, fill p99 {} s", num_buffers,
+                   capacity, static_cast<double>(r.bytes) / r.seconds * 1e-6,
+                   static_cast<double>(r.jsons) / r.seconds * 1e-6,
+                   Quantile(r.fill, 0.99));
+      results.push_back(std::move(r));
+    }
+  }
+
+  std::cout << "Buffers,Capacity,Bytes,JSONs,Time,MB/s,MJ/s,"
+               "Fill mean,Fill p50,Fill p99,Fill max"
+            << std::endl;
+  for (const auto& r : results) {
+    double fill_sum = 0.0;
+    for (auto f : r.fill) fill_sum += f;
+    auto fill_mean = r.fill.empty() ? 0.0 : fill_sum / r.fill.size();
+    std::cout << r.num_buffers << "," << r.capacity << "," << r.bytes << "," << r.jsons
+              << ",";
+    std::cout << std::setprecision(9) << std::fixed << r.seconds << ","
+              << static_cast<double>(r.bytes) / r.seconds * 1e-6 << ","
+              << static_cast<double>(r.jsons) / r.seconds * 1e-6 << "," << fill_mean
+              << "," << Quantile(r.fill, 0.5) << "," << Quantile(r.fill, 0.99) << ","
+              << (r.fill.empty() ? 0.0 : r.fill.back());
+    std::cout << std::endl;
+  }
+
+  return Status::OK();
 }
 
 auto RunBench(const BenchOptions& opt) -> Status {
@@ -284,6 +555,8 @@ auto RunBench(const BenchOptions& opt) -> Status {
       return BenchPulsar(opt.pulsar);
     case Bench::QUEUE:
       return BenchQueue(opt.queue);
+    case Bench::MMIO:
+      return parse::opae::BenchMMIO(opt.mmio);
   }
   return Status::OK();
 }
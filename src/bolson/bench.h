@@ -20,8 +20,11 @@
 #include <illex/protocol.h>
 #include <putong/timer.h>
 
+#include "bolson/client/client.h"
 #include "bolson/convert/converter.h"
 #include "bolson/parse/arrow.h"
+#include "bolson/parse/opae/bench.h"
+#include "bolson/parse/opae/opae.h"
 #include "bolson/parse/parser.h"
 #include "bolson/publish/bench.h"
 #include "bolson/publish/publisher.h"
@@ -46,6 +49,30 @@ struct ConvertBenchOptions {
   size_t repeats = 1;
 };
 
+/// Options for the client benchmark.
+struct ClientBenchOptions {
+  /// JSON generator options
+  illex::GenerateOptions generate;
+  /// Number of JSONs to send through the loopback connection(s).
+  size_t num_jsons = 1024 * 1024;
+  /// Options for the Arrow parser context providing the input buffers.
+  parse::ArrowOptions arrow;
+  /// Numbers of input buffers to benchmark.
+  std::vector<size_t> buffers = {16};
+  /// Input buffer capacities to benchmark. If empty, use the Arrow buffer capacity.
+  std::vector<size_t> capacities;
+  /// Number of loopback connections.
+  size_t connections = 1;
+  /// The receive engine.
+  client::Engine engine = client::Engine::POSIX;
+  /// The buffer handoff mechanism.
+  parse::Handoff handoff = parse::Handoff::QUEUE;
+  /// Maximum time in microseconds the oldest JSON in a buffer waits to be handed over.
+  size_t max_buffer_delay_us = 0;
+  /// Port of the loopback server.
+  uint16_t port = ILLEX_DEFAULT_PORT;
+};
+
 /// Options for queue benchmark
 struct QueueBenchOptions {
   /// Number of items to queue.
@@ -61,7 +88,9 @@ enum class Bench {
   /// Benchmark the Pulsar interface
   PULSAR,
   /// Benchmark for queues.
-  QUEUE
+  QUEUE,
+  /// Benchmark for contention on OPAE MMIO registers.
+  MMIO
 };
 
 /// Benchmark subcommand options
@@ -69,13 +98,15 @@ struct BenchOptions {
   /// Chosen subcommand
   Bench bench = Bench::CONVERT;
   /// Options for client bench
-  illex::ClientOptions client;
+  ClientBenchOptions client;
   /// Options for convert bench
   ConvertBenchOptions convert;
   /// Options for Pulsar bench
   publish::BenchOptions pulsar;
   /// Options for Queue bench
   QueueBenchOptions queue;
+  /// Options for MMIO bench
+  parse::opae::BenchOptions mmio;
 };
 
 /**
@@ -88,8 +119,8 @@ struct BenchOptions {
  */
 auto RunBench(const BenchOptions& opt) -> Status;
 
-/// \brief Run the TCP client benchmark.
-auto BenchClient(const illex::ClientOptions& opt) -> Status;
+/// \brief Run the TCP client benchmark against a loopback server.
+auto BenchClient(const ClientBenchOptions& opt) -> Status;
 
 /// \brief Run the JSON-to-Arrow conversion benchmark.
 auto BenchConvert(const ConvertBenchOptions& opts) -> Status;
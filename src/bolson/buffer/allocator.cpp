@@ -14,6 +14,9 @@
 
 #include "bolson/buffer/allocator.h"
 
+#include <unistd.h>
+
+#include <cstdlib>
 #include <memory>
 
 #include "bolson/status.h"
@@ -34,4 +37,16 @@ auto Allocator::Free(std::byte* buffer) -> Status {
   return Status::OK();
 }
 
+auto PageAlignedAllocator::Allocate(size_t size, std::byte** out) -> Status {
+  const auto page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  size = (size + page - 1) & ~(page - 1);
+  void* result = nullptr;
+  if (posix_memalign(&result, page, size) != 0) {
+    return Status(Error::GenericError,
+                  "Unable to allocate " + std::to_string(size) + " page-aligned bytes.");
+  }
+  *out = static_cast<std::byte*>(result);
+  return Status::OK();
+}
+
 }  // namespace bolson::buffer
\ No newline at end of file
@@ -50,4 +50,15 @@ class Allocator {
   virtual auto Free(std::byte* buffer) -> Status;
 };
 
+/**
+ * \brief Allocator of buffers occupying whole pages.
+ *
+ * Buffers start at a page boundary and their size is rounded up to whole pages, so the
+ * pages of a buffer can be moved, e.g. to another NUMA node, without moving other memory.
+ */
+class PageAlignedAllocator : public Allocator {
+ public:
+  auto Allocate(size_t size, std::byte** out) -> Status override;
+};
+
 }  // namespace bolson::buffer
\ No newline at end of file
@@ -0,0 +1,159 @@
+// Copyright 2020 Teratide B.V.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "bolson/buffer/huge_page_allocator.h"
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <map>
+
+#include "bolson/log.h"
+
+// Not all C libraries expose the huge page size flags of mmap.
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT 26
+#endif
+
+namespace bolson::buffer {
+
+auto ToString(PageSize page_size) -> std::string {
+  switch (page_size) {
+    case PageSize::DEFAULT:
+      return "default";
+    case PageSize::HUGE_2M:
+      return "2M";
+    case PageSize::HUGE_1G:
+      return "1G";
+  }
+  return "Corrupt bolson::buffer::PageSize enum value.";
+}
+
+void AddPageSizeOptionToCLI(CLI::App* sub, const std::string& name, PageSize* out) {
+  sub->add_option(name, *out,
+                  "Page size backing the input buffers. \"2M\" and \"1G\" use "
+                  "pre-faulted huge pages, falling back to pre-faulted regular pages if "
+                  "none are available.")
+      ->transform(CLI::CheckedTransformer(
+          std::map<std::string, PageSize>{{"default", PageSize::DEFAULT},
+                                          {"2M", PageSize::HUGE_2M},
+                                          {"1G", PageSize::HUGE_1G}},
+          CLI::ignore_case))
+      ->default_val(PageSize::DEFAULT);
+}
+
+/// \brief Return the number of bytes in a page of some size, as a power of two.
+static auto PageBits(PageSize page_size) -> unsigned int {
+  switch (page_size) {
+    case PageSize::HUGE_2M:
+      return 21;
+    case PageSize::HUGE_1G:
+      return 30;
+    default:
+      return 12;
+  }
+}
+
+/// \brief Round a size up to a multiple of a power-of-two page size.
+static auto RoundUp(size_t size, size_t page) -> size_t {
+  return (size + page - 1) & ~(page - 1);
+}
+
+/// \brief Fault in all pages of a mapping by writing to them.
+static void PreFault(void* addr, size_t size) {
+#ifdef MADV_POPULATE_WRITE
+  if (madvise(addr, size, MADV_POPULATE_WRITE) == 0) return;
+#endif
+  // Kernels before 5.14 don't support populating on advice, so touch every page.
+  const auto page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  auto* bytes = static_cast<volatile std::byte*>(addr);
+  for (size_t offset = 0; offset < size; offset += page) {
+    bytes[offset] = std::byte{0};
+  }
+}
+
+auto HugePageAllocator::Allocate(size_t size, std::byte** out) -> Status {
+  // Round up to whole pages.
+  const size_t page = size_t(1) << PageBits(page_size_);
+  const size_t huge_size = RoundUp(size, page);
+  if ((huge_size / 2 >= size) && !warned_.exchange(true)) {
+    spdlog::warn("Buffers of {} bytes backed by {} huge pages waste {} bytes each.", size,
+                 ToString(page_size_), huge_size - size);
+  }
+
+  // Map and fault in the huge pages.
+  size_t mapped_size = huge_size;
+  void* addr = mmap(nullptr, mapped_size, (PROT_READ | PROT_WRITE),
+                    (MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE | MAP_HUGETLB |
+                     (PageBits(page_size_) << MAP_HUGE_SHIFT)),
+                    -1, 0);
+  if (addr == MAP_FAILED) {
+    spdlog::warn("Unable to map {} bytes of {} huge pages: {}. Using regular pages.",
+                 mapped_size, ToString(page_size_), std::strerror(errno));
+    // Only round up to transparent huge pages if the buffer can hold one, rather than to
+    // the requested huge page size, which would fault in up to a GiB of regular pages.
+    const size_t thp = size_t(1) << PageBits(PageSize::HUGE_2M);
+    mapped_size =
+        RoundUp(size, size >= thp ? thp : static_cast<size_t>(sysconf(_SC_PAGESIZE)));
+    // Don't populate the mapping yet, so the pages faulted in below may be transparent
+    // huge pages.
+    addr = mmap(nullptr, mapped_size, (PROT_READ | PROT_WRITE),
+                (MAP_PRIVATE | MAP_ANONYMOUS), -1, 0);
+    if (addr == MAP_FAILED) {
+      return Status(Error::GenericError,
+                    "HugePageAllocator unable to allocate " +
+                        std::to_string(mapped_size) + " bytes. Errno: " +
+                        std::to_string(errno) + " : " + std::strerror(errno));
+    }
+    // Transparent huge pages are best effort, so failure is not an error.
+    madvise(addr, mapped_size, MADV_HUGEPAGE);
+    PreFault(addr, mapped_size);
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  allocations_[addr] = mapped_size;
+  *out = static_cast<std::byte*>(addr);
+  return Status::OK();
+}
+
+auto HugePageAllocator::Free(std::byte* buffer) -> Status {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto allocation = allocations_.find(buffer);
+  if (allocation == allocations_.end()) {
+    return Status(Error::GenericError,
+                  "HugePageAllocator asked to free memory it did not allocate.");
+  }
+  if (munmap(allocation->first, allocation->second) != 0) {
+    return Status(Error::GenericError,
+                  "HugePageAllocator unable to unmap buffer. Errno: " +
+                      std::to_string(errno) + " : " + std::strerror(errno));
+  }
+  allocations_.erase(allocation);
+  return Status::OK();
+}
+
+auto MakeHostAllocator(PageSize page_size, bool page_aligned)
+    -> std::shared_ptr<Allocator> {
+  if (page_size != PageSize::DEFAULT) {
+    return std::make_shared<HugePageAllocator>(page_size);
+  }
+  if (page_aligned) {
+    return std::make_shared<PageAlignedAllocator>();
+  }
+  return std::make_shared<Allocator>();
+}
+
+}  // namespace bolson::buffer
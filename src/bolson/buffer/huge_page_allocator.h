@@ -0,0 +1,73 @@
+// Copyright 2020 Teratide B.V.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#pragma once
+
+#include <CLI/CLI.hpp>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "bolson/buffer/allocator.h"
+
+namespace bolson::buffer {
+
+/// Page sizes to back input buffers with.
+enum class PageSize {
+  DEFAULT,   ///< Regular pages, allocated through malloc.
+  HUGE_2M,   ///< 2 MiB huge pages.
+  HUGE_1G    ///< 1 GiB huge pages.
+};
+
+/// \brief Return human-readable PageSize enum.
+auto ToString(PageSize page_size) -> std::string;
+
+/// \brief Add an option to select the page size to the CLI.
+void AddPageSizeOptionToCLI(CLI::App* sub, const std::string& name, PageSize* out);
+
+/**
+ * \brief Memory allocator backing buffers with pre-faulted huge pages.
+ *
+ * Allocation sizes are rounded up to whole pages. All pages are faulted in on
+ * allocation, so the first writes to a buffer don't cause page faults. If no huge pages
+ * of the requested size are available, this falls back to pre-faulted regular pages,
+ * advising the kernel to back them with transparent huge pages. The fallback rounds sizes
+ * up to regular pages, or to 2 MiB for buffers that can hold a transparent huge page.
+ */
+class HugePageAllocator : public Allocator {
+ public:
+  explicit HugePageAllocator(PageSize page_size) : page_size_(page_size) {}
+  auto Allocate(size_t size, std::byte** out) -> Status override;
+  auto Free(std::byte* buffer) -> Status override;
+
+ private:
+  PageSize page_size_;
+  std::atomic<bool> warned_ = false;
+  std::mutex mutex_;
+  std::unordered_map<void*, size_t> allocations_;
+};
+
+/**
+ * \brief Return an allocator for input buffers in host memory with some page size.
+ * \param page_size    The page size backing the buffers.
+ * \param page_aligned Whether buffers must occupy whole pages with the default page size.
+ * \return The allocator.
+ */
+auto MakeHostAllocator(PageSize page_size, bool page_aligned = false)
+    -> std::shared_ptr<Allocator>;
+
+}  // namespace bolson::buffer
@@ -0,0 +1,207 @@
+// Copyright 2020 Teratide B.V.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "bolson/buffer/memory_pool.h"
+
+#include <arrow/api.h>
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+
+namespace bolson::buffer {
+
+auto ToString(PoolBackend backend) -> std::string {
+  switch (backend) {
+    case PoolBackend::DEFAULT:
+      return "default";
+    case PoolBackend::SYSTEM:
+      return "system";
+    case PoolBackend::JEMALLOC:
+      return "jemalloc";
+    case PoolBackend::MIMALLOC:
+      return "mimalloc";
+  }
+  return "Corrupt bolson::buffer::PoolBackend enum value.";
+}
+
+void AddMemoryPoolOptionsToCLI(CLI::App* sub, MemoryPoolOptions* out) {
+  sub->add_option("--pool", out->backend,
+                  "Allocator backing the memory pool of every converter thread. "
+                  "\"jemalloc\" and \"mimalloc\" require Arrow to be built with them.")
+      ->transform(CLI::CheckedTransformer(
+          std::map<std::string, PoolBackend>{{"default", PoolBackend::DEFAULT},
+                                             {"system", PoolBackend::SYSTEM},
+                                             {"jemalloc", PoolBackend::JEMALLOC},
+                                             {"mimalloc", PoolBackend::MIMALLOC}},
+          CLI::ignore_case))
+      ->default_val(PoolBackend::DEFAULT);
+  sub->add_option("--pool-cache", out->cache_entries,
+                  "Number of freed allocations per power-of-two size class that every "
+                  "converter thread memory pool keeps for reuse. 0 disables the cache.")
+      ->default_val(0);
+}
+
+auto MemoryPoolMetrics::operator+=(const MemoryPoolMetrics& r) -> MemoryPoolMetrics& {
+  bytes_allocated += r.bytes_allocated;
+  peak_bytes += r.peak_bytes;
+  num_allocations += r.num_allocations;
+  cache_hits += r.cache_hits;
+  return *this;
+}
+
+// Buffers allocated from a pool may outlive whoever requested the pool, so pools are
+// owned by this registry until they are released and no longer in use.
+static std::mutex pools_mutex;
+static std::vector<std::unique_ptr<ThreadMemoryPool>> pools;
+
+auto ThreadMemoryPool::Make(const MemoryPoolOptions& opts, ThreadMemoryPool** out)
+    -> Status {
+  arrow::MemoryPool* backend = nullptr;
+  switch (opts.backend) {
+    case PoolBackend::DEFAULT:
+      backend = arrow::default_memory_pool();
+      break;
+    case PoolBackend::SYSTEM:
+      backend = arrow::system_memory_pool();
+      break;
+    case PoolBackend::JEMALLOC:
+      ARROW_ROE(arrow::jemalloc_memory_pool(&backend));
+      break;
+    case PoolBackend::MIMALLOC:
+      ARROW_ROE(arrow::mimalloc_memory_pool(&backend));
+      break;
+  }
+
+  std::lock_guard<std::mutex> lock(pools_mutex);
+  pools.emplace_back(new ThreadMemoryPool(backend, opts.cache_entries));
+  *out = pools.back().get();
+  return Status::OK();
+}
+
+void ThreadMemoryPool::Release(ThreadMemoryPool* pool) {
+  std::lock_guard<std::mutex> lock(pools_mutex);
+  if (pool != nullptr) {
+    pool->released_ = true;
+  }
+  pools.erase(std::remove_if(pools.begin(), pools.end(),
+                             [](const std::unique_ptr<ThreadMemoryPool>& p) {
+                               return p->released_ && (p->bytes_allocated() == 0);
+                             }),
+              pools.end());
+}
+
+ThreadMemoryPool::~ThreadMemoryPool() {
+  for (size_t c = 0; c < kNumClasses; c++) {
+    for (auto* buffer : cache_[c]) {
+      backend_->Free(buffer, ClassSize(c));
+    }
+  }
+}
+
+auto ThreadMemoryPool::SizeClass(int64_t size) const -> size_t {
+  if ((cache_entries_ == 0) || (size > ClassSize(kNumClasses - 1))) {
+    return kNumClasses;
+  }
+  size_t bits = BOLSON_POOL_MIN_CLASS;
+  while ((int64_t(1) << bits) < size) bits++;
+  return bits - BOLSON_POOL_MIN_CLASS;
+}
+
+void ThreadMemoryPool::Track(int64_t diff) {
+  auto current = bytes_allocated_.fetch_add(diff) + diff;
+  auto peak = peak_bytes_.load();
+  while ((current > peak) && !peak_bytes_.compare_exchange_weak(peak, current)) {
+  }
+}
+
+auto ThreadMemoryPool::Allocate(int64_t size, uint8_t** out) -> arrow::Status {
+  auto c = SizeClass(size);
+  if (c == kNumClasses) {
+    ARROW_RETURN_NOT_OK(backend_->Allocate(size, out));
+  } else {
+    uint8_t* cached = nullptr;
+    {
+      std::lock_guard<std::mutex> lock(cache_mutex_);
+      if (!cache_[c].empty()) {
+        cached = cache_[c].back();
+        cache_[c].pop_back();
+      }
+    }
+    if (cached != nullptr) {
+      cache_hits_++;
+      *out = cached;
+    } else {
+      ARROW_RETURN_NOT_OK(backend_->Allocate(ClassSize(c), out));
+    }
+  }
+  num_allocations_++;
+  Track(size);
+  return arrow::Status::OK();
+}
+
+auto ThreadMemoryPool::Reallocate(int64_t old_size, int64_t new_size, uint8_t** ptr)
+    -> arrow::Status {
+  auto old_class = SizeClass(old_size);
+  auto new_class = SizeClass(new_size);
+  if ((old_class == kNumClasses) && (new_class == kNumClasses)) {
+    ARROW_RETURN_NOT_OK(backend_->Reallocate(old_size, new_size, ptr));
+  } else if (old_class != new_class) {
+    // Move between size classes, or between cached and uncached allocations.
+    uint8_t* moved = nullptr;
+    ARROW_RETURN_NOT_OK(Allocate(new_size, &moved));
+    std::memcpy(moved, *ptr, static_cast<size_t>(std::min(old_size, new_size)));
+    Free(*ptr, old_size);
+    *ptr = moved;
+    return arrow::Status::OK();
+  }
+  // Within the same size class, the allocation already fits.
+  Track(new_size - old_size);
+  return arrow::Status::OK();
+}
+
+void ThreadMemoryPool::Free(uint8_t* buffer, int64_t size) {
+  auto c = SizeClass(size);
+  Track(-size);
+  if (c != kNumClasses) {
+    std::lock_guard<std::mutex> lock(cache_mutex_);
+    if (cache_[c].size() < cache_entries_) {
+      cache_[c].push_back(buffer);
+      return;
+    }
+  }
+  backend_->Free(buffer, c == kNumClasses ? size : ClassSize(c));
+}
+
+auto ThreadMemoryPool::bytes_allocated() const -> int64_t {
+  return bytes_allocated_.load();
+}
+
+auto ThreadMemoryPool::max_memory() const -> int64_t { return peak_bytes_.load(); }
+
+auto ThreadMemoryPool::backend_name() const -> std::string {
+  return backend_->backend_name();
+}
+
+auto ThreadMemoryPool::metrics() const -> MemoryPoolMetrics {
+  MemoryPoolMetrics result;
+  result.bytes_allocated = bytes_allocated_.load();
+  result.peak_bytes = peak_bytes_.load();
+  result.num_allocations = num_allocations_.load();
+  result.cache_hits = cache_hits_.load();
+  return result;
+}
+
+}  // namespace bolson::buffer
@@ -0,0 +1,151 @@
+// Copyright 2020 Teratide B.V.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#pragma once
+
+#include <arrow/memory_pool.h>
+
+#include <CLI/CLI.hpp>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "bolson/status.h"
+
+/// Smallest allocation size class of the memory pool cache, as a power of two.
+#define BOLSON_POOL_MIN_CLASS 6
+/// Largest allocation size class of the memory pool cache, as a power of two.
+#define BOLSON_POOL_MAX_CLASS 22
+
+namespace bolson::buffer {
+
+/// Allocators backing converter thread memory pools.
+enum class PoolBackend {
+  DEFAULT,   ///< Arrow's default memory pool.
+  SYSTEM,    ///< The system allocator.
+  JEMALLOC,  ///< jemalloc, if Arrow was built with it.
+  MIMALLOC   ///< mimalloc, if Arrow was built with it.
+};
+
+/// \brief Return human-readable PoolBackend enum.
+auto ToString(PoolBackend backend) -> std::string;
+
+/// Options for converter thread memory pools.
+struct MemoryPoolOptions {
+  /// The allocator backing the pool.
+  PoolBackend backend = PoolBackend::DEFAULT;
+  /// Number of freed allocations to keep per size class for reuse, 0 = no cache.
+  size_t cache_entries = 0;
+};
+
+/// \brief Options exposed to CLI.
+void AddMemoryPoolOptionsToCLI(CLI::App* sub, MemoryPoolOptions* out);
+
+/// Statistics of a memory pool.
+struct MemoryPoolMetrics {
+  /// Number of bytes allocated when the metrics were obtained.
+  int64_t bytes_allocated = 0;
+  /// Peak number of bytes allocated.
+  int64_t peak_bytes = 0;
+  /// Number of allocations.
+  uint64_t num_allocations = 0;
+  /// Number of allocations served from the size-class cache.
+  uint64_t cache_hits = 0;
+
+  auto operator+=(const MemoryPoolMetrics& r) -> MemoryPoolMetrics&;
+};
+
+/**
+ * \brief Arrow memory pool for a single converter thread.
+ *
+ * Forwards to a backend allocator, counting allocations so allocator pressure can be
+ * attributed to converter threads. Optionally rounds allocations up to power-of-two size
+ * classes and keeps freed allocations to serve later ones, bypassing the backend.
+ *
+ * Buffers allocated from the pool may be freed by other threads, e.g. when IPC messages
+ * are published, so all operations are thread-safe.
+ */
+class ThreadMemoryPool : public arrow::MemoryPool {
+ public:
+  /**
+   * \brief Make a new memory pool.
+   *
+   * Arrow buffers do not own their pool, and may outlive the converter that allocated
+   * them. Pools are therefore kept alive until they are released through Release() and
+   * all their allocations are freed.
+   *
+   * \param opts The memory pool options.
+   * \param out  The resulting memory pool.
+   * \return Status::OK() if successful, some error otherwise.
+   */
+  static auto Make(const MemoryPoolOptions& opts, ThreadMemoryPool** out) -> Status;
+
+  /**
+   * \brief Release a memory pool obtained through Make().
+   *
+   * The pool is destroyed as soon as all its allocations are freed. Released pools that
+   * still have allocations outstanding are destroyed by a later call to this function.
+   *
+   * \param pool The memory pool to release.
+   */
+  static void Release(ThreadMemoryPool* pool);
+
+  ~ThreadMemoryPool() override;
+
+  auto Allocate(int64_t size, uint8_t** out) -> arrow::Status override;
+  auto Reallocate(int64_t old_size, int64_t new_size, uint8_t** ptr)
+      -> arrow::Status override;
+  void Free(uint8_t* buffer, int64_t size) override;
+
+  [[nodiscard]] auto bytes_allocated() const -> int64_t override;
+  [[nodiscard]] auto max_memory() const -> int64_t override;
+  [[nodiscard]] auto backend_name() const -> std::string override;
+
+  /// \brief Return the statistics of this pool.
+  [[nodiscard]] auto metrics() const -> MemoryPoolMetrics;
+
+ private:
+  static constexpr size_t kNumClasses = BOLSON_POOL_MAX_CLASS - BOLSON_POOL_MIN_CLASS + 1;
+
+  ThreadMemoryPool(arrow::MemoryPool* backend, size_t cache_entries)
+      : backend_(backend), cache_entries_(cache_entries) {}
+
+  /// \brief Return the number of bytes allocated for a size class.
+  static auto ClassSize(size_t c) -> int64_t {
+    return int64_t(1) << (c + BOLSON_POOL_MIN_CLASS);
+  }
+
+  /// \brief Return the size class of an allocation, or kNumClasses if not cached.
+  [[nodiscard]] auto SizeClass(int64_t size) const -> size_t;
+
+  /// \brief Account for a change in allocated bytes.
+  void Track(int64_t diff);
+
+  arrow::MemoryPool* backend_;
+  size_t cache_entries_;
+  std::atomic<int64_t> bytes_allocated_ = 0;
+  std::atomic<int64_t> peak_bytes_ = 0;
+  std::atomic<uint64_t> num_allocations_ = 0;
+  std::atomic<uint64_t> cache_hits_ = 0;
+  bool released_ = false;
+  std::mutex cache_mutex_;
+  std::array<std::vector<uint8_t*>, kNumClasses> cache_;
+};
+
+}  // namespace bolson::buffer
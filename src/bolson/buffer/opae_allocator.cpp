@@ -31,6 +31,20 @@ auto OpaeAllocator::Allocate(size_t size, std::byte** out) -> Status {
   }
   size = fixed_capacity_;
 
+  if (!huge_pages_) {
+    // Anonymous mappings are zeroed, and only pages that are touched get backed.
+    void* addr = mmap(nullptr, size, (PROT_READ | PROT_WRITE),
+                      (MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE), -1, 0);
+    if (addr == MAP_FAILED) {
+      return Status(Error::OpaeError,
+                    "OpaeAllocator unable to allocate buffer. Errno: " +
+                        std::to_string(errno) + " : " + std::strerror(errno));
+    }
+    allocations[addr] = size;
+    *out = static_cast<std::byte*>(addr);
+    return Status::OK();
+  }
+
   // TODO(mbrobbel): explain this
   void* addr = mmap(nullptr, size, (PROT_READ | PROT_WRITE),
                     (MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | (30u << 26)), -1, 0);
@@ -27,6 +27,14 @@ namespace bolson::buffer {
  */
 class OpaeAllocator : public Allocator {
  public:
+  /**
+   * \brief Construct an OPAE allocator.
+   * \param huge_pages Whether to back buffers with 1 GiB huge pages, as required by
+   *                   the OPAE platform. Otherwise, buffers are backed by regular pages
+   *                   on first touch.
+   */
+  explicit OpaeAllocator(bool huge_pages = true) : huge_pages_(huge_pages) {}
+
   [[nodiscard]] auto AllowsFixedCapacityOnly() const -> bool override { return true; }
   [[nodiscard]] auto fixed_capacity() const -> size_t override { return fixed_capacity_; }
   auto Allocate(size_t size, std::byte** out) -> Status override;
@@ -36,6 +44,8 @@ class OpaeAllocator : public Allocator {
   // TODO: Work-around for limitations to the OPAE platform.
   static constexpr size_t fixed_capacity_ = 1024 * 1024 * 1024;
 
+  bool huge_pages_;
+
   std::unordered_map<void*, size_t> allocations;
 };
 
@@ -19,6 +19,7 @@
 #include <CLI/CLI.hpp>
 #include <algorithm>
 
+#include "bolson/buffer/memory_pool.h"
 #include "bolson/convert/converter.h"
 #include "bolson/parse/implementations.h"
 #include "bolson/publish/publisher.h"
@@ -33,6 +34,53 @@ static void AddClientOptionsToCLI(CLI::App* sub, illex::ClientOptions* client) {
       ->default_val(ILLEX_DEFAULT_PORT);
 }
 
+/// \brief Parse an endpoint of the form <host>:<port>.
+static auto ParseEndpoint(const std::string& str, illex::ClientOptions* out) -> Status {
+  auto colon = str.rfind(':');
+  if ((colon == std::string::npos) || (colon == 0) || (colon == str.size() - 1)) {
+    return Status(Error::CLIError,
+                  "Endpoint \"" + str + "\" is not of the form <host>:<port>.");
+  }
+  auto port = str.substr(colon + 1);
+  if (!std::all_of(port.begin(), port.end(), ::isdigit) || (std::stoul(port) > 65535)) {
+    return Status(Error::CLIError, "Endpoint \"" + str + "\" has an invalid port.");
+  }
+  out->host = str.substr(0, colon);
+  out->port = static_cast<uint16_t>(std::stoul(port));
+  return Status::OK();
+}
+
+static void AddHandoffOptionToCLI(CLI::App* sub, parse::Handoff* handoff) {
+  sub->add_option("--handoff", *handoff,
+                  "Mechanism to hand over input buffers to converter threads. \"queue\" "
+                  "uses lock-free ready/free queues, \"mutex\" makes threads scan and "
+                  "lock the buffers.")
+      ->transform(CLI::CheckedTransformer(
+          std::map<std::string, parse::Handoff>{{"queue", parse::Handoff::QUEUE},
+                                                {"mutex", parse::Handoff::MUTEX}},
+          CLI::ignore_case))
+      ->default_val(parse::Handoff::QUEUE);
+}
+
+static void AddEngineOptionToCLI(CLI::App* sub, client::Engine* engine) {
+  sub->add_option("--engine", *engine,
+                  "Receive engine. \"uring\" drives all connections through a single "
+                  "io_uring and requires queue buffer handoff.")
+      ->transform(CLI::CheckedTransformer(
+          std::map<std::string, client::Engine>{{"posix", client::Engine::POSIX},
+                                                {"uring", client::Engine::URING}},
+          CLI::ignore_case))
+      ->default_val(client::Engine::POSIX);
+}
+
+static void AddMaxBufferDelayOptionToCLI(CLI::App* sub, size_t* max_delay_us) {
+  sub->add_option("--max-buffer-delay-us", *max_delay_us,
+                  "Keep receiving into a buffer until it is full or its oldest JSON has "
+                  "waited this many microseconds. If 0, hand over buffers as soon as "
+                  "they hold a complete JSON. Requires queue buffer handoff.")
+      ->default_val(0);
+}
+
 static void AddConverterOptionsToCLI(CLI::App* sub, convert::ConverterOptions* opts) {
   sub->add_option("--max-rows", opts->max_batch_rows,
                   "Maximum number of rows per RecordBatch.")
@@ -43,14 +91,44 @@ static void AddConverterOptionsToCLI(CLI::App* sub, convert::ConverterOptions* o
   sub->add_option("--threads", opts->num_threads,
                   "Number of threads to use for conversion.")
       ->default_val(1);
+  AddHandoffOptionToCLI(sub, &opts->handoff);
+  buffer::AddMemoryPoolOptionsToCLI(sub, &opts->pool);
+  AddPlacementOptionToCLI(sub, &opts->placement);
+  convert::AddFilterOptionToCLI(sub, &opts->filter);
   AddParserOptions(sub, &opts->parser);
 }
 
 static void AddBenchOptionsToCLI(CLI::App* bench, BenchOptions* out) {
   // 'bench client' subcommand.
   auto* bench_client =
-      bench->add_subcommand("client", "Run TCP client interface microbenchmark.");
-  AddClientOptionsToCLI(bench_client, &out->client);
+      bench->add_subcommand("client", "Run TCP client microbenchmark on loopback.");
+  bench_client
+      ->add_option("--num-jsons", out->client.num_jsons,
+                   "Number of JSONs to send through the loopback connection(s).")
+      ->default_val(1024 * 1024);
+  bench_client->add_option("--seed", out->client.generate.seed, "Generation seed.")
+      ->default_val(0);
+  bench_client->add_option("--port", out->client.port, "Loopback server port.")
+      ->default_val(ILLEX_DEFAULT_PORT);
+  bench_client->add_option("--connections", out->client.connections,
+                           "Number of loopback connections.")
+      ->check(CLI::PositiveNumber)
+      ->default_val(1);
+  bench_client
+      ->add_option("--buffers", out->client.buffers,
+                   "Numbers of input buffers to benchmark, comma-separated.")
+      ->delimiter(',')
+      ->check(CLI::PositiveNumber);
+  bench_client
+      ->add_option("--capacities", out->client.capacities,
+                   "Input buffer capacities to benchmark, comma-separated. Defaults to "
+                   "--arrow-buf-cap.")
+      ->delimiter(',')
+      ->check(CLI::PositiveNumber);
+  AddEngineOptionToCLI(bench_client, &out->client.engine);
+  AddMaxBufferDelayOptionToCLI(bench_client, &out->client.max_buffer_delay_us);
+  AddHandoffOptionToCLI(bench_client, &out->client.handoff);
+  parse::AddArrowOptionsToCLI(bench_client, &out->client.arrow);
 
   // 'bench convert' subcommand.
   auto* bench_conv =
@@ -78,6 +156,22 @@ static void AddBenchOptionsToCLI(CLI::App* bench, BenchOptions* out) {
   auto* bench_pulsar =
       bench->add_subcommand("pulsar", "Run Pulsar publishing microbenchmark.");
   AddPublishBenchToCLI(bench_pulsar, &out->pulsar);
+
+  // 'bench mmio' subcommand
+  auto* bench_mmio = bench->add_subcommand(
+      "mmio", "Run OPAE MMIO register contention microbenchmark.");
+  bench_mmio
+      ->add_option("--threads", out->mmio.threads,
+                   "Numbers of threads to benchmark, comma-separated. Every thread "
+                   "accesses the registers of its own parser instance.")
+      ->delimiter(',')
+      ->check(CLI::PositiveNumber);
+  bench_mmio
+      ->add_option("--accesses", out->mmio.accesses,
+                   "Number of register write and read pairs per thread.")
+      ->default_val(1024 * 1024);
+  parse::opae::AddPlatformOptionToCLI(bench_mmio, &out->mmio.platform,
+                                      parse::opae::Platform::EMU);
 }
 
 auto AppOptions::FromArguments(int argc, char** argv, AppOptions* out) -> Status {
@@ -96,6 +190,22 @@ auto AppOptions::FromArguments(int argc, char** argv, AppOptions* out) -> Status
   AddConverterOptionsToCLI(stream, &out->stream.converter);
   AddPublishOptsToCLI(stream, &out->stream.pulsar);
   AddClientOptionsToCLI(stream, &out->stream.client);
+  AddEngineOptionToCLI(stream, &out->stream.engine);
+  AddMaxBufferDelayOptionToCLI(stream, &out->stream.max_buffer_delay_us);
+  client::AddCompressionOptionToCLI(stream, &out->stream.compression);
+  stream->add_option("--input-file", out->stream.input_file,
+                     "Replay a newline-delimited JSON file instead of connecting to a "
+                     "TCP server.")
+      ->check(CLI::ExistingFile);
+  std::vector<std::string> endpoints;
+  stream->add_option("--endpoint", endpoints,
+                     "Additional JSON source TCP server as <host>:<port>. May be "
+                     "supplied multiple times.");
+  stream->add_option("--connections", out->stream.connections,
+                     "Number of TCP connections, distributed round-robin over all "
+                     "endpoints.")
+      ->check(CLI::PositiveNumber)
+      ->default_val(1);
 
   // 'bench' subcommand:
   auto* bench =
@@ -118,6 +228,12 @@ auto AppOptions::FromArguments(int argc, char** argv, AppOptions* out) -> Status
 
   if (stream->parsed()) {
     out->sub = SubCommand::STREAM;
+    out->stream.endpoints = {out->stream.client};
+    for (const auto& e : endpoints) {
+      illex::ClientOptions endpoint;
+      BOLSON_ROE(ParseEndpoint(e, &endpoint));
+      out->stream.endpoints.push_back(endpoint);
+    }
   } else if (bench->parsed()) {
     out->sub = SubCommand::BENCH;
     if (bench->get_subcommand_ptr("client")->parsed()) {
@@ -128,6 +244,8 @@ auto AppOptions::FromArguments(int argc, char** argv, AppOptions* out) -> Status
       out->bench.bench = Bench::PULSAR;
     } else if (bench->get_subcommand_ptr("queue")->parsed()) {
       out->bench.bench = Bench::QUEUE;
+    } else if (bench->get_subcommand_ptr("mmio")->parsed()) {
+      out->bench.bench = Bench::MMIO;
     }
   }
 
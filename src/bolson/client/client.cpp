@@ -0,0 +1,162 @@
+// Copyright 2020 Teratide B.V.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "bolson/client/client.h"
+
+#include <future>
+
+#include "bolson/client/tcp.h"
+#ifdef BOLSON_URING
+#include "bolson/client/uring.h"
+#endif
+
+namespace bolson::client {
+
+auto ToString(Engine engine) -> std::string {
+  switch (engine) {
+    case Engine::POSIX:
+      return "POSIX";
+    case Engine::URING:
+      return "io_uring";
+  }
+  return "Corrupt Engine enum - this should never happen.";
+}
+
+auto IllexClient::Make(const illex::ClientOptions& opts, parse::ParserContext* context,
+                       std::shared_ptr<Client>* out) -> Status {
+  auto result = std::shared_ptr<IllexClient>(new IllexClient());
+  BILLEX_ROE(illex::BufferingClient::Create(opts, context->mutable_buffers(),
+                                            context->mutexes(), &result->client_));
+  *out = result;
+  return Status::OK();
+}
+
+auto IllexClient::ReceiveJSONs() -> Status {
+  BILLEX_ROE(client_.ReceiveJSONs());
+  return Status::OK();
+}
+
+auto IllexClient::Close() -> Status {
+  BILLEX_ROE(client_.Close());
+  return Status::OK();
+}
+
+auto IllexClient::bytes_received() const -> size_t { return client_.bytes_received(); }
+
+auto IllexClient::jsons_received() const -> size_t { return client_.jsons_received(); }
+
+auto MakeClient(const illex::ClientOptions& opts, parse::Handoff handoff,
+                parse::ParserContext* context, std::shared_ptr<Client>* out,
+                std::atomic<uint64_t>* seq, std::chrono::microseconds max_delay,
+                Compression compression) -> Status {
+  switch (handoff) {
+    case parse::Handoff::QUEUE:
+      return TcpClient::Make(opts, context, out, seq, max_delay, compression);
+    case parse::Handoff::MUTEX:
+      if (seq != nullptr) {
+        return Status(Error::GenericError,
+                      "Shared sequence numbers require queue buffer handoff.");
+      }
+      if (max_delay.count() != 0) {
+        return Status(Error::GenericError,
+                      "Maximum buffer delay requires queue buffer handoff.");
+      }
+      if (compression != Compression::NONE) {
+        return Status(Error::GenericError,
+                      "Compressed streams require queue buffer handoff.");
+      }
+      return IllexClient::Make(opts, context, out);
+  }
+  return Status(Error::GenericError, "Unknown buffer handoff mechanism.");
+}
+
+auto MakeClients(const std::vector<illex::ClientOptions>& connections, Engine engine,
+                 parse::Handoff handoff, std::chrono::microseconds max_delay,
+                 parse::ParserContext* context, std::atomic<uint64_t>* seq, Clients* out,
+                 Compression compression) -> Status {
+  if (engine == Engine::URING) {
+#ifdef BOLSON_URING
+    if (handoff != parse::Handoff::QUEUE) {
+      return Status(Error::GenericError,
+                    "The io_uring engine requires queue buffer handoff.");
+    }
+    if (compression != Compression::NONE) {
+      return Status(Error::GenericError,
+                    "The io_uring engine does not support compressed streams.");
+    }
+    std::shared_ptr<Client> client;
+    BOLSON_ROE(UringClient::Make(connections, context, &client, max_delay));
+    out->push_back(client);
+    return Status::OK();
+#else
+    return Status(Error::GenericError, "Bolson was built without io_uring support.");
+#endif
+  }
+
+  // Multiple clients share the buffers, so they must also share sequence numbers.
+  auto* shared_seq = connections.size() > 1 ? seq : nullptr;
+  for (const auto& opts : connections) {
+    std::shared_ptr<Client> client;
+    BOLSON_ROE(MakeClient(opts, handoff, context, &client, shared_seq, max_delay,
+                          compression));
+    out->push_back(client);
+  }
+  return Status::OK();
+}
+
+auto ReceiveJSONs(const Clients& clients, const Topology* topology) -> Status {
+  std::vector<std::future<Status>> receivers;
+  for (size_t i = 0; i < clients.size(); i++) {
+    const auto& c = clients[i];
+    receivers.push_back(std::async(std::launch::async, [&c, i, topology]() -> Status {
+      if (topology != nullptr) {
+        WarnOnPlacementFailure(PinCurrentThread(topology->nodes[topology->node(i)]));
+      }
+      auto status = c->ReceiveJSONs();
+      return status += c->Close();
+    }));
+  }
+  MultiThreadStatus statuses;
+  for (auto& r : receivers) {
+    statuses.push_back(r.get());
+  }
+  return Aggregate(statuses, "Client: ");
+}
+
+auto JSONsReceived(const Clients& clients) -> size_t {
+  size_t result = 0;
+  for (const auto& c : clients) {
+    result += c->jsons_received();
+  }
+  return result;
+}
+
+auto BytesReceived(const Clients& clients) -> size_t {
+  size_t result = 0;
+  for (const auto& c : clients) {
+    result += c->bytes_received();
+  }
+  return result;
+}
+
+auto DecompressMetricsOf(const Clients& clients) -> DecompressMetrics {
+  DecompressMetrics result;
+  for (const auto& c : clients) {
+    result += c->decompress_metrics();
+  }
+  return result;
+}
+
+}  // namespace bolson::client
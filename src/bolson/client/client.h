@@ -0,0 +1,143 @@
+// Copyright 2020 Teratide B.V.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#pragma once
+
+#include <illex/client_buffering.h>
+#include <illex/protocol.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "bolson/client/decompress.h"
+#include "bolson/numa.h"
+#include "bolson/parse/parser.h"
+#include "bolson/status.h"
+
+namespace bolson::client {
+
+/// Receive engines for the queue buffer handoff.
+enum class Engine {
+  POSIX,  ///< A thread with blocking receive calls per connection.
+  URING   ///< A single io_uring for all connections, if built with BOLSON_URING.
+};
+
+/// \brief Return a human-readable name of the receive engine.
+auto ToString(Engine engine) -> std::string;
+
+/// \brief A client that receives JSONs from some source into the buffers of a parser
+/// context.
+class Client {
+ public:
+  virtual ~Client() = default;
+  /// \brief Receive JSONs until the source closes the connection.
+  virtual auto ReceiveJSONs() -> Status = 0;
+  /// \brief Close the client.
+  virtual auto Close() -> Status = 0;
+  /// \brief Return the number of bytes received.
+  [[nodiscard]] virtual auto bytes_received() const -> size_t = 0;
+  /// \brief Return the number of JSONs received.
+  [[nodiscard]] virtual auto jsons_received() const -> size_t = 0;
+  /// \brief Return the decompression metrics, if the received data was compressed.
+  [[nodiscard]] virtual auto decompress_metrics() const -> DecompressMetrics {
+    return {};
+  }
+};
+
+/// \brief Client filling buffers guarded by the mutexes of the parser context.
+class IllexClient : public Client {
+ public:
+  /**
+   * \brief Create a new IllexClient.
+   * \param opts    The client options.
+   * \param context The parser context providing the buffers and their mutexes.
+   * \param out     The resulting client.
+   * \return Status::OK() if successful, some error otherwise.
+   */
+  static auto Make(const illex::ClientOptions& opts, parse::ParserContext* context,
+                   std::shared_ptr<Client>* out) -> Status;
+
+  auto ReceiveJSONs() -> Status override;
+  auto Close() -> Status override;
+  [[nodiscard]] auto bytes_received() const -> size_t override;
+  [[nodiscard]] auto jsons_received() const -> size_t override;
+
+ private:
+  IllexClient() = default;
+  illex::BufferingClient client_;
+};
+
+/**
+ * \brief Create a client that hands over buffers using the supplied mechanism.
+ * \param opts    The client options.
+ * \param handoff The buffer handoff mechanism used by the converter.
+ * \param context The parser context providing the buffers.
+ * \param out     The resulting client.
+ * \param seq     Sequence number counter shared between clients, or nullptr. Only
+ *                supported with Handoff::QUEUE.
+ * \param max_delay Maximum time the oldest JSON in a buffer waits to be handed over. If
+ *                  zero, buffers are handed over as soon as they hold a complete JSON.
+ *                  Only supported with Handoff::QUEUE.
+ * \param compression The compression of the stream. Only supported with Handoff::QUEUE.
+ * \return Status::OK() if successful, some error otherwise.
+ */
+auto MakeClient(const illex::ClientOptions& opts, parse::Handoff handoff,
+                parse::ParserContext* context, std::shared_ptr<Client>* out,
+                std::atomic<uint64_t>* seq = nullptr,
+                std::chrono::microseconds max_delay = std::chrono::microseconds(0),
+                Compression compression = Compression::NONE) -> Status;
+
+/// Clients receiving JSONs concurrently.
+using Clients = std::vector<std::shared_ptr<Client>>;
+
+/**
+ * \brief Create clients for a number of connections sharing the buffers of a context.
+ * \param connections One entry per connection to open.
+ * \param engine      The receive engine.
+ * \param handoff     The buffer handoff mechanism used by the converter.
+ * \param max_delay   Maximum time the oldest JSON in a buffer waits to be handed over.
+ * \param context     The parser context providing the buffers.
+ * \param seq         Sequence number counter shared between clients. Must outlive them.
+ * \param out         The resulting clients.
+ * \param compression The compression of the streams. Not supported by the io_uring
+ *                    engine.
+ * \return Status::OK() if successful, some error otherwise.
+ */
+auto MakeClients(const std::vector<illex::ClientOptions>& connections, Engine engine,
+                 parse::Handoff handoff, std::chrono::microseconds max_delay,
+                 parse::ParserContext* context, std::atomic<uint64_t>* seq, Clients* out,
+                 Compression compression = Compression::NONE) -> Status;
+
+/**
+ * \brief Receive JSONs with all clients concurrently and close them once disconnected.
+ * \param clients  The clients.
+ * \param topology If not nullptr, pin the client threads to its nodes round-robin.
+ * \return Status::OK() if successful, some error otherwise.
+ */
+auto ReceiveJSONs(const Clients& clients, const Topology* topology = nullptr) -> Status;
+
+/// \brief Return the total number of JSONs received by all clients.
+auto JSONsReceived(const Clients& clients) -> size_t;
+
+/// \brief Return the total number of bytes received by all clients.
+auto BytesReceived(const Clients& clients) -> size_t;
+
+/// \brief Return the total decompression metrics of all clients.
+auto DecompressMetricsOf(const Clients& clients) -> DecompressMetrics;
+
+}  // namespace bolson::client
@@ -0,0 +1,292 @@
+// Copyright 2020 Teratide B.V.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "bolson/client/decompress.h"
+
+#include <putong/timer.h>
+
+#include <cstring>
+#include <functional>
+#include <map>
+
+namespace bolson::client {
+
+auto ToString(Compression compression) -> std::string {
+  switch (compression) {
+    case Compression::NONE:
+      return "none";
+    case Compression::ZSTD:
+      return "zstd";
+    case Compression::LZ4:
+      return "LZ4";
+  }
+  return "Corrupt bolson::client::Compression enum value.";
+}
+
+void AddCompressionOptionToCLI(CLI::App* sub, Compression* out) {
+  sub->add_option("--compression", *out,
+                  "Compression of the JSON input. \"zstd\" and \"lz4\" accept any number "
+                  "of concatenated frames, which are decompressed in parallel when "
+                  "replaying a file.")
+      ->transform(CLI::CheckedTransformer(
+          std::map<std::string, Compression>{{"none", Compression::NONE},
+                                             {"zstd", Compression::ZSTD},
+                                             {"lz4", Compression::LZ4}},
+          CLI::ignore_case))
+      ->default_val(Compression::NONE);
+}
+
+auto DecompressMetrics::operator+=(const DecompressMetrics& r) -> DecompressMetrics& {
+  compressed_bytes += r.compressed_bytes;
+  decompressed_bytes += r.decompressed_bytes;
+  seconds += r.seconds;
+  return *this;
+}
+
+auto StreamDecompressor::Make(Compression compression,
+                              std::unique_ptr<StreamDecompressor>* out) -> Status {
+  arrow::Compression::type type;
+  switch (compression) {
+    case Compression::ZSTD:
+      type = arrow::Compression::ZSTD;
+      break;
+    case Compression::LZ4:
+      type = arrow::Compression::LZ4_FRAME;
+      break;
+    default:
+      return Status(Error::GenericError, "Input is not compressed.");
+  }
+  auto codec = arrow::util::Codec::Create(type);
+  if (!codec.ok()) {
+    return Status(Error::ArrowError, "Unable to create " + ToString(compression) +
+                                         " codec: " + codec.status().message());
+  }
+  auto decompressor = codec.ValueOrDie()->MakeDecompressor();
+  if (!decompressor.ok()) {
+    return Status(Error::ArrowError, "Unable to create " + ToString(compression) +
+                                         " decompressor: " +
+                                         decompressor.status().message());
+  }
+  auto result = std::unique_ptr<StreamDecompressor>(new StreamDecompressor());
+  result->decompressor_ = decompressor.ValueOrDie();
+  *out = std::move(result);
+  return Status::OK();
+}
+
+auto StreamDecompressor::Decompress(const std::byte* in, size_t in_size, std::byte* out,
+                                    size_t out_capacity, size_t* consumed,
+                                    size_t* produced) -> Status {
+  putong::Timer<> timer(true);
+  *consumed = 0;
+  *produced = 0;
+  while (((*consumed < in_size) || pending_output_) && (*produced < out_capacity)) {
+    // Start the next frame.
+    if (started_ && decompressor_->IsFinished() && (*consumed < in_size)) {
+      ARROW_ROE(decompressor_->Reset());
+    }
+    started_ = true;
+    auto result = decompressor_->Decompress(
+        static_cast<int64_t>(in_size - *consumed),
+        reinterpret_cast<const uint8_t*>(in + *consumed),
+        static_cast<int64_t>(out_capacity - *produced),
+        reinterpret_cast<uint8_t*>(out + *produced));
+    if (!result.ok()) {
+      return Status(Error::ArrowError,
+                    "Unable to decompress input: " + result.status().message());
+    }
+    auto r = result.ValueOrDie();
+    *consumed += r.bytes_read;
+    *produced += r.bytes_written;
+    // Decompressed data may still be pending if the output is full, unless the frame
+    // ended exactly at the end of the output.
+    pending_output_ = (*produced == out_capacity) && !decompressor_->IsFinished();
+    // Without progress, the decompressor needs more input.
+    if ((r.bytes_read == 0) && (r.bytes_written == 0)) break;
+  }
+  timer.Stop();
+  metrics_.compressed_bytes += *consumed;
+  metrics_.decompressed_bytes += *produced;
+  metrics_.seconds += timer.seconds();
+  return Status::OK();
+}
+
+auto StreamDecompressor::finished() const -> bool {
+  return !started_ || (decompressor_->IsFinished() && !pending_output_);
+}
+
+/// \brief Read a little-endian unsigned integer of n bytes.
+static auto ReadLE(const uint8_t* p, size_t n) -> uint64_t {
+  uint64_t result = 0;
+  for (size_t i = 0; i < n; i++) {
+    result |= static_cast<uint64_t>(p[i]) << (8 * i);
+  }
+  return result;
+}
+
+/// Magic numbers of the compression formats.
+constexpr uint32_t kZstdMagic = 0xFD2FB528;
+constexpr uint32_t kLz4Magic = 0x184D2204;
+/// Magic number of skippable frames of both formats, ignoring the lowest four bits.
+constexpr uint32_t kSkippableMagic = 0x184D2A50;
+
+/// \brief Return the size of the headers and blocks of a Zstandard frame.
+static auto ZstdFrameSize(const uint8_t* p, size_t avail, size_t* size) -> Status {
+  size_t pos = 5;
+  if (avail < pos) return Status(Error::IOError, "Truncated zstd frame header.");
+  const auto descriptor = p[4];
+  const auto content_size_flag = descriptor >> 6u;
+  const bool single_segment = (descriptor >> 5u) & 1u;
+  const bool checksum = (descriptor >> 2u) & 1u;
+  const size_t dict_id_sizes[] = {0, 1, 2, 4};
+  pos += single_segment ? 0 : 1;
+  pos += dict_id_sizes[descriptor & 3u];
+  pos += content_size_flag == 0 ? (single_segment ? 1 : 0) : (1u << content_size_flag);
+  // Walk the blocks.
+  bool last = false;
+  while (!last) {
+    if (avail < pos + 3) return Status(Error::IOError, "Truncated zstd block header.");
+    auto header = ReadLE(p + pos, 3);
+    last = header & 1u;
+    auto type = (header >> 1u) & 3u;
+    if (type == 3) return Status(Error::IOError, "Corrupt zstd block header.");
+    pos += 3 + (type == 1 ? 1 : header >> 3u);
+  }
+  pos += checksum ? 4 : 0;
+  *size = pos;
+  return Status::OK();
+}
+
+/// \brief Return the size of the headers and blocks of an LZ4 frame.
+static auto Lz4FrameSize(const uint8_t* p, size_t avail, size_t* size) -> Status {
+  size_t pos = 7;
+  if (avail < pos) return Status(Error::IOError, "Truncated LZ4 frame header.");
+  const auto flags = p[4];
+  const bool block_checksum = flags & 0x10u;
+  const bool content_checksum = flags & 0x04u;
+  pos += (flags & 0x08u) ? 8 : 0;
+  pos += (flags & 0x01u) ? 4 : 0;
+  // Walk the blocks until the end mark.
+  while (true) {
+    if (avail < pos + 4) return Status(Error::IOError, "Truncated LZ4 block header.");
+    auto block_size = ReadLE(p + pos, 4);
+    pos += 4;
+    if (block_size == 0) break;
+    pos += (block_size & 0x7FFFFFFFu) + (block_checksum ? 4 : 0);
+  }
+  pos += content_checksum ? 4 : 0;
+  *size = pos;
+  return Status::OK();
+}
+
+auto FindFrames(Compression compression, const std::byte* data, size_t size,
+                std::vector<std::pair<size_t, size_t>>* out) -> Status {
+  const auto* p = reinterpret_cast<const uint8_t*>(data);
+  size_t offset = 0;
+  while (offset < size) {
+    const auto avail = size - offset;
+    if (avail < 8) {
+      return Status(Error::IOError,
+                    "Truncated frame at offset " + std::to_string(offset));
+    }
+    auto magic = static_cast<uint32_t>(ReadLE(p + offset, 4));
+    size_t frame_size = 0;
+    if ((magic & 0xFFFFFFF0u) == kSkippableMagic) {
+      frame_size = 8 + ReadLE(p + offset + 4, 4);
+    } else if ((compression == Compression::ZSTD) && (magic == kZstdMagic)) {
+      BOLSON_ROE(ZstdFrameSize(p + offset, avail, &frame_size));
+    } else if ((compression == Compression::LZ4) && (magic == kLz4Magic)) {
+      BOLSON_ROE(Lz4FrameSize(p + offset, avail, &frame_size));
+    } else {
+      return Status(Error::IOError, "No " + ToString(compression) +
+                                        " frame at offset " + std::to_string(offset));
+    }
+    if (frame_size > avail) {
+      return Status(Error::IOError,
+                    "Truncated frame at offset " + std::to_string(offset));
+    }
+    out->emplace_back(offset, frame_size);
+    offset += frame_size;
+  }
+  return Status::OK();
+}
+
+/// \brief Decompress a single frame, growing the output as needed.
+static auto DecompressFrame(Compression compression, const std::byte* data, size_t size,
+                            std::vector<std::byte>* out) -> Status {
+  std::unique_ptr<StreamDecompressor> decompressor;
+  BOLSON_ROE(StreamDecompressor::Make(compression, &decompressor));
+  size_t in_offset = 0;
+  size_t out_offset = 0;
+  out->resize(4 * size);
+  while ((in_offset < size) || decompressor->has_output()) {
+    if (out_offset == out->size()) {
+      out->resize(2 * out->size());
+    }
+    size_t consumed = 0;
+    size_t produced = 0;
+    BOLSON_ROE(decompressor->Decompress(data + in_offset, size - in_offset,
+                                        out->data() + out_offset,
+                                        out->size() - out_offset, &consumed, &produced));
+    if ((consumed == 0) && (produced == 0) && !decompressor->has_output()) break;
+    in_offset += consumed;
+    out_offset += produced;
+  }
+  if ((in_offset != size) || !decompressor->finished()) {
+    return Status(Error::IOError, "Truncated " + ToString(compression) + " frame.");
+  }
+  out->resize(out_offset);
+  return Status::OK();
+}
+
+auto DecompressFrames(Compression compression, const std::byte* data, size_t size,
+                      parse::TaskPool* pool, std::vector<std::byte>* out,
+                      DecompressMetrics* metrics) -> Status {
+  putong::Timer<> timer(true);
+  std::vector<std::pair<size_t, size_t>> frames;
+  BOLSON_ROE(FindFrames(compression, data, size, &frames));
+
+  // Frames are independent, so decompress all of them in parallel.
+  std::vector<std::vector<std::byte>> decompressed(frames.size());
+  std::vector<Status> statuses(frames.size(), Status::OK());
+  std::vector<std::function<void()>> tasks;
+  tasks.reserve(frames.size());
+  for (size_t f = 0; f < frames.size(); f++) {
+    tasks.emplace_back([&, f]() {
+      statuses[f] = DecompressFrame(compression, data + frames[f].first,
+                                    frames[f].second, &decompressed[f]);
+    });
+  }
+  pool->Run(tasks);
+
+  size_t total = 0;
+  for (size_t f = 0; f < frames.size(); f++) {
+    BOLSON_ROE(statuses[f]);
+    total += decompressed[f].size();
+  }
+  out->resize(total);
+  size_t offset = 0;
+  for (const auto& d : decompressed) {
+    std::memcpy(out->data() + offset, d.data(), d.size());
+    offset += d.size();
+  }
+  timer.Stop();
+
+  metrics->compressed_bytes += size;
+  metrics->decompressed_bytes += total;
+  metrics->seconds += timer.seconds();
+  return Status::OK();
+}
+
+}  // namespace bolson::client
@@ -0,0 +1,129 @@
+// Copyright 2020 Teratide B.V.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#pragma once
+
+#include <arrow/util/compression.h>
+
+#include <CLI/CLI.hpp>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "bolson/parse/pool.h"
+#include "bolson/status.h"
+
+namespace bolson::client {
+
+/// Compression formats of the JSON input stream.
+enum class Compression {
+  NONE,  ///< Raw newline-delimited JSON.
+  ZSTD,  ///< Zstandard frames.
+  LZ4    ///< LZ4 frames.
+};
+
+/// \brief Return a human-readable name of the compression format.
+auto ToString(Compression compression) -> std::string;
+
+/// \brief Add an option to select the compression format of the input to the CLI.
+void AddCompressionOptionToCLI(CLI::App* sub, Compression* out);
+
+/// Decompression statistics.
+struct DecompressMetrics {
+  /// Number of compressed bytes consumed.
+  size_t compressed_bytes = 0;
+  /// Number of decompressed bytes produced.
+  size_t decompressed_bytes = 0;
+  /// Time spent decompressing, in seconds.
+  double seconds = 0.0;
+
+  auto operator+=(const DecompressMetrics& r) -> DecompressMetrics&;
+};
+
+/**
+ * \brief Decompressor of a stream of concatenated compressed frames.
+ *
+ * Input may be supplied in arbitrary pieces, regardless of frame boundaries.
+ */
+class StreamDecompressor {
+ public:
+  /**
+   * \brief Make a new stream decompressor.
+   * \param compression The compression format. Must not be Compression::NONE.
+   * \param out         The resulting decompressor.
+   * \return Status::OK() if successful, some error otherwise.
+   */
+  static auto Make(Compression compression, std::unique_ptr<StreamDecompressor>* out)
+      -> Status;
+
+  /**
+   * \brief Decompress as much input as fits in the output.
+   * \param in           The compressed input.
+   * \param in_size      The number of bytes of compressed input.
+   * \param out          The output to decompress into.
+   * \param out_capacity The number of bytes available in the output.
+   * \param consumed     The number of input bytes consumed.
+   * \param produced     The number of output bytes produced.
+   * \return Status::OK() if successful, some error otherwise.
+   */
+  auto Decompress(const std::byte* in, size_t in_size, std::byte* out,
+                  size_t out_capacity, size_t* consumed, size_t* produced) -> Status;
+
+  /// \brief Return true if decompressed data may be pending that did not fit the output.
+  [[nodiscard]] auto has_output() const -> bool { return pending_output_; }
+
+  /// \brief Return true if the input ended at the end of a frame.
+  [[nodiscard]] auto finished() const -> bool;
+
+  /// \brief Return decompression statistics.
+  [[nodiscard]] auto metrics() const -> DecompressMetrics { return metrics_; }
+
+ private:
+  StreamDecompressor() = default;
+
+  std::shared_ptr<arrow::util::Decompressor> decompressor_;
+  bool pending_output_ = false;
+  bool started_ = false;
+  DecompressMetrics metrics_;
+};
+
+/**
+ * \brief Find the boundaries of the frames in compressed data.
+ * \param compression The compression format. Must not be Compression::NONE.
+ * \param data        The compressed data.
+ * \param size        The number of bytes of compressed data.
+ * \param out         The offset and size of every frame.
+ * \return Status::OK() if successful, some error otherwise.
+ */
+auto FindFrames(Compression compression, const std::byte* data, size_t size,
+                std::vector<std::pair<size_t, size_t>>* out) -> Status;
+
+/**
+ * \brief Decompress all frames of compressed data, in parallel.
+ * \param compression The compression format. Must not be Compression::NONE.
+ * \param data        The compressed data.
+ * \param size        The number of bytes of compressed data.
+ * \param pool        The pool to decompress frames on.
+ * \param out         The decompressed data.
+ * \param metrics     The decompression statistics.
+ * \return Status::OK() if successful, some error otherwise.
+ */
+auto DecompressFrames(Compression compression, const std::byte* data, size_t size,
+                      parse::TaskPool* pool, std::vector<std::byte>* out,
+                      DecompressMetrics* metrics) -> Status;
+
+}  // namespace bolson::client
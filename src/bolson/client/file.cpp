@@ -0,0 +1,189 @@
+// Copyright 2020 Teratide B.V.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "bolson/client/file.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <thread>
+
+#include "bolson/parse/pool.h"
+
+namespace bolson::client {
+
+auto FileClient::Make(const std::string& path, parse::Handoff handoff,
+                      parse::ParserContext* context, std::shared_ptr<Client>* out,
+                      Compression compression) -> Status {
+  if (handoff != parse::Handoff::QUEUE) {
+    return Status(Error::GenericError, "File source requires queue buffer handoff.");
+  }
+  auto buffers = context->mutable_buffers();
+  if (buffers.empty()) {
+    return Status(Error::GenericError, "Parser context has no buffers.");
+  }
+
+  auto result = std::shared_ptr<FileClient>(new FileClient(context));
+  result->capacity_ = buffers[0]->capacity();
+  result->in_place_ = context->AcceptsForeignBuffers();
+  if (result->in_place_) {
+    result->slices_ = std::vector<illex::JSONBuffer>(buffers.size());
+  }
+
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return Status(Error::IOError,
+                  "Unable to open " + path + ": " + std::string(strerror(errno)));
+  }
+  struct stat st {};
+  if (fstat(fd, &st) != 0) {
+    auto msg = std::string(strerror(errno));
+    close(fd);
+    return Status(Error::IOError, "Unable to stat " + path + ": " + msg);
+  }
+  result->map_size_ = st.st_size;
+
+  if (result->map_size_ > 0) {
+    // Map privately, so parsers that modify their input in place never touch the file.
+    auto* map =
+        mmap(nullptr, result->map_size_, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED) {
+      auto msg = std::string(strerror(errno));
+      close(fd);
+      return Status(Error::IOError, "Unable to map " + path + ": " + msg);
+    }
+    madvise(map, result->map_size_, MADV_SEQUENTIAL);
+    result->map_ = static_cast<std::byte*>(map);
+  }
+  close(fd);
+
+  result->data_ = result->map_;
+  result->size_ = result->map_size_;
+  if ((compression != Compression::NONE) && (result->map_size_ > 0)) {
+    // Frames are independent, so decompress them on all cores.
+    parse::TaskPool pool(std::max(1U, std::thread::hardware_concurrency()) - 1);
+    BOLSON_ROE(DecompressFrames(compression, result->map_, result->map_size_, &pool,
+                                &result->decompressed_, &result->decompress_metrics_));
+    BOLSON_ROE(result->Close());
+    result->data_ = result->decompressed_.data();
+    result->size_ = result->decompressed_.size();
+  }
+
+  *out = result;
+  return Status::OK();
+}
+
+FileClient::~FileClient() { Close(); }
+
+/// \brief Return the number of lines holding anything but whitespace.
+static auto CountJSONs(const char* data, size_t size) -> size_t {
+  size_t result = 0;
+  bool blank = true;
+  for (size_t i = 0; i < size; i++) {
+    switch (data[i]) {
+      case '\n':
+        if (!blank) result++;
+        blank = true;
+        break;
+      case ' ':
+      case '\t':
+      case '\r':
+        break;
+      default:
+        blank = false;
+    }
+  }
+  // An unterminated last line is a JSON too.
+  return blank ? result : result + 1;
+}
+
+auto FileClient::ReceiveJSONs() -> Status {
+  auto* ready = context_->ready_queue();
+  auto* free = context_->free_queue();
+
+  if (in_place_) {
+    // Swap the buffers of the context for the slice wrappers.
+    context_->ClaimBuffers();
+    for (auto& slice : slices_) {
+      free->enqueue(&slice);
+    }
+  }
+
+  size_t offset = 0;
+  while (offset < size_) {
+    auto* data = data_ + offset;
+    auto* chars = reinterpret_cast<const char*>(data);
+    auto len = std::min(size_ - offset, capacity_);
+    if (offset + len < size_) {
+      // Cut the slice after the last line that fits.
+      auto* last = static_cast<const char*>(memrchr(chars, '\n', len));
+      if (last == nullptr) {
+        return Status(Error::IOError, "Line at offset " + std::to_string(offset) +
+                                          " exceeds buffer capacity of " +
+                                          std::to_string(capacity_) + " bytes.");
+      }
+      len = last - chars + 1;
+    }
+    // Parsers skip blank lines, so don't count them, and skip slices of only blank lines.
+    const size_t num_jsons = CountJSONs(chars, len);
+    bytes_received_ += len;
+    offset += len;
+    if (num_jsons == 0) continue;
+
+    illex::JSONBuffer* buffer = nullptr;
+    free->wait_dequeue(buffer);
+    if (in_place_) {
+      BILLEX_ROE(illex::JSONBuffer::Create(data, len, buffer));
+    } else {
+      std::memcpy(buffer->mutable_data(), data, len);
+    }
+    BILLEX_ROE(buffer->SetSize(len));
+    buffer->SetRange({jsons_received_, jsons_received_ + num_jsons - 1});
+    buffer->SetRecvTime(illex::Timer::now());
+    ready->enqueue(buffer);
+
+    jsons_received_ += num_jsons;
+  }
+
+  if (in_place_) {
+    // Wait for all slices to be parsed and give the context its buffers back.
+    illex::JSONBuffer* buffer = nullptr;
+    for (size_t i = 0; i < slices_.size(); i++) {
+      free->wait_dequeue(buffer);
+    }
+    context_->PublishBuffers();
+  }
+
+  return Status::OK();
+}
+
+auto FileClient::Close() -> Status {
+  if (map_ != nullptr) {
+    if (munmap(map_, map_size_) != 0) {
+      map_ = nullptr;
+      return Status(Error::IOError,
+                    "Unable to unmap file: " + std::string(strerror(errno)));
+    }
+    map_ = nullptr;
+  }
+  return Status::OK();
+}
+
+}  // namespace bolson::client
@@ -0,0 +1,93 @@
+// Copyright 2020 Teratide B.V.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "bolson/client/client.h"
+#include "bolson/parse/parser.h"
+#include "bolson/status.h"
+
+namespace bolson::client {
+
+/**
+ * \brief Client replaying a newline-delimited JSON file.
+ *
+ * The file is memory-mapped and handed to the parsers in newline-aligned slices of at
+ * most the capacity of the parser context buffers. Sequence numbers are assigned by line.
+ *
+ * If the parser context accepts foreign buffers, the slices are parsed in place. To this
+ * end, the buffers of the context are claimed while the file is being replayed, and
+ * buffers wrapping the slices circulate through the ready and free queues instead.
+ * Otherwise, slices are copied into the buffers of the context.
+ *
+ * A compressed file is decompressed up front, decompressing its frames in parallel, after
+ * which the decompressed data is replayed.
+ */
+class FileClient : public Client {
+ public:
+  /**
+   * \brief Create a new FileClient.
+   * \param path    Path to the file to replay.
+   * \param handoff The buffer handoff mechanism used by the converter.
+   * \param context The parser context providing the buffers and queues.
+   * \param out     The resulting client.
+   * \param compression The compression of the file.
+   * \return Status::OK() if successful, some error otherwise.
+   */
+  static auto Make(const std::string& path, parse::Handoff handoff,
+                   parse::ParserContext* context, std::shared_ptr<Client>* out,
+                   Compression compression = Compression::NONE) -> Status;
+
+  ~FileClient() override;
+
+  auto ReceiveJSONs() -> Status override;
+  auto Close() -> Status override;
+  [[nodiscard]] auto bytes_received() const -> size_t override { return bytes_received_; }
+  [[nodiscard]] auto jsons_received() const -> size_t override { return jsons_received_; }
+  [[nodiscard]] auto decompress_metrics() const -> DecompressMetrics override {
+    return decompress_metrics_;
+  }
+
+ private:
+  explicit FileClient(parse::ParserContext* context) : context_(context) {}
+
+  /// The parser context.
+  parse::ParserContext* context_ = nullptr;
+  /// The mapped file.
+  std::byte* map_ = nullptr;
+  /// The size of the mapped file.
+  size_t map_size_ = 0;
+  /// The decompressed file, if compressed.
+  std::vector<std::byte> decompressed_;
+  /// The data to replay, either the mapped or the decompressed file.
+  std::byte* data_ = nullptr;
+  /// The size of the data to replay.
+  size_t size_ = 0;
+  /// The maximum size of a slice.
+  size_t capacity_ = 0;
+  /// Whether slices are parsed in place.
+  bool in_place_ = false;
+  /// Buffers wrapping slices of the mapped file, if parsed in place.
+  std::vector<illex::JSONBuffer> slices_;
+  size_t bytes_received_ = 0;
+  size_t jsons_received_ = 0;
+  DecompressMetrics decompress_metrics_;
+};
+
+}  // namespace bolson::client
@@ -0,0 +1,260 @@
+// Copyright 2020 Teratide B.V.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "bolson/client/tcp.h"
+
+#include <netdb.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <string>
+
+namespace bolson::client {
+
+auto Connect(const illex::ClientOptions& opts, int* fd) -> Status {
+  *fd = -1;
+  addrinfo hints{};
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  addrinfo* addresses = nullptr;
+  auto err = getaddrinfo(opts.host.c_str(), std::to_string(opts.port).c_str(), &hints,
+                         &addresses);
+  if (err != 0) {
+    return Status(Error::IOError, "Unable to resolve " + opts.host + ": " +
+                                      std::string(gai_strerror(err)));
+  }
+
+  for (auto* a = addresses; a != nullptr; a = a->ai_next) {
+    int s = socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+    if (s < 0) continue;
+    if (connect(s, a->ai_addr, a->ai_addrlen) == 0) {
+      *fd = s;
+      break;
+    }
+    close(s);
+  }
+  freeaddrinfo(addresses);
+
+  if (*fd < 0) {
+    return Status(Error::IOError, "Unable to connect to " + opts.host + ":" +
+                                      std::to_string(opts.port));
+  }
+  return Status::OK();
+}
+
+auto TcpClient::Make(const illex::ClientOptions& opts, parse::ParserContext* context,
+                     std::shared_ptr<Client>* out, std::atomic<uint64_t>* seq,
+                     std::chrono::microseconds max_delay, Compression compression)
+    -> Status {
+  auto result = std::shared_ptr<TcpClient>(
+      new TcpClient(context->ready_queue(), context->free_queue()));
+  if (seq != nullptr) {
+    result->seq_ = seq;
+  }
+  result->max_delay_ = max_delay;
+  if (compression != Compression::NONE) {
+    BOLSON_ROE(StreamDecompressor::Make(compression, &result->decompressor_));
+    result->compressed_.resize(BOLSON_COMPRESSED_RECV_SIZE);
+  }
+  BOLSON_ROE(Connect(opts, &result->fd_));
+  *out = result;
+  return Status::OK();
+}
+
+TcpClient::~TcpClient() { Close(); }
+
+auto TcpClient::Dispatch() -> Status {
+  // Stage the incomplete tail, so this buffer can be handed over before taking the next
+  // one. Otherwise a client that can hold only one buffer waits on itself.
+  tail_.assign(buffer_->data() + complete_, buffer_->data() + filled_);
+
+  BILLEX_ROE(buffer_->SetSize(complete_));
+  auto first = seq_->fetch_add(num_jsons_);
+  buffer_->SetRange({first, first + num_jsons_ - 1});
+  buffer_->SetRecvTime(oldest_);
+  ready_->enqueue(buffer_);
+  jsons_received_ += num_jsons_;
+
+  free_->wait_dequeue(buffer_);
+  std::memcpy(buffer_->mutable_data(), tail_.data(), tail_.size());
+  filled_ = tail_.size();
+  complete_ = 0;
+  num_jsons_ = 0;
+  return Status::OK();
+}
+
+auto TcpClient::WaitForData(bool* ready) -> Status {
+  *ready = true;
+  if ((max_delay_.count() == 0) || (num_jsons_ == 0)) {
+    return Status::OK();
+  }
+  // Received data may still be waiting to be decompressed.
+  if ((decompressor_ != nullptr) &&
+      ((compressed_begin_ < compressed_end_) || decompressor_->has_output())) {
+    return Status::OK();
+  }
+  auto remaining = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      oldest_ + max_delay_ - illex::Timer::now());
+  if (remaining.count() <= 0) {
+    *ready = false;
+    return Status::OK();
+  }
+  pollfd pfd{fd_, POLLIN, 0};
+  timespec timeout{static_cast<time_t>(remaining.count() / 1000000000),
+                   static_cast<long>(remaining.count() % 1000000000)};
+  auto result = ppoll(&pfd, 1, &timeout, nullptr);
+  if ((result < 0) && (errno != EINTR)) {
+    return Status(Error::IOError, "Unable to poll: " + std::string(strerror(errno)));
+  }
+  *ready = result > 0;
+  return Status::OK();
+}
+
+auto TcpClient::ReceiveRaw(std::byte* out, size_t capacity, size_t* received)
+    -> Status {
+  ssize_t result = 0;
+  do {
+    result = recv(fd_, out, capacity, 0);
+  } while ((result < 0) && (errno == EINTR));
+
+  if (result < 0) {
+    return Status(Error::IOError, "Unable to receive: " + std::string(strerror(errno)));
+  }
+  *received = result;
+  return Status::OK();
+}
+
+auto TcpClient::Receive(std::byte* out, size_t capacity, size_t* received) -> Status {
+  if (decompressor_ == nullptr) {
+    return ReceiveRaw(out, capacity, received);
+  }
+  while (true) {
+    // Decompress what was received before receiving more.
+    if ((compressed_begin_ < compressed_end_) || decompressor_->has_output()) {
+      size_t consumed = 0;
+      BOLSON_ROE(decompressor_->Decompress(compressed_.data() + compressed_begin_,
+                                           compressed_end_ - compressed_begin_, out,
+                                           capacity, &consumed, received));
+      compressed_begin_ += consumed;
+      if (*received > 0) {
+        return Status::OK();
+      }
+    }
+    // Keep any input the decompressor could not consume yet, and receive more.
+    std::memmove(compressed_.data(), compressed_.data() + compressed_begin_,
+                 compressed_end_ - compressed_begin_);
+    compressed_end_ -= compressed_begin_;
+    compressed_begin_ = 0;
+    size_t raw = 0;
+    BOLSON_ROE(ReceiveRaw(compressed_.data() + compressed_end_,
+                          compressed_.size() - compressed_end_, &raw));
+    if (raw == 0) {
+      if ((compressed_end_ > 0) || !decompressor_->finished()) {
+        return Status(Error::IOError, "Connection closed in the middle of a frame.");
+      }
+      *received = 0;
+      return Status::OK();
+    }
+    compressed_end_ += raw;
+  }
+}
+
+auto TcpClient::decompress_metrics() const -> DecompressMetrics {
+  return decompressor_ == nullptr ? DecompressMetrics() : decompressor_->metrics();
+}
+
+auto TcpClient::ReceiveJSONs() -> Status {
+  free_->wait_dequeue(buffer_);
+  filled_ = 0;
+  complete_ = 0;
+  num_jsons_ = 0;
+
+  while (true) {
+    const auto capacity = buffer_->capacity();
+    if (filled_ == capacity) {
+      if (num_jsons_ == 0) {
+        return Status(Error::IOError, "Received JSON exceeds buffer capacity of " +
+                                          std::to_string(capacity) + " bytes.");
+      }
+      BOLSON_ROE(Dispatch());
+      continue;
+    }
+
+    bool ready = false;
+    BOLSON_ROE(WaitForData(&ready));
+    if (!ready) {
+      // The deadline of the oldest JSON in the buffer passed.
+      BOLSON_ROE(Dispatch());
+      continue;
+    }
+
+    auto* data = reinterpret_cast<char*>(buffer_->mutable_data());
+    size_t received = 0;
+    BOLSON_ROE(Receive(buffer_->mutable_data() + filled_, capacity - filled_, &received));
+
+    if (received == 0) {
+      // The server closed the connection. The last JSON may not be terminated.
+      if (filled_ > complete_) {
+        if (num_jsons_ == 0) oldest_ = illex::Timer::now();
+        complete_ = filled_;
+        num_jsons_++;
+      }
+      if (num_jsons_ > 0) {
+        BOLSON_ROE(Dispatch());
+      }
+      free_->enqueue(buffer_);
+      buffer_ = nullptr;
+      return Status::OK();
+    }
+
+    bytes_received_ += received;
+
+    // Find the end of the last complete JSON in the new data.
+    auto* last = static_cast<char*>(memrchr(data + filled_, '\n', received));
+    if (last != nullptr) {
+      if (num_jsons_ == 0) oldest_ = illex::Timer::now();
+      num_jsons_ += std::count(data + filled_, last + 1, '\n');
+      complete_ = last - data + 1;
+    }
+    filled_ += received;
+
+    if ((num_jsons_ > 0) && (max_delay_.count() == 0)) {
+      BOLSON_ROE(Dispatch());
+    }
+  }
+}
+
+auto TcpClient::Close() -> Status {
+  if (buffer_ != nullptr) {
+    buffer_->Reset();
+    free_->enqueue(buffer_);
+    buffer_ = nullptr;
+  }
+  if (fd_ >= 0) {
+    if (close(fd_) != 0) {
+      fd_ = -1;
+      return Status(Error::IOError, "Unable to close socket: " +
+                                        std::string(strerror(errno)));
+    }
+    fd_ = -1;
+  }
+  return Status::OK();
+}
+
+}  // namespace bolson::client
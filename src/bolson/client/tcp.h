@@ -0,0 +1,135 @@
+// Copyright 2020 Teratide B.V.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#pragma once
+
+#include <illex/protocol.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <vector>
+
+#include "bolson/client/client.h"
+#include "bolson/client/decompress.h"
+#include "bolson/parse/parser.h"
+#include "bolson/status.h"
+
+/// Size of the buffer compressed data is received into before decompressing.
+#define BOLSON_COMPRESSED_RECV_SIZE (256 * 1024)
+
+namespace bolson::client {
+
+/**
+ * \brief Open a TCP connection.
+ * \param opts The options specifying the host and port to connect to.
+ * \param fd   The resulting socket file descriptor.
+ * \return Status::OK() if successful, some error otherwise.
+ */
+auto Connect(const illex::ClientOptions& opts, int* fd) -> Status;
+
+/**
+ * \brief TCP client publishing filled buffers on the ready queue of a parser context.
+ *
+ * The client takes empty buffers from the free queue, fills them with newline-delimited
+ * JSONs and publishes them on the ready queue. Any trailing incomplete JSON is carried
+ * over to the next buffer.
+ *
+ * Without a maximum delay, a buffer is published as soon as it holds a complete JSON.
+ * Otherwise, the client keeps receiving into a buffer until it is full, or until its
+ * oldest JSON has waited for the maximum delay. The receive time of a published buffer
+ * is the time its oldest JSON was received.
+ *
+ * Multiple clients may share the buffers of one parser context, as long as they also
+ * share the sequence number counter, so that each receives a unique sequence range.
+ *
+ * If the stream is compressed, received data is staged and decompressed into the
+ * buffers, after which the JSONs are handled as if they were received uncompressed.
+ */
+class TcpClient : public Client {
+ public:
+  /**
+   * \brief Create a new TcpClient and connect to the server.
+   * \param opts    The client options.
+   * \param context The parser context providing the buffers and queues.
+   * \param out     The resulting client.
+   * \param seq     Sequence number counter shared with other clients, or nullptr.
+   * \param max_delay Maximum time the oldest JSON in a buffer waits to be published.
+   * \param compression The compression of the stream.
+   * \return Status::OK() if successful, some error otherwise.
+   */
+  static auto Make(const illex::ClientOptions& opts, parse::ParserContext* context,
+                   std::shared_ptr<Client>* out, std::atomic<uint64_t>* seq = nullptr,
+                   std::chrono::microseconds max_delay = std::chrono::microseconds(0),
+                   Compression compression = Compression::NONE) -> Status;
+
+  ~TcpClient() override;
+
+  auto ReceiveJSONs() -> Status override;
+  auto Close() -> Status override;
+  [[nodiscard]] auto bytes_received() const -> size_t override { return bytes_received_; }
+  [[nodiscard]] auto jsons_received() const -> size_t override { return jsons_received_; }
+  [[nodiscard]] auto decompress_metrics() const -> DecompressMetrics override;
+
+ private:
+  TcpClient(parse::ReadyQueue* ready, parse::BufferQueue* free)
+      : ready_(ready), free_(free) {}
+
+  /// \brief Publish the complete JSONs in the buffer, carry the rest to a new buffer.
+  auto Dispatch() -> Status;
+  /// \brief Wait for data until the deadline of the buffer, sets ready unless timed out.
+  auto WaitForData(bool* ready) -> Status;
+  /// \brief Receive raw data from the socket. Zero bytes means the connection closed.
+  auto ReceiveRaw(std::byte* out, size_t capacity, size_t* received) -> Status;
+  /// \brief Receive JSON data, decompressing it if needed.
+  auto Receive(std::byte* out, size_t capacity, size_t* received) -> Status;
+
+  /// The socket file descriptor.
+  int fd_ = -1;
+  /// The queue to publish filled buffers on.
+  parse::ReadyQueue* ready_ = nullptr;
+  /// The queue to obtain empty buffers from.
+  parse::BufferQueue* free_ = nullptr;
+  /// Maximum time the oldest JSON in a buffer waits to be published.
+  std::chrono::microseconds max_delay_{0};
+  /// The buffer currently being received into.
+  illex::JSONBuffer* buffer_ = nullptr;
+  /// Number of bytes in the buffer.
+  size_t filled_ = 0;
+  /// Number of bytes of complete JSONs in the buffer.
+  size_t complete_ = 0;
+  /// Number of complete JSONs in the buffer.
+  size_t num_jsons_ = 0;
+  /// Time the oldest complete JSON in the buffer was received.
+  illex::TimePoint oldest_;
+  /// Incomplete JSON carried over from a dispatched buffer to the next one.
+  std::vector<std::byte> tail_;
+  /// Decompressor of the stream, if compressed.
+  std::unique_ptr<StreamDecompressor> decompressor_;
+  /// Received compressed data.
+  std::vector<std::byte> compressed_;
+  /// Offset of the compressed data not decompressed yet.
+  size_t compressed_begin_ = 0;
+  /// Number of bytes of received compressed data.
+  size_t compressed_end_ = 0;
+  /// Sequence number of the next JSON, if not shared with other clients.
+  std::atomic<uint64_t> own_seq_ = 0;
+  /// Sequence number of the next JSON.
+  std::atomic<uint64_t>* seq_ = &own_seq_;
+  size_t bytes_received_ = 0;
+  size_t jsons_received_ = 0;
+};
+
+}  // namespace bolson::client
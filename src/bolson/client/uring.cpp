@@ -0,0 +1,291 @@
+// Copyright 2020 Teratide B.V.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "bolson/client/uring.h"
+
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <string>
+
+#include "bolson/client/tcp.h"
+
+namespace bolson::client {
+
+/// Tag in the user data of cancellation requests, to tell them apart from reads.
+static constexpr size_t kCancelTag = size_t(1) << 63;
+
+auto UringClient::Make(const std::vector<illex::ClientOptions>& connections,
+                       parse::ParserContext* context, std::shared_ptr<Client>* out,
+                       std::chrono::microseconds max_delay) -> Status {
+  // Every connection holds a buffer while receiving.
+  auto buffers = context->mutable_buffers();
+  if (buffers.size() < connections.size()) {
+    return Status(Error::GenericError,
+                  "Receiving from " + std::to_string(connections.size()) +
+                      " connections requires at least as many buffers, but only " +
+                      std::to_string(buffers.size()) + " are available.");
+  }
+
+  auto result = std::shared_ptr<UringClient>(
+      new UringClient(context->ready_queue(), context->free_queue()));
+  result->max_delay_ = max_delay;
+
+  // Every connection has at most one read and one cancellation in flight.
+  auto entries = static_cast<unsigned int>(std::max<size_t>(2 * connections.size(), 8));
+  auto err = io_uring_queue_init(entries, &result->ring_, 0);
+  if (err < 0) {
+    return Status(Error::IOError,
+                  "Unable to initialize io_uring: " + std::string(strerror(-err)));
+  }
+  result->ring_initialized_ = true;
+
+  // Register all buffers of the parser context.
+  std::vector<iovec> iovecs;
+  for (size_t b = 0; b < buffers.size(); b++) {
+    iovecs.push_back({buffers[b]->mutable_data(), buffers[b]->capacity()});
+    result->buffer_index_[buffers[b]] = static_cast<int>(b);
+  }
+  err = io_uring_register_buffers(&result->ring_, iovecs.data(), iovecs.size());
+  if (err < 0) {
+    return Status(Error::IOError,
+                  "Unable to register buffers with io_uring: " +
+                      std::string(strerror(-err)) +
+                      ". The locked memory limit (ulimit -l) may be too low.");
+  }
+
+  for (const auto& opts : connections) {
+    Connection connection;
+    BOLSON_ROE(Connect(opts, &connection.fd));
+    result->connections_.push_back(connection);
+  }
+
+  *out = result;
+  return Status::OK();
+}
+
+UringClient::~UringClient() {
+  Close();
+  if (ring_initialized_) {
+    io_uring_queue_exit(&ring_);
+  }
+}
+
+auto UringClient::Dispatch(size_t c) -> Status {
+  auto& conn = connections_[c];
+  // Stage the incomplete tail, so this buffer can be handed over before taking the next
+  // one. Otherwise connections holding all buffers wait on each other.
+  tail_.assign(conn.buffer->data() + conn.complete, conn.buffer->data() + conn.filled);
+
+  BILLEX_ROE(conn.buffer->SetSize(conn.complete));
+  conn.buffer->SetRange({seq_, seq_ + conn.num_jsons - 1});
+  conn.buffer->SetRecvTime(conn.oldest);
+  ready_->enqueue(conn.buffer);
+  seq_ += conn.num_jsons;
+  jsons_received_ += conn.num_jsons;
+
+  free_->wait_dequeue(conn.buffer);
+  std::memcpy(conn.buffer->mutable_data(), tail_.data(), tail_.size());
+  conn.filled = tail_.size();
+  conn.complete = 0;
+  conn.num_jsons = 0;
+  return Status::OK();
+}
+
+auto UringClient::UntilDeadline() -> std::chrono::nanoseconds {
+  auto result = std::chrono::nanoseconds(-1);
+  if (max_delay_.count() == 0) return result;
+  auto now = illex::Timer::now();
+  for (const auto& conn : connections_) {
+    if ((conn.buffer != nullptr) && (conn.num_jsons > 0) && !conn.cancelling) {
+      auto until = std::max(std::chrono::nanoseconds(0),
+                            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                conn.oldest + max_delay_ - now));
+      if ((result.count() < 0) || (until < result)) result = until;
+    }
+  }
+  return result;
+}
+
+void UringClient::CancelExpired() {
+  auto now = illex::Timer::now();
+  for (size_t c = 0; c < connections_.size(); c++) {
+    auto& conn = connections_[c];
+    if ((conn.buffer != nullptr) && (conn.num_jsons > 0) && !conn.cancelling &&
+        (conn.oldest + max_delay_ <= now)) {
+      auto* sqe = io_uring_get_sqe(&ring_);
+      if (sqe == nullptr) {
+        io_uring_submit(&ring_);
+        sqe = io_uring_get_sqe(&ring_);
+      }
+      io_uring_prep_cancel(sqe, reinterpret_cast<void*>(c), 0);
+      io_uring_sqe_set_data(sqe, reinterpret_cast<void*>(c | kCancelTag));
+      conn.cancelling = true;
+    }
+  }
+}
+
+auto UringClient::PrepareRead(size_t c) -> Status {
+  auto& conn = connections_[c];
+  auto* buffer = conn.buffer;
+  if (conn.filled >= buffer->capacity()) {
+    return Status(Error::IOError, "Received JSON exceeds buffer capacity of " +
+                                      std::to_string(buffer->capacity()) + " bytes.");
+  }
+  auto* sqe = io_uring_get_sqe(&ring_);
+  if (sqe == nullptr) {
+    io_uring_submit(&ring_);
+    sqe = io_uring_get_sqe(&ring_);
+  }
+  io_uring_prep_read_fixed(sqe, conn.fd, buffer->mutable_data() + conn.filled,
+                           buffer->capacity() - conn.filled, 0, buffer_index_.at(buffer));
+  io_uring_sqe_set_data(sqe, reinterpret_cast<void*>(c));
+  return Status::OK();
+}
+
+auto UringClient::Complete(size_t c, int result, bool* closed) -> Status {
+  auto& conn = connections_[c];
+  conn.cancelling = false;
+
+  if (result == -ECANCELED) {
+    // The deadline of the oldest JSON passed while the read was in flight.
+    if (conn.num_jsons > 0) {
+      BOLSON_ROE(Dispatch(c));
+    }
+    return PrepareRead(c);
+  }
+  if ((result == -EINTR) || (result == -EAGAIN)) {
+    return PrepareRead(c);
+  }
+  if (result < 0) {
+    return Status(Error::IOError, "Unable to receive: " + std::string(strerror(-result)));
+  }
+  if (result == 0) {
+    // The server closed the connection. The last JSON may not be terminated.
+    *closed = true;
+    if (conn.filled > conn.complete) {
+      if (conn.num_jsons == 0) conn.oldest = illex::Timer::now();
+      conn.complete = conn.filled;
+      conn.num_jsons++;
+    }
+    if (conn.num_jsons > 0) {
+      BOLSON_ROE(Dispatch(c));
+    }
+    free_->enqueue(conn.buffer);
+    conn.buffer = nullptr;
+    return Status::OK();
+  }
+
+  bytes_received_ += result;
+  auto* data = reinterpret_cast<char*>(conn.buffer->mutable_data());
+
+  // Find the end of the last complete JSON in the new data.
+  auto* last = static_cast<char*>(memrchr(data + conn.filled, '\n', result));
+  if (last != nullptr) {
+    if (conn.num_jsons == 0) conn.oldest = illex::Timer::now();
+    conn.num_jsons += std::count(data + conn.filled, last + 1, '\n');
+    conn.complete = last - data + 1;
+  }
+  conn.filled += result;
+
+  if ((conn.num_jsons > 0) &&
+      ((max_delay_.count() == 0) || (conn.filled == conn.buffer->capacity()) ||
+       (conn.oldest + max_delay_ <= illex::Timer::now()))) {
+    BOLSON_ROE(Dispatch(c));
+  }
+
+  return PrepareRead(c);
+}
+
+auto UringClient::ReceiveJSONs() -> Status {
+  size_t open = 0;
+  for (size_t c = 0; c < connections_.size(); c++) {
+    auto& conn = connections_[c];
+    free_->wait_dequeue(conn.buffer);
+    conn.filled = 0;
+    conn.complete = 0;
+    conn.num_jsons = 0;
+    BOLSON_ROE(PrepareRead(c));
+    open++;
+  }
+
+  while (open > 0) {
+    int err = 0;
+    auto until = UntilDeadline();
+    if (until.count() < 0) {
+      err = io_uring_submit_and_wait(&ring_, 1);
+    } else {
+      // Wait for completions at most until the earliest deadline.
+      io_uring_submit(&ring_);
+      __kernel_timespec timeout{until.count() / 1000000000, until.count() % 1000000000};
+      io_uring_cqe* cqe = nullptr;
+      err = io_uring_wait_cqe_timeout(&ring_, &cqe, &timeout);
+      if (err == -ETIME) {
+        CancelExpired();
+        continue;
+      }
+    }
+    if ((err < 0) && (err != -EINTR)) {
+      return Status(Error::IOError,
+                    "Unable to wait for io_uring: " + std::string(strerror(-err)));
+    }
+
+    // Handle all completions at once.
+    Status status = Status::OK();
+    io_uring_cqe* cqe = nullptr;
+    unsigned int head = 0;
+    unsigned int seen = 0;
+    io_uring_for_each_cqe(&ring_, head, cqe) {
+      seen++;
+      auto data = reinterpret_cast<size_t>(io_uring_cqe_get_data(cqe));
+      if ((data & kCancelTag) != 0) {
+        // Completion of a cancellation request. The read itself completes separately.
+        continue;
+      }
+      bool closed = false;
+      status = Complete(data, cqe->res, &closed);
+      if (!status.ok()) break;
+      if (closed) open--;
+    }
+    io_uring_cq_advance(&ring_, seen);
+    BOLSON_ROE(status);
+  }
+
+  return Status::OK();
+}
+
+auto UringClient::Close() -> Status {
+  Status result = Status::OK();
+  for (auto& conn : connections_) {
+    if (conn.buffer != nullptr) {
+      conn.buffer->Reset();
+      free_->enqueue(conn.buffer);
+      conn.buffer = nullptr;
+    }
+    if (conn.fd >= 0) {
+      if (close(conn.fd) != 0) {
+        result = Status(Error::IOError,
+                        "Unable to close socket: " + std::string(strerror(errno)));
+      }
+      conn.fd = -1;
+    }
+  }
+  return result;
+}
+
+}  // namespace bolson::client
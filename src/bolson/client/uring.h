@@ -0,0 +1,126 @@
+// Copyright 2020 Teratide B.V.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#pragma once
+
+#include <liburing.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "bolson/client/client.h"
+#include "bolson/parse/parser.h"
+#include "bolson/status.h"
+
+namespace bolson::client {
+
+/**
+ * \brief Client receiving from one or more TCP connections through a single io_uring.
+ *
+ * All buffers of the parser context are registered with the ring, so the kernel receives
+ * directly into them through fixed-buffer reads. Every connection has one read in flight,
+ * and the completions of all connections are reaped with a single system call.
+ *
+ * Like TcpClient, filled buffers are published on the ready queue of the parser context
+ * and empty buffers are taken from its free queue. Any trailing incomplete JSON is copied
+ * to the front of the next buffer before the next read is issued, which is why reads
+ * target a buffer chosen by the client rather than kernel-provided buffers.
+ *
+ * With a maximum delay, buffers are published when full or when their oldest JSON has
+ * waited for the maximum delay, like TcpClient. Because the kernel may still write into
+ * a buffer with a read in flight, an expired buffer is only published after its read is
+ * cancelled.
+ */
+class UringClient : public Client {
+ public:
+  /**
+   * \brief Create a new UringClient and connect to all endpoints.
+   * \param connections One entry per connection to open.
+   * \param context     The parser context providing the buffers and queues.
+   * \param out         The resulting client.
+   * \param max_delay   Maximum time the oldest JSON in a buffer waits to be published.
+   * \return Status::OK() if successful, some error otherwise.
+   */
+  static auto Make(const std::vector<illex::ClientOptions>& connections,
+                   parse::ParserContext* context, std::shared_ptr<Client>* out,
+                   std::chrono::microseconds max_delay = std::chrono::microseconds(0))
+      -> Status;
+
+  ~UringClient() override;
+
+  auto ReceiveJSONs() -> Status override;
+  auto Close() -> Status override;
+  [[nodiscard]] auto bytes_received() const -> size_t override { return bytes_received_; }
+  [[nodiscard]] auto jsons_received() const -> size_t override { return jsons_received_; }
+
+ private:
+  /// State of a single connection.
+  struct Connection {
+    /// The socket file descriptor.
+    int fd = -1;
+    /// The buffer currently being received into.
+    illex::JSONBuffer* buffer = nullptr;
+    /// Number of bytes in the buffer.
+    size_t filled = 0;
+    /// Number of bytes of complete JSONs in the buffer.
+    size_t complete = 0;
+    /// Number of complete JSONs in the buffer.
+    size_t num_jsons = 0;
+    /// Time the oldest complete JSON in the buffer was received.
+    illex::TimePoint oldest;
+    /// Whether the read in flight is being cancelled.
+    bool cancelling = false;
+  };
+
+  UringClient(parse::ReadyQueue* ready, parse::BufferQueue* free)
+      : ready_(ready), free_(free) {}
+
+  /// \brief Publish the complete JSONs of a connection, carry the rest to a new buffer.
+  auto Dispatch(size_t c) -> Status;
+  /// \brief Cancel reads of connections whose oldest JSON passed the deadline.
+  void CancelExpired();
+  /// \brief Return the time until the earliest deadline, or a negative time if none.
+  auto UntilDeadline() -> std::chrono::nanoseconds;
+  /// \brief Queue a read for a connection into the remainder of its buffer.
+  auto PrepareRead(size_t c) -> Status;
+  /// \brief Handle the completion of a read, sets closed if the connection was closed.
+  auto Complete(size_t c, int result, bool* closed) -> Status;
+
+  /// Maximum time the oldest JSON in a buffer waits to be published.
+  std::chrono::microseconds max_delay_{0};
+  /// The ring.
+  io_uring ring_{};
+  /// Whether the ring was initialized.
+  bool ring_initialized_ = false;
+  /// The connections.
+  std::vector<Connection> connections_;
+  /// Incomplete JSON carried over from a dispatched buffer to the next one.
+  std::vector<std::byte> tail_;
+  /// Index of each buffer in the registered buffers of the ring.
+  std::unordered_map<illex::JSONBuffer*, int> buffer_index_;
+  /// The queue to publish filled buffers on.
+  parse::ReadyQueue* ready_ = nullptr;
+  /// The queue to obtain empty buffers from.
+  parse::BufferQueue* free_ = nullptr;
+  /// Sequence number of the next JSON.
+  uint64_t seq_ = 0;
+  size_t bytes_received_ = 0;
+  size_t jsons_received_ = 0;
+};
+
+}  // namespace bolson::client
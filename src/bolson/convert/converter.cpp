@@ -20,6 +20,7 @@
 #include <cassert>
 #include <future>
 #include <memory>
+#include <optional>
 #include <thread>
 
 #include "bolson/convert/resizer.h"
@@ -31,6 +32,22 @@ namespace bolson::convert {
 
 auto Converter::metrics() const -> std::vector<Metrics> { return metrics_; }
 
+/// Access to the input buffers for converter threads.
+struct InputBuffers {
+  /// The handoff mechanism used to obtain and release buffers.
+  parse::Handoff handoff = parse::Handoff::QUEUE;
+  /// All input buffers.
+  std::vector<illex::JSONBuffer*> buffers;
+  /// The mutexes of all input buffers.
+  std::vector<std::mutex*> mutexes;
+  /// The queue to obtain filled buffers from.
+  parse::ReadyQueue* ready = nullptr;
+  /// The node of the ready queue to obtain filled buffers from first.
+  size_t node = 0;
+  /// The queue to return drained buffers to.
+  parse::BufferQueue* free = nullptr;
+};
+
 /**
  * \brief Attempt to get a lock on a buffer.
  * \param buffers   The buffers.
@@ -60,13 +77,43 @@ static auto TryGetFilledBuffer(const std::vector<illex::JSONBuffer*>& buffers,
   return false;
 }
 
-static void OneToOneConvertThread(size_t id, parse::Parser* parser, Resizer* resizer,
-                                  Serializer* serializer,
-                                  const std::vector<illex::JSONBuffer*>& buffers,
-                                  const std::vector<std::mutex*>& mutexes,
+/**
+ * \brief Attempt to obtain a filled buffer.
+ *
+ * With Handoff::QUEUE, this blocks for at most BOLSON_READY_QUEUE_WAIT_US until a buffer
+ * is published on the ready queue. With Handoff::MUTEX, this scans all buffers once.
+ *
+ * \param in       The input buffers.
+ * \param out      A pointer to the obtained buffer.
+ * \param lock_idx The lock index, only used with Handoff::MUTEX.
+ * \return True if a buffer was obtained, false otherwise.
+ */
+static auto TryGetFilledBuffer(const InputBuffers& in, illex::JSONBuffer** out,
+                               size_t* lock_idx) -> bool {
+  if (in.handoff == parse::Handoff::QUEUE) {
+    return in.ready->wait_dequeue_timed(
+        in.node, *out, std::chrono::microseconds(BOLSON_READY_QUEUE_WAIT_US));
+  }
+  return TryGetFilledBuffer(in.buffers, in.mutexes, out, lock_idx);
+}
+
+/// \brief Reset a buffer obtained through TryGetFilledBuffer and hand it back.
+static void ReleaseBuffer(const InputBuffers& in, illex::JSONBuffer* buffer,
+                          size_t lock_idx) {
+  buffer->Reset();
+  if (in.handoff == parse::Handoff::QUEUE) {
+    in.free->enqueue(buffer);
+  } else {
+    in.mutexes[lock_idx]->unlock();
+  }
+}
+
+static void OneToOneConvertThread(size_t id, parse::Parser* parser, const Filter* filter,
+                                  Resizer* resizer, Serializer* serializer,
+                                  const InputBuffers& in,
                                   publish::IpcQueue* out, std::atomic<bool>* shutdown,
                                   std::promise<Metrics>&& metrics_promise) {
-  assert(mutexes.size() == buffers.size());
+  assert(in.mutexes.size() == in.buffers.size());
   /// Macro to shut this thread and others down when something failed.
 #define SHUTDOWN_ON_FAILURE()                                                           \
   if (!metrics.status.ok()) {                                                           \
@@ -83,7 +130,7 @@ static void OneToOneConvertThread(size_t id, parse::Parser* parser, Resizer* res
   // Thread timer.
   putong::Timer<> t_thread(true);
   // Workload stage timer.
-  putong::SplitTimer<4> t_stages;
+  putong::SplitTimer<5> t_stages;
   // Latency time points.
   TimePoints lat;
   // Whether to try and unlock a buffer or to wait a bit.
@@ -96,7 +143,7 @@ static void OneToOneConvertThread(size_t id, parse::Parser* parser, Resizer* res
   while (!shutdown->load()) {
     if (try_buffers) {
       illex::JSONBuffer* buf = nullptr;
-      if (TryGetFilledBuffer(buffers, mutexes, &buf, &lock_idx)) {
+      if (TryGetFilledBuffer(in, &buf, &lock_idx)) {
         t_stages.Start();
         lat[TimePoints::received] = buf->recv_time();
 
@@ -107,22 +154,31 @@ static void OneToOneConvertThread(size_t id, parse::Parser* parser, Resizer* res
           SHUTDOWN_ON_FAILURE();
 
           // Add metrics before buffer is converted and reset.
-          metrics.num_jsons += parsed_batches[0].batch->num_rows();
+          for (const auto& pb : parsed_batches) {
+            metrics.num_jsons += pb.batch->num_rows();
+          }
           metrics.json_bytes += buf->size();
           metrics.num_parsed++;
-          // Reset and unlock the buffer.
-          buf->Reset();
-          mutexes[lock_idx]->unlock();
+          // Reset and hand back the buffer.
+          ReleaseBuffer(in, buf, lock_idx);
           lock_idx++;  // start at next buffer next time we try to unlock.
           lat[TimePoints::parsed] = illex::Timer::now();
         }
 
         t_stages.Split();
 
-        // Resize the batch.
+        // Filter the records.
+        {
+          metrics.status = filter->Apply(&parsed_batches, &metrics.num_filtered);
+          SHUTDOWN_ON_FAILURE();
+        }
+
+        t_stages.Split();
+
+        // Resize the batches.
         ResizedBatches resized;
         {
-          metrics.status = resizer->Resize(parsed_batches[0], &resized);
+          metrics.status = resizer->Resize(parsed_batches, &resized);
           SHUTDOWN_ON_FAILURE();
           // Mark time points resized for all batches.
           lat[TimePoints::resized] = illex::Timer::now();
@@ -158,10 +214,12 @@ static void OneToOneConvertThread(size_t id, parse::Parser* parser, Resizer* res
 
         // Add parse time to stats.
         metrics.t.parse += t_stages.seconds()[0];
-        metrics.t.resize += t_stages.seconds()[1];
-        metrics.t.serialize += t_stages.seconds()[2];
-        metrics.t.enqueue += t_stages.seconds()[3];
-      } else {
+        metrics.t.filter += t_stages.seconds()[1];
+        metrics.t.resize += t_stages.seconds()[2];
+        metrics.t.serialize += t_stages.seconds()[3];
+        metrics.t.enqueue += t_stages.seconds()[4];
+      } else if (in.handoff == parse::Handoff::MUTEX) {
+        // Nothing to do, wait a bit before scanning the buffers again.
         try_buffers = false;
       }
     } else {
@@ -177,7 +235,8 @@ static void OneToOneConvertThread(size_t id, parse::Parser* parser, Resizer* res
 #undef SHUTDOWN_ON_FAILURE
 }
 
-static void AllToOneConverterThread(size_t id, parse::Parser* parser, Resizer* resizer,
+static void AllToOneConverterThread(size_t id, parse::Parser* parser,
+                                    const Filter* filter, Resizer* resizer,
                                     Serializer* serializer,
                                     const std::vector<illex::JSONBuffer*>& buffers,
                                     const std::vector<std::mutex*>& mutexes,
@@ -202,7 +261,7 @@ static void AllToOneConverterThread(size_t id, parse::Parser* parser, Resizer* r
   // Thread timer.
   putong::Timer<> t_thread(true);
   // Workload stage timer.
-  putong::SplitTimer<4> t_stages;
+  putong::SplitTimer<5> t_stages;
   // Latency time points.
   TimePoints lat;
 
@@ -236,7 +295,9 @@ static void AllToOneConverterThread(size_t id, parse::Parser* parser, Resizer* r
         SHUTDOWN_ON_FAILURE();
 
         // Update metrics
-        metrics.num_jsons += parsed_batches[0].batch->num_rows();
+        for (const auto& pb : parsed_batches) {
+          metrics.num_jsons += pb.batch->num_rows();
+        }
         metrics.num_parsed += buffers.size();
 
         lat[TimePoints::received] = buffers[0]->recv_time();  // init with first buf time
@@ -255,14 +316,17 @@ static void AllToOneConverterThread(size_t id, parse::Parser* parser, Resizer* r
         t_stages.Split();
       }
 
+      // Filter the records.
+      {
+        metrics.status = filter->Apply(&parsed_batches, &metrics.num_filtered);
+        SHUTDOWN_ON_FAILURE();
+        t_stages.Split();
+      }
+
       // Resize the batch.
       ResizedBatches resized;
       {
-        for (auto pb : parsed_batches) {
-          ResizedBatches rb;
-          metrics.status = resizer->Resize(parsed_batches[0], &rb);
-          resized.insert(resized.end(), rb.begin(), rb.end());
-        }
+        metrics.status = resizer->Resize(parsed_batches, &resized);
         SHUTDOWN_ON_FAILURE();
         // Mark time points resized for all batches.
         lat[TimePoints::resized] = illex::Timer::now();
@@ -297,9 +361,10 @@ static void AllToOneConverterThread(size_t id, parse::Parser* parser, Resizer* r
 
       // Add parse time to stats.
       metrics.t.parse += t_stages.seconds()[0];
-      metrics.t.resize += t_stages.seconds()[1];
-      metrics.t.serialize += t_stages.seconds()[2];
-      metrics.t.enqueue += t_stages.seconds()[3];
+      metrics.t.filter += t_stages.seconds()[1];
+      metrics.t.resize += t_stages.seconds()[2];
+      metrics.t.serialize += t_stages.seconds()[3];
+      metrics.t.enqueue += t_stages.seconds()[4];
     }
 
     std::this_thread::sleep_for(std::chrono::microseconds(BOLSON_QUEUE_WAIT_US));
@@ -312,10 +377,207 @@ static void AllToOneConverterThread(size_t id, parse::Parser* parser, Resizer* r
 #undef SHUTDOWN_ON_FAILURE
 }
 
+/**
+ * \brief Convert with an asynchronous parser, overlapping host work with the device.
+ *
+ * The buffers are split in two sets. While the device parses one set, the batch parsed
+ * from the other set is filtered, resized, serialized and enqueued, and the other set is
+ * handed back to be filled again.
+ */
+static void PipelinedConverterThread(size_t id, parse::AsyncParser* parser,
+                                     const Filter* filter, Resizer* resizer,
+                                     Serializer* serializer,
+                                     const std::vector<illex::JSONBuffer*>& buffers,
+                                     const std::vector<std::mutex*>& mutexes,
+                                     publish::IpcQueue* out, std::atomic<bool>* shutdown,
+                                     std::promise<Metrics>&& metrics_promise) {
+  assert(mutexes.size() == buffers.size());
+  assert(buffers.size() % 2 == 0);
+  /// Macro to shut this thread and others down when something failed. The run in flight
+  /// is finished first, so that no buffers are left locked or being written to.
+#define SHUTDOWN_ON_FAILURE()                                                           \
+  if (!metrics.status.ok()) {                                                           \
+    finish_in_flight();                                                                 \
+    t_thread.Stop();                                                                    \
+    metrics.t.thread = t_thread.seconds();                                              \
+    SPDLOG_DEBUG("Thread {:2} | terminating with error: {}", id, metrics.status.msg()); \
+    metrics_promise.set_value(metrics);                                                 \
+    shutdown->store(true);                                                              \
+    return;                                                                             \
+  }                                                                                     \
+  void()
+
+  Metrics metrics;
+  metrics.num_threads = 1;
+
+  // Thread timer.
+  putong::Timer<> t_thread(true);
+  // Workload stage timer.
+  putong::SplitTimer<5> t_stages;
+
+  const size_t set_size = buffers.size() / 2;
+  // The set to submit next, and the set the device is parsing, if any.
+  size_t next_set = 0;
+  std::optional<size_t> in_flight;
+  // Latency time points of the set the device is parsing.
+  TimePoints in_flight_lat;
+
+  // Unlock the buffers of a set.
+  auto unlock_set = [&](size_t set) {
+    for (size_t i = set * set_size; i < (set + 1) * set_size; i++) {
+      mutexes[i]->unlock();
+    }
+  };
+
+  // Reset and unlock the buffers of a set that the device is done with. Only count the
+  // buffers as parsed if the run succeeded.
+  auto release_set = [&](size_t set, bool parsed) {
+    for (size_t i = set * set_size; i < (set + 1) * set_size; i++) {
+      if (parsed) metrics.json_bytes += buffers[i]->size();
+      buffers[i]->Reset();
+    }
+    unlock_set(set);
+    if (parsed) metrics.num_parsed += set_size;
+  };
+
+  // Wait for the run in flight, if any, and release its set.
+  auto finish_in_flight = [&]() -> Status {
+    if (!in_flight) return Status::OK();
+    auto status = parser->Wait();
+    release_set(*in_flight, status.ok());
+    in_flight.reset();
+    return status;
+  };
+
+  SPDLOG_DEBUG("Thread {:2} | Spawned.", id);
+
+  while (!shutdown->load()) {
+    // Obtain a lock on the next set, and check if there is anything to submit.
+    const auto first = buffers.begin() + next_set * set_size;
+    std::vector<illex::JSONBuffer*> set(first, first + set_size);
+    bool empty = true;
+    for (size_t i = 0; i < set_size; i++) {
+      mutexes[next_set * set_size + i]->lock();
+      empty = empty && set[i]->empty();
+    }
+    if (empty) {
+      unlock_set(next_set);
+      // Without a run to finish, check the other set after waiting a bit, since the
+      // buffers may have been filled in any order.
+      if (!in_flight) {
+        next_set = (next_set + 1) % 2;
+        std::this_thread::sleep_for(std::chrono::microseconds(BOLSON_QUEUE_WAIT_US));
+        continue;
+      }
+    }
+
+    t_stages.Start();
+
+    // Prepare intermediate wrappers.
+    std::vector<parse::ParsedBatch> parsed_batches;
+    TimePoints lat = in_flight_lat;
+
+    // Finish the run in flight, submit the next one, and collect the finished batch.
+    {
+      metrics.status = finish_in_flight();
+      if (!metrics.status.ok() && !empty) unlock_set(next_set);
+      SHUTDOWN_ON_FAILURE();
+
+      if (!empty) {
+        // Mark worst-case latency time point for the output batch.
+        in_flight_lat[TimePoints::received] = set[0]->recv_time();
+        for (const auto* buf : set) {
+          if (buf->recv_time() < in_flight_lat[TimePoints::received]) {
+            in_flight_lat[TimePoints::received] = buf->recv_time();
+          }
+        }
+        metrics.status = parser->Submit(set);
+        if (!metrics.status.ok()) unlock_set(next_set);
+        SHUTDOWN_ON_FAILURE();
+        in_flight = next_set;
+        next_set = (next_set + 1) % 2;
+      }
+
+      metrics.status = parser->Collect(&parsed_batches);
+      SHUTDOWN_ON_FAILURE();
+      for (const auto& pb : parsed_batches) {
+        metrics.num_jsons += pb.batch->num_rows();
+      }
+
+      lat[TimePoints::parsed] = illex::Timer::now();
+      t_stages.Split();
+    }
+
+    // Filter the records.
+    {
+      metrics.status = filter->Apply(&parsed_batches, &metrics.num_filtered);
+      SHUTDOWN_ON_FAILURE();
+      t_stages.Split();
+    }
+
+    // Resize the batch.
+    ResizedBatches resized;
+    {
+      metrics.status = resizer->Resize(parsed_batches, &resized);
+      SHUTDOWN_ON_FAILURE();
+      // Mark time points resized for all batches.
+      lat[TimePoints::resized] = illex::Timer::now();
+      t_stages.Split();
+    }
+
+    // Serialize the batch.
+    SerializedBatches serialized;
+    {
+      metrics.status = serializer->Serialize(resized, &serialized);
+      SHUTDOWN_ON_FAILURE();
+      metrics.num_ipc += serialized.size();
+      metrics.ipc_bytes += ByteSizeOf(serialized);
+      // Mark time points serialized for all batches.
+      lat[TimePoints::serialized] = illex::Timer::now();
+      // Copy the latency statistics to all serialized batches.
+      for (auto& s : serialized) {
+        s.time_points = lat;
+      }
+      t_stages.Split();
+    }
+
+    // Enqueue IPC items
+    {
+      for (const auto& sb : serialized) {
+        out->enqueue(sb);
+      }
+    }
+    t_stages.Split();
+
+    // Add parse time to stats.
+    metrics.t.parse += t_stages.seconds()[0];
+    metrics.t.filter += t_stages.seconds()[1];
+    metrics.t.resize += t_stages.seconds()[2];
+    metrics.t.serialize += t_stages.seconds()[3];
+    metrics.t.enqueue += t_stages.seconds()[4];
+  }
+
+  // Don't leave the device writing to buffers that are about to be freed.
+  metrics.status = finish_in_flight();
+
+  t_thread.Stop();
+  metrics.t.thread = t_thread.seconds();
+  metrics_promise.set_value(metrics);
+  SPDLOG_DEBUG("Thread {:2} | Terminating.", id);
+#undef SHUTDOWN_ON_FAILURE
+}
+
 auto Converter::Start(std::atomic<bool>* shutdown) -> Status {
   shutdown_ = shutdown;
   auto buffers = parser_context()->mutable_buffers().size();
 
+  InputBuffers in;
+  in.handoff = handoff_;
+  in.buffers = parser_context_->mutable_buffers();
+  in.mutexes = parser_context_->mutexes();
+  in.ready = parser_context_->ready_queue();
+  in.free = parser_context_->free_queue();
+
   if ((num_threads_ > 1) || ((num_threads_ == 1) && (buffers == 1))) {
     SPDLOG_DEBUG("Spawning {} one-to-one parser threads.", num_threads_);
     // One to one parsers, spawn as many threads as parser context allows, and give each
@@ -323,22 +585,46 @@ auto Converter::Start(std::atomic<bool>* shutdown) -> Status {
     for (int t = 0; t < num_threads_; t++) {
       std::promise<Metrics> m;
       metrics_futures_.push_back(m.get_future());
-      threads_.emplace_back(
-          OneToOneConvertThread, t, parser_context_->parsers()[t].get(), &resizers_[t],
-          &serializers_[t], parser_context_->mutable_buffers(),
-          parser_context_->mutexes(), output_queue_, shutdown_, std::move(m));
+      if (topology_) {
+        in.node = topology_->node(t);
+      }
+      threads_.emplace_back(OneToOneConvertThread, t, parser_context_->parsers()[t].get(),
+                            &filters_[t], &resizers_[t], &serializers_[t], in,
+                            output_queue_, shutdown_, std::move(m));
+      if (topology_) {
+        WarnOnPlacementFailure(PinThread(&threads_.back(), topology_->nodes[in.node]));
+      }
+    }
+  } else if (auto* async =
+                 dynamic_cast<parse::AsyncParser*>(parser_context_->parsers()[0].get());
+             (num_threads_ == 1) && (async != nullptr) &&
+             (async->num_output_sets() > 1) && (buffers % 2 == 0)) {
+    SPDLOG_DEBUG("Spawning one pipelined many-to-one parser thread.");
+    // Many to one parser that can submit one half of the buffers while the batch of the
+    // other half is processed.
+    assert(handoff_ == parse::Handoff::MUTEX);
+    std::promise<Metrics> m;
+    metrics_futures_.push_back(m.get_future());
+    threads_.emplace_back(PipelinedConverterThread, 0, async, &filters_[0],
+                          &resizers_[0], &serializers_[0], in.buffers, in.mutexes,
+                          output_queue_, shutdown_, std::move(m));
+    if (topology_) {
+      WarnOnPlacementFailure(PinThread(&threads_.back(), topology_->nodes[0]));
     }
   } else if (num_threads_ == 1) {
     SPDLOG_DEBUG("Spawning one many-to-one parser thread.");
     // Many to one parsers, spawn one thread, give the thread the only parser.
     // This parser can operate on all input buffers.
     assert(parser_context()->parsers().size() == 1);
+    assert(handoff_ == parse::Handoff::MUTEX);
     std::promise<Metrics> m;
     metrics_futures_.push_back(m.get_future());
     threads_.emplace_back(AllToOneConverterThread, 0, parser_context_->parsers()[0].get(),
-                          &resizers_[0], &serializers_[0],
-                          parser_context_->mutable_buffers(), parser_context_->mutexes(),
-                          output_queue_, shutdown_, std::move(m));
+                          &filters_[0], &resizers_[0], &serializers_[0], in.buffers,
+                          in.mutexes, output_queue_, shutdown_, std::move(m));
+    if (topology_) {
+      WarnOnPlacementFailure(PinThread(&threads_.back(), topology_->nodes[0]));
+    }
   }
   return Status::OK();
 }
@@ -352,6 +638,8 @@ auto Converter::Finish() -> MultiThreadStatus {
       threads_[t].join();
       // Get the metrics.
       auto metric = metrics_futures_[t].get();
+      metric.pool = pools_[t]->metrics();
+      metric.wait = parser_context_->parsers()[t]->wait_metrics();
       metrics_.push_back(metric);
       result.push_back(metric.status);
       // If a thread returned an error status, shut everything down.
@@ -366,21 +654,54 @@ auto Converter::Finish() -> MultiThreadStatus {
 auto Converter::Make(const ConverterOptions& opts, publish::IpcQueue* ipc_queue,
                      std::shared_ptr<Converter>* out) -> Status {
   std::shared_ptr<parse::ParserContext> parser_context;
+  std::vector<Filter> filters;
   std::vector<Resizer> resizers;
   std::vector<Serializer> serializers;
 
+  // Only the parsers driven by the Arrow options can project their schema.
+  if (!opts.parser.arrow.columns.empty() && (opts.parser.impl != parse::Impl::ARROW) &&
+      (opts.parser.impl != parse::Impl::SIMDJSON) &&
+      (opts.parser.impl != parse::Impl::RAPIDJSON)) {
+    return Status(Error::GenericError, "Column projection is not supported by the " +
+                                           ToString(opts.parser.impl) + " parser.");
+  }
+
+  // Buffers placed on NUMA nodes must not share pages with other memory, which would be
+  // moved along.
+  auto arrow_opts = opts.parser.arrow;
+  arrow_opts.buf_page_aligned |= opts.placement == Placement::NUMA;
+
   // Determine which parser and allocator implementation to use.
   switch (opts.parser.impl) {
     case parse::Impl::ARROW:
-      BOLSON_ROE(parse::ArrowParserContext::Make(opts.parser.arrow, opts.num_threads,
+      BOLSON_ROE(parse::ArrowParserContext::Make(arrow_opts, opts.num_threads,
                                                  &parser_context));
       break;
+    case parse::Impl::SIMDJSON:
+      BOLSON_ROE(parse::SimdParserContext::Make(arrow_opts, opts.num_threads,
+                                                &parser_context));
+      break;
+    case parse::Impl::RAPIDJSON:
+      BOLSON_ROE(parse::RapidJSONParserContext::Make(arrow_opts, opts.num_threads,
+                                                     &parser_context));
+      break;
+    case parse::Impl::CPU_BATTERY:
+      BOLSON_ROE(parse::cpu::BatteryParserContext::Make(arrow_opts, opts.num_threads,
+                                                        &parser_context));
+      break;
+    case parse::Impl::CPU_TRIP:
+      BOLSON_ROE(parse::cpu::TripParserContext::Make(arrow_opts, opts.num_threads,
+                                                     &parser_context));
+      break;
     case parse::Impl::OPAE_BATTERY:
-      BOLSON_ROE(
-          parse::opae::BatteryParserContext::Make(opts.parser.battery, &parser_context));
+      BOLSON_ROE(parse::opae::BatteryParserContext::Make(
+          opts.parser.battery, opts.parser.opae_platform, opts.parser.opae_wait,
+          &parser_context));
       break;
     case parse::Impl::OPAE_TRIP:
-      BOLSON_ROE(parse::opae::TripParserContext::Make(opts.parser.trip, &parser_context));
+      BOLSON_ROE(parse::opae::TripParserContext::Make(
+          opts.parser.trip, opts.parser.opae_platform, opts.parser.opae_wait,
+          &parser_context));
       break;
   }
 
@@ -391,16 +712,71 @@ auto Converter::Make(const ConverterOptions& opts, publish::IpcQueue* ipc_queue,
                  opts.num_threads, num_threads);
   }
 
-  // Set up Resizers and Serializers.
+  // The many-to-one thread needs all buffers at once, which it can only obtain by
+  // locking them.
+  auto handoff = opts.handoff;
+  auto num_buffers = parser_context->mutable_buffers().size();
+  if ((handoff == parse::Handoff::QUEUE) && (num_threads == 1) && (num_buffers > 1)) {
+    spdlog::warn("One converter thread for {} buffers requires mutex buffer handoff.",
+                 num_buffers);
+    handoff = parse::Handoff::MUTEX;
+  }
+
+  // Place the buffers on the NUMA nodes, if desired. Threads are pinned when started.
+  std::optional<Topology> topology;
+  if (opts.placement == Placement::NUMA) {
+    topology = Topology();
+    BOLSON_ROE(Topology::Detect(&*topology));
+    spdlog::info("Placing converter threads and buffers on {}.", topology->ToString());
+    auto status = parser_context->PlaceBuffers(*topology);
+    if (!status.ok()) {
+      spdlog::warn("{} Buffers are placed on first touch.", status.msg());
+    }
+  }
+
+  // Parse the filter predicates. Filters see the parsed values, dictionaries are only
+  // encoded when serializing.
+  std::vector<Predicate> predicates;
+  BOLSON_ROE(ParsePredicates(opts.filter, &predicates));
+  auto output_schema = parser_context->output_schema();
+  std::shared_ptr<arrow::Schema> parsed_schema;
+  BOLSON_ROE(parse::DecodeDictionaries(*output_schema, &parsed_schema));
+
+  // Set up a memory pool for every thread, to parse and serialize batches with. Until
+  // the converter owns the pools, release them if anything fails.
+  std::vector<buffer::ThreadMemoryPool*> pools;
+  auto release_on_error = [&pools](Status status) -> Status {
+    if (!status.ok()) {
+      for (auto* pool : pools) {
+        buffer::ThreadMemoryPool::Release(pool);
+      }
+    }
+    return status;
+  };
+  auto parsers = parser_context->parsers();
   for (size_t t = 0; t < num_threads; t++) {
+    buffer::ThreadMemoryPool* pool = nullptr;
+    BOLSON_ROE(release_on_error(buffer::ThreadMemoryPool::Make(opts.pool, &pool)));
+    pools.push_back(pool);
+    BOLSON_ROE(release_on_error(parsers[t]->set_memory_pool(pool)));
+  }
+
+  // Set up Filters, Resizers and Serializers.
+  for (size_t t = 0; t < num_threads; t++) {
+    Filter filter;
+    BOLSON_ROE(
+        release_on_error(Filter::Make(predicates, *parsed_schema, pools[t], &filter)));
+    filters.push_back(std::move(filter));
     resizers.emplace_back(opts.max_batch_rows);
-    serializers.emplace_back(opts.max_ipc_size);
+    serializers.emplace_back(opts.max_ipc_size, pools[t], output_schema);
   }
 
   // Create the converter.
   auto result = std::shared_ptr<convert::Converter>(new convert::Converter(
-      parser_context, resizers, serializers, ipc_queue, num_threads));
+      parser_context, filters, resizers, serializers, pools, ipc_queue, num_threads,
+      handoff));
 
+  result->topology_ = topology;
   *out = std::move(result);
 
   return Status::OK();
@@ -410,19 +786,44 @@ auto Converter::parser_context() const -> std::shared_ptr<parse::ParserContext>
   return parser_context_;
 }
 
+auto Converter::handoff() const -> parse::Handoff { return handoff_; }
+
+auto Converter::topology() const -> const Topology* {
+  return topology_ ? &*topology_ : nullptr;
+}
+
 Converter::Converter(std::shared_ptr<parse::ParserContext> parser_context,
+                     std::vector<convert::Filter> filters,
                      std::vector<convert::Resizer> resizers,
                      std::vector<convert::Serializer> serializers,
-                     publish::IpcQueue* output_queue, size_t num_threads)
+                     std::vector<buffer::ThreadMemoryPool*> pools,
+                     publish::IpcQueue* output_queue, size_t num_threads,
+                     parse::Handoff handoff)
     : parser_context_(std::move(parser_context)),
+      filters_(std::move(filters)),
       resizers_(std::move(resizers)),
       serializers_(std::move(serializers)),
+      pools_(std::move(pools)),
       output_queue_(output_queue),
-      num_threads_(num_threads) {
+      num_threads_(num_threads),
+      handoff_(handoff) {
   assert(output_queue_ != nullptr);
   assert(num_threads_ != 0);
 }
 
+Converter::~Converter() {
+  // The parser context may outlive the converter, so detach the pools from its parsers.
+  for (const auto& parser : parser_context_->parsers()) {
+    auto status = parser->set_memory_pool(arrow::default_memory_pool());
+    if (!status.ok()) {
+      spdlog::warn("Unable to detach memory pool from parser: {}", status.msg());
+    }
+  }
+  for (auto* pool : pools_) {
+    buffer::ThreadMemoryPool::Release(pool);
+  }
+}
+
 // Sequence number field.
 static inline auto SeqField() -> std::shared_ptr<arrow::Field> {
   static auto seq_field = arrow::field("seq", arrow::uint64(), false);
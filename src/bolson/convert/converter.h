@@ -19,9 +19,12 @@
 #include <utility>
 
 #include "bolson/buffer/allocator.h"
+#include "bolson/buffer/memory_pool.h"
+#include "bolson/convert/filter.h"
 #include "bolson/convert/metrics.h"
 #include "bolson/convert/resizer.h"
 #include "bolson/convert/serializer.h"
+#include "bolson/numa.h"
 #include "bolson/parse/arrow.h"
 #include "bolson/parse/implementations.h"
 #include "bolson/parse/opae/battery.h"
@@ -44,6 +47,14 @@ struct ConverterOptions {
   size_t max_ipc_size = 0;
   /// Maximum number of rows in a RecordBatch.
   size_t max_batch_rows = 0;
+  /// Mechanism to obtain filled input buffers.
+  parse::Handoff handoff = parse::Handoff::QUEUE;
+  /// Options for the memory pool of every converter thread.
+  buffer::MemoryPoolOptions pool;
+  /// Placement of the converter threads and input buffers.
+  Placement placement = Placement::NONE;
+  /// Filter expressions records must match to be published. Empty = all records.
+  std::vector<std::string> filter;
 
   /// Parser options.
   parse::ParserOptions parser;
@@ -92,15 +103,32 @@ class Converter {
   /// \brief Return the parser context.
   [[nodiscard]] auto parser_context() const -> std::shared_ptr<parse::ParserContext>;
 
+  /**
+   * \brief Return the buffer handoff mechanism used by the converter threads.
+   *
+   * This may differ from the handoff mechanism requested through the options, in case
+   * the thread configuration does not support it. Clients filling the input buffers
+   * must use the mechanism returned by this function.
+   */
+  [[nodiscard]] auto handoff() const -> parse::Handoff;
+
+  /// \brief Return the topology threads and buffers are placed on, or nullptr if none.
+  [[nodiscard]] auto topology() const -> const Topology*;
+
   /// \brief Return converter metrics.
   [[nodiscard]] auto metrics() const -> std::vector<Metrics>;
 
+  /// \brief Release the memory pools of the converter threads.
+  ~Converter();
+
  protected:
   /// Converter constructor.
   Converter(std::shared_ptr<parse::ParserContext> parser_context,
+            std::vector<convert::Filter> filters,
             std::vector<convert::Resizer> resizers,
-            std::vector<convert::Serializer> serializers, publish::IpcQueue* output_queue,
-            size_t num_threads = 1);
+            std::vector<convert::Serializer> serializers,
+            std::vector<buffer::ThreadMemoryPool*> pools, publish::IpcQueue* output_queue,
+            size_t num_threads = 1, parse::Handoff handoff = parse::Handoff::QUEUE);
 
   /// The output queue.
   publish::IpcQueue* output_queue_ = nullptr;
@@ -108,14 +136,22 @@ class Converter {
   std::atomic<bool>* shutdown_ = nullptr;
   /// Number of threads.
   size_t num_threads_ = 1;
+  /// Buffer handoff mechanism.
+  parse::Handoff handoff_ = parse::Handoff::QUEUE;
   /// Converter threads.
   std::vector<std::thread> threads_;
   /// Parser manager implementations.
   std::shared_ptr<parse::ParserContext> parser_context_;
+  /// Filter instances.
+  std::vector<convert::Filter> filters_;
   /// Resizer instances.
   std::vector<convert::Resizer> resizers_;
   /// Serializer instances.
   std::vector<convert::Serializer> serializers_;
+  /// Memory pools of the converter threads.
+  std::vector<buffer::ThreadMemoryPool*> pools_;
+  /// Topology threads and buffers are placed on, if any.
+  std::optional<Topology> topology_;
   /// Metrics of converter thread(s).
   std::vector<Metrics> metrics_;
   /// Metrics futures of running threads.
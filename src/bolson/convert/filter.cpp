@@ -0,0 +1,211 @@
+// Copyright 2020 Teratide B.V.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "bolson/convert/filter.h"
+
+#include <arrow/compute/api.h>
+
+#include <utility>
+
+namespace bolson::convert {
+
+auto ToString(CompareOp op) -> std::string {
+  switch (op) {
+    case CompareOp::EQ:
+      return "==";
+    case CompareOp::NE:
+      return "!=";
+    case CompareOp::LT:
+      return "<";
+    case CompareOp::LE:
+      return "<=";
+    case CompareOp::GT:
+      return ">";
+    case CompareOp::GE:
+      return ">=";
+  }
+  return "Corrupt bolson::convert::CompareOp enum value.";
+}
+
+/// \brief Return the name of the Arrow compute function implementing a comparison.
+static auto FunctionOf(CompareOp op) -> std::string {
+  switch (op) {
+    case CompareOp::EQ:
+      return "equal";
+    case CompareOp::NE:
+      return "not_equal";
+    case CompareOp::LT:
+      return "less";
+    case CompareOp::LE:
+      return "less_equal";
+    case CompareOp::GT:
+      return "greater";
+    case CompareOp::GE:
+      return "greater_equal";
+  }
+  return "";
+}
+
+/// \brief Return a string without leading and trailing whitespace.
+static auto Trim(const std::string& str) -> std::string {
+  auto first = str.find_first_not_of(" \t");
+  if (first == std::string::npos) return "";
+  auto last = str.find_last_not_of(" \t");
+  return str.substr(first, last - first + 1);
+}
+
+auto Predicate::Parse(const std::string& str, Predicate* out) -> Status {
+  auto pos = str.find_first_of("=!<>");
+  if (pos == std::string::npos) {
+    return Status(Error::CLIError, "Filter predicate \"" + str + "\" has no operator.");
+  }
+  auto has_eq = (pos + 1 < str.size()) && (str[pos + 1] == '=');
+  size_t op_size = has_eq ? 2 : 1;
+  switch (str[pos]) {
+    case '=':
+      if (!has_eq) {
+        return Status(Error::CLIError, "Filter predicate \"" + str + "\" uses \"=\", " +
+                                           "use \"==\" to test equality.");
+      }
+      out->op = CompareOp::EQ;
+      break;
+    case '!':
+      if (!has_eq) {
+        return Status(Error::CLIError, "Filter predicate \"" + str + "\" uses \"!\".");
+      }
+      out->op = CompareOp::NE;
+      break;
+    case '<':
+      out->op = has_eq ? CompareOp::LE : CompareOp::LT;
+      break;
+    default:
+      out->op = has_eq ? CompareOp::GE : CompareOp::GT;
+      break;
+  }
+  out->field = Trim(str.substr(0, pos));
+  out->literal = Trim(str.substr(pos + op_size));
+  if (out->field.empty() || out->literal.empty()) {
+    return Status(Error::CLIError,
+                  "Filter predicate \"" + str + "\" is not of the form <field> <op> " +
+                      "<literal>.");
+  }
+  // Strip quotes.
+  const auto& lit = out->literal;
+  if ((lit.size() >= 2) && ((lit.front() == '"') || (lit.front() == '\'')) &&
+      (lit.back() == lit.front())) {
+    out->literal = lit.substr(1, lit.size() - 2);
+  }
+  return Status::OK();
+}
+
+auto Predicate::ToString() const -> std::string {
+  return field + " " + convert::ToString(op) + " " + literal;
+}
+
+auto ParsePredicates(const std::vector<std::string>& exprs, std::vector<Predicate>* out)
+    -> Status {
+  for (const auto& expr : exprs) {
+    size_t begin = 0;
+    while (begin <= expr.size()) {
+      auto end = expr.find("&&", begin);
+      if (end == std::string::npos) end = expr.size();
+      Predicate predicate;
+      BOLSON_ROE(Predicate::Parse(expr.substr(begin, end - begin), &predicate));
+      out->push_back(predicate);
+      begin = end + 2;
+    }
+  }
+  return Status::OK();
+}
+
+void AddFilterOptionToCLI(CLI::App* sub, std::vector<std::string>* out) {
+  sub->add_option("--filter", *out,
+                  "Only publish records for which all predicates hold, e.g. "
+                  "\"avgspeed > 0\". Predicates compare a top-level field with a literal "
+                  "using ==, !=, <, <=, > or >=, and may be joined with \"&&\". May be "
+                  "supplied multiple times.");
+}
+
+auto Filter::Make(const std::vector<Predicate>& predicates, const arrow::Schema& schema,
+                  arrow::MemoryPool* pool, Filter* out) -> Status {
+  Filter result;
+  result.pool_ = pool;
+  for (const auto& p : predicates) {
+    auto field = schema.GetFieldByName(p.field);
+    if (field == nullptr) {
+      return Status(Error::GenericError,
+                    "Filter field \"" + p.field + "\" is not a unique field of schema: " +
+                        schema.ToString());
+    }
+    auto literal = arrow::Scalar::Parse(field->type(), p.literal);
+    if (!literal.ok()) {
+      return Status(Error::GenericError, "Unable to compare field \"" + p.field +
+                                             "\" with \"" + p.literal +
+                                             "\": " + literal.status().message());
+    }
+    result.terms_.push_back({p.field, FunctionOf(p.op), literal.ValueOrDie()});
+  }
+  *out = std::move(result);
+  return Status::OK();
+}
+
+auto Filter::Mask(const arrow::RecordBatch& batch, arrow::Datum* out) const -> Status {
+  arrow::compute::ExecContext ctx(pool_);
+  for (const auto& term : terms_) {
+    auto column = batch.GetColumnByName(term.field);
+    if (column == nullptr) {
+      return Status(Error::GenericError,
+                    "Batch has no column \"" + term.field + "\" to filter on.");
+    }
+    auto compared = arrow::compute::CallFunction(
+        term.function, {arrow::Datum(column), arrow::Datum(term.literal)}, &ctx);
+    if (!compared.ok()) {
+      return Status(Error::ArrowError, compared.status().message());
+    }
+    if (out->is_value()) {
+      auto combined = arrow::compute::And(*out, compared.ValueOrDie(), &ctx);
+      if (!combined.ok()) {
+        return Status(Error::ArrowError, combined.status().message());
+      }
+      *out = combined.ValueOrDie();
+    } else {
+      *out = compared.ValueOrDie();
+    }
+  }
+  return Status::OK();
+}
+
+auto Filter::Apply(std::vector<parse::ParsedBatch>* batches, size_t* discarded) const
+    -> Status {
+  if (terms_.empty()) {
+    return Status::OK();
+  }
+  arrow::compute::ExecContext ctx(pool_);
+  for (auto& parsed : *batches) {
+    arrow::Datum mask;
+    BOLSON_ROE(Mask(*parsed.batch, &mask));
+    auto filtered = arrow::compute::Filter(
+        parsed.batch, mask, arrow::compute::FilterOptions::Defaults(), &ctx);
+    if (!filtered.ok()) {
+      return Status(Error::ArrowError, filtered.status().message());
+    }
+    auto batch = filtered.ValueOrDie().record_batch();
+    *discarded += parsed.batch->num_rows() - batch->num_rows();
+    // Keep the sequence number range, the discarded records are still accounted for.
+    parsed.batch = batch;
+  }
+  return Status::OK();
+}
+
+}  // namespace bolson::convert
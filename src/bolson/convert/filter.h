@@ -0,0 +1,127 @@
+// Copyright 2020 Teratide B.V.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <arrow/api.h>
+
+#include <CLI/CLI.hpp>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "bolson/parse/parser.h"
+#include "bolson/status.h"
+
+namespace bolson::convert {
+
+/// Comparison operators of filter predicates.
+enum class CompareOp { EQ, NE, LT, LE, GT, GE };
+
+/// \brief Return the symbol of a comparison operator.
+auto ToString(CompareOp op) -> std::string;
+
+/// A predicate comparing a top-level field of a record with a literal.
+struct Predicate {
+  /// Name of the field.
+  std::string field;
+  /// Comparison operator.
+  CompareOp op = CompareOp::EQ;
+  /// The literal to compare the field with, parsed according to the type of the field.
+  std::string literal;
+
+  /**
+   * \brief Parse a predicate of the form <field> <op> <literal>.
+   *
+   * The operator is one of ==, !=, <, <=, > and >=. Literals may be enclosed in single or
+   * double quotes, e.g. to compare with strings holding spaces.
+   *
+   * \param str The string to parse.
+   * \param out The resulting predicate.
+   * \return Status::OK() if successful, some error otherwise.
+   */
+  static auto Parse(const std::string& str, Predicate* out) -> Status;
+
+  [[nodiscard]] auto ToString() const -> std::string;
+};
+
+/**
+ * \brief Parse filter expressions into predicates.
+ *
+ * Every expression holds one or more predicates joined by "&&".
+ *
+ * \param exprs The filter expressions.
+ * \param out   The predicates of all expressions.
+ * \return Status::OK() if successful, some error otherwise.
+ */
+auto ParsePredicates(const std::vector<std::string>& exprs, std::vector<Predicate>* out)
+    -> Status;
+
+/// \brief Add an option to filter records to the CLI.
+void AddFilterOptionToCLI(CLI::App* sub, std::vector<std::string>* out);
+
+/**
+ * \brief Filters records of parsed batches that match a conjunction of predicates.
+ *
+ * Records for which any predicate does not hold, including records for which the field
+ * is null, are discarded. Filtered batches keep the sequence number range of the parsed
+ * batch, so the discarded records are still accounted for downstream.
+ */
+class Filter {
+ public:
+  /// \brief Construct a filter that passes all records.
+  Filter() = default;
+
+  /**
+   * \brief Make a new filter.
+   * \param predicates The predicates that must all hold for a record to pass.
+   * \param schema     The schema of the parsed batches.
+   * \param pool       Memory pool to allocate filtered batches from.
+   * \param out        The resulting filter.
+   * \return Status::OK() if successful, some error otherwise.
+   */
+  static auto Make(const std::vector<Predicate>& predicates, const arrow::Schema& schema,
+                   arrow::MemoryPool* pool, Filter* out) -> Status;
+
+  /**
+   * \brief Filter parsed batches in place.
+   * \param batches   The parsed batches.
+   * \param discarded The number of discarded records is added to this.
+   * \return Status::OK() if successful, some error otherwise.
+   */
+  auto Apply(std::vector<parse::ParsedBatch>* batches, size_t* discarded) const
+      -> Status;
+
+  /// \brief Return true if the filter passes all records.
+  [[nodiscard]] auto empty() const -> bool { return terms_.empty(); }
+
+ private:
+  /// A predicate bound to the schema.
+  struct Term {
+    /// Name of the field.
+    std::string field;
+    /// Name of the Arrow compute comparison function.
+    std::string function;
+    /// The literal as a scalar of the type of the field.
+    std::shared_ptr<arrow::Scalar> literal;
+  };
+
+  /// \brief Compute the selection mask of a batch.
+  auto Mask(const arrow::RecordBatch& batch, arrow::Datum* out) const -> Status;
+
+  std::vector<Term> terms_;
+  arrow::MemoryPool* pool_ = arrow::default_memory_pool();
+};
+
+}  // namespace bolson::convert
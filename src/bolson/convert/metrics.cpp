@@ -21,15 +21,19 @@ namespace bolson::convert {
 auto Metrics::operator+=(const bolson::convert::Metrics& r) -> Metrics& {
   num_threads += r.num_threads;
   num_jsons += r.num_jsons;
+  num_filtered += r.num_filtered;
   json_bytes += r.json_bytes;
   num_ipc += r.num_ipc;
   ipc_bytes += r.ipc_bytes;
   num_parsed += r.num_parsed;
   t.parse += r.t.parse;
+  t.filter += r.t.filter;
   t.resize += r.t.resize;
   t.serialize += r.t.serialize;
   t.thread += r.t.thread;
   t.enqueue += r.t.enqueue;
+  pool += r.pool;
+  wait += r.wait;
   if (!r.status.ok()) {
     status = r.status;
   }
@@ -55,6 +59,14 @@ void LogConvertMetrics(const Metrics& stats, const std::string& t) {
   spdlog::info("{}  Avg. throughput       : {} MB/s", t, json_MB / parse_tt);
   spdlog::info("{}  Avg. throughput       : {} MJ/s", t, json_M / parse_tt);
 
+  // Filtering stats
+  auto filter_tt = stats.t.filter / stats.num_threads;
+  spdlog::info("{}Filtering:", t);
+  spdlog::info("{}  Discarded             : {}", t, stats.num_filtered);
+  spdlog::info("{}  Time in {:2} threads    : {} s", t, stats.num_threads,
+               stats.t.filter);
+  spdlog::info("{}  Avg. time             : {} s", t, filter_tt);
+
   // Resizing stats
   auto resize_tt = stats.t.resize / stats.num_threads;
   spdlog::info("{}Resizing:", t);
@@ -89,6 +101,28 @@ void LogConvertMetrics(const Metrics& stats, const std::string& t) {
                stats.t.enqueue);
   spdlog::info("{}  Avg. time             : {} s", t, enq_tt);
   spdlog::info("{}  Avg. throughput       : {} MJ/s", t, json_M / enq_tt);
+
+  // Memory pools
+  auto pool_peak_MiB = static_cast<double>(stats.pool.peak_bytes) / (1024 * 1024);
+  auto pool_apj = static_cast<double>(stats.pool.num_allocations) / stats.num_jsons;
+  spdlog::info("{}Memory pools:", t);
+  spdlog::info("{}  Bytes allocated       : {}", t, stats.pool.bytes_allocated);
+  spdlog::info("{}  Sum of thread peaks   : {} MiB", t, pool_peak_MiB);
+  spdlog::info("{}  Allocations           : {}", t, stats.pool.num_allocations);
+  spdlog::info("{}  Avg. allocations/json : {}", t, pool_apj);
+  spdlog::info("{}  Cache hits            : {}", t, stats.pool.cache_hits);
+
+  // Device waits, only for parsers that offload to a device.
+  if (stats.wait.num_waits > 0) {
+    auto polls_pw = static_cast<double>(stats.wait.num_polls) / stats.wait.num_waits;
+    auto wait_tw = stats.wait.time / stats.wait.num_waits;
+    spdlog::info("{}Device waits:", t);
+    spdlog::info("{}  Waits                 : {}", t, stats.wait.num_waits);
+    spdlog::info("{}  Polls                 : {}", t, stats.wait.num_polls);
+    spdlog::info("{}  Avg. polls/wait       : {}", t, polls_pw);
+    spdlog::info("{}  Time                  : {} s", t, stats.wait.time);
+    spdlog::info("{}  Avg. time/wait        : {} s", t, wait_tw);
+  }
 }
 
 }  // namespace bolson::convert
\ No newline at end of file
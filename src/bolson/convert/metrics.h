@@ -14,6 +14,8 @@
 
 #include <putong/timer.h>
 
+#include "bolson/buffer/memory_pool.h"
+#include "bolson/parse/wait.h"
 #include "bolson/status.h"
 
 #pragma once
@@ -28,6 +30,8 @@ struct Metrics {
   size_t num_threads = 0;
   /// Number of converted JSONs.
   size_t num_jsons = 0;
+  /// Number of converted JSONs discarded by the filter.
+  size_t num_filtered = 0;
   /// Number of converted JSON bytes.
   size_t json_bytes = 0;
   /// Number of buffers parsed.
@@ -40,6 +44,8 @@ struct Metrics {
   struct {
     /// Total time spent on parsing JSONs to Arrow RecordBatch.
     double parse = 0.0;
+    /// Total time spent on filtering records.
+    double filter = 0.0;
     /// Total time spent on resizing parsed batches to fit in a message.
     double resize = 0.0;
     /// Total time spent on serializing the RecordBatch.
@@ -49,6 +55,10 @@ struct Metrics {
     /// Total time spent in the conversion thread.
     double thread = 0.0;
   } t;
+  /// Statistics of the memory pool of the converter thread.
+  buffer::MemoryPoolMetrics pool;
+  /// Statistics of waiting on devices by the parsers of the converter thread.
+  parse::WaitMetrics wait;
   /// Status about the conversion.
   Status status = Status::OK();
 
@@ -14,32 +14,40 @@
 
 #include "bolson/convert/resizer.h"
 
+#include <algorithm>
+#include <memory>
+
 namespace bolson::convert {
 
 // TODO: this could also be done based on arrow::ipc::GetRecordBatchSize
 
 auto Resizer::Resize(const parse::ParsedBatch& in, ResizedBatches* out) -> Status {
   ResizedBatches result;
-  if (in.batch->num_rows() > max_rows) {
-    size_t offset = 0;
-    size_t remaining = in.batch->num_rows();
-    while (remaining > 0) {
-      auto first = in.seq_range.first + offset;
-      if (remaining > max_rows) {
-        illex::SeqRange new_seq = {first, first + max_rows - 1};
-        result.push_back(parse::ParsedBatch{
-            parse::AddSeqAsSchemaMeta(in.batch->Slice(offset, max_rows), new_seq),
-            new_seq});
-        offset += max_rows;
-        remaining -= max_rows;
-      } else {
-        illex::SeqRange new_seq = {first, first + remaining - 1};
-        result.push_back(parse::ParsedBatch{
-            parse::AddSeqAsSchemaMeta(in.batch->Slice(offset, remaining), new_seq),
-            new_seq});
-        offset += remaining;
-        remaining = 0;
-      }
+  // A batch of which a filter discarded all records carries only its sequence numbers.
+  if (in.batch->num_rows() == 0) {
+    result.push_back(parse::ParsedBatch{nullptr, in.seq_range});
+    *out = result;
+    return Status::OK();
+  }
+  const auto num_rows = static_cast<size_t>(in.batch->num_rows());
+  if (num_rows > max_rows) {
+    // If a filter discarded records, only a sequence number column tells which rows are
+    // left. A slice then starts at the sequence number of its first row. Either way, a
+    // slice ends where the next one starts, so the slices cover the input range.
+    auto seq = std::dynamic_pointer_cast<arrow::UInt64Array>(
+        in.batch->GetColumnByName("bolson_seq"));
+    auto slice_first = [&](size_t row) -> uint64_t {
+      return seq != nullptr ? seq->Value(row) : in.seq_range.first + row;
+    };
+    uint64_t first = in.seq_range.first;
+    for (size_t offset = 0; offset < num_rows; offset += max_rows) {
+      const auto length = std::min(max_rows, num_rows - offset);
+      const auto next = offset + length;
+      const uint64_t last = next < num_rows ? slice_first(next) - 1 : in.seq_range.last;
+      illex::SeqRange new_seq = {first, last};
+      result.push_back(parse::ParsedBatch{
+          parse::AddSeqAsSchemaMeta(in.batch->Slice(offset, length), new_seq), new_seq});
+      first = last + 1;
     }
   } else {
     result.push_back(parse::ParsedBatch{in.batch, in.seq_range});
@@ -49,4 +57,14 @@ auto Resizer::Resize(const parse::ParsedBatch& in, ResizedBatches* out) -> Statu
   return Status::OK();
 }
 
+auto Resizer::Resize(const std::vector<parse::ParsedBatch>& in, ResizedBatches* out)
+    -> Status {
+  for (const auto& batch : in) {
+    ResizedBatches resized;
+    BOLSON_ROE(Resize(batch, &resized));
+    out->insert(out->end(), resized.begin(), resized.end());
+  }
+  return Status::OK();
+}
+
 }  // namespace bolson::convert
@@ -38,12 +38,30 @@ class Resizer {
   explicit Resizer(size_t max_rows) : max_rows(max_rows) {}
   /**
    * \brief Resize all RecordBatches in a parsed buffer to not exceed a maximum no. rows.
+   *
+   * The sequence number ranges of the resized batches always cover the range of the
+   * input batch, even if a filter discarded some of its records. If it discarded all
+   * records, the result is a single batch without RecordBatch. If the batch has a
+   * "bolson_seq" column, every resized batch covers the sequence numbers of its rows.
+   *
    * \param in  The parsed buffer containing resulting Arrow RecordBatches.
    * \param out The resized RecordBatches.
    * \return Status::OK() if successful, some error otherwise.
    */
   auto Resize(const parse::ParsedBatch& in, ResizedBatches* out) -> Status;
 
+  /**
+   * \brief Resize all batches parsed from one or more buffers.
+   *
+   * Batches are sliced without copying, and their resized batches appended to out in
+   * the order of the input batches.
+   *
+   * \param in  The parsed batches.
+   * \param out The resized RecordBatches are appended to this.
+   * \return Status::OK() if successful, some error otherwise.
+   */
+  auto Resize(const std::vector<parse::ParsedBatch>& in, ResizedBatches* out) -> Status;
+
  private:
   size_t max_rows;
 };
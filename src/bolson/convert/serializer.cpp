@@ -14,8 +14,102 @@
 
 #include "bolson/convert/serializer.h"
 
+#include <arrow/compute/api.h>
+#include <arrow/io/api.h>
+
 namespace bolson::convert {
 
+Serializer::Serializer(size_t max_ipc_size, arrow::MemoryPool* pool,
+                       const std::shared_ptr<arrow::Schema>& schema)
+    : max_ipc_size(max_ipc_size) {
+  opts.memory_pool = pool;
+  if (schema != nullptr) {
+    for (const auto& field : schema->fields()) {
+      if (field->type()->id() == arrow::Type::DICTIONARY) {
+        dict_types[field->name()] =
+            std::static_pointer_cast<arrow::DictionaryType>(field->type());
+      }
+    }
+  }
+}
+
+auto Serializer::EncodeDictionaries(const std::shared_ptr<arrow::RecordBatch>& batch,
+                                    std::shared_ptr<arrow::RecordBatch>* out,
+                                    arrow::ArrayVector* dictionaries) -> Status {
+  arrow::compute::ExecContext ctx(opts.memory_pool);
+  arrow::FieldVector fields;
+  arrow::ArrayVector columns;
+  for (int c = 0; c < batch->num_columns(); c++) {
+    auto field = batch->schema()->field(c);
+    auto column = batch->column(c);
+    auto dict_type = dict_types.find(field->name());
+    if (dict_type != dict_types.end()) {
+      auto encoded = arrow::compute::DictionaryEncode(
+          column, arrow::compute::DictionaryEncodeOptions::Defaults(), &ctx);
+      if (!encoded.ok()) {
+        return Status(Error::ArrowError, "Could not dictionary-encode column \"" +
+                                             field->name() +
+                                             "\": " + encoded.status().message());
+      }
+      auto encoded_array = std::static_pointer_cast<arrow::DictionaryArray>(
+          encoded.ValueOrDie().make_array());
+      // Arrow encodes with 32-bit indices, which may differ from the schema.
+      auto indices = arrow::compute::Cast(*encoded_array->indices(),
+                                          dict_type->second->index_type(),
+                                          arrow::compute::CastOptions::Safe(), &ctx);
+      if (!indices.ok()) {
+        return Status(Error::ArrowError, "Dictionary of column \"" + field->name() +
+                                             "\" exceeds its index type: " +
+                                             indices.status().message());
+      }
+      auto dict_array = arrow::DictionaryArray::FromArrays(
+          dict_type->second, indices.ValueOrDie(), encoded_array->dictionary());
+      if (!dict_array.ok()) {
+        return Status(Error::ArrowError, dict_array.status().message());
+      }
+      dictionaries->push_back(encoded_array->dictionary());
+      field = field->WithType(dict_type->second);
+      column = dict_array.ValueOrDie();
+    }
+    fields.push_back(field);
+    columns.push_back(column);
+  }
+  *out = arrow::RecordBatch::Make(arrow::schema(fields, batch->schema()->metadata()),
+                                  batch->num_rows(), columns);
+  return Status::OK();
+}
+
+auto Serializer::WriteMessage(const arrow::RecordBatch& batch,
+                              const arrow::ArrayVector& dictionaries,
+                              std::shared_ptr<arrow::Buffer>* out) -> Status {
+  auto stream_result = arrow::io::BufferOutputStream::Create(4096, opts.memory_pool);
+  if (!stream_result.ok()) {
+    return Status(Error::ArrowError, stream_result.status().message());
+  }
+  auto stream = stream_result.ValueOrDie();
+  int32_t metadata_length = 0;
+
+  // Readers number the dictionaries in the order of the dictionary fields in the schema.
+  for (size_t d = 0; d < dictionaries.size(); d++) {
+    arrow::ipc::IpcPayload payload;
+    ARROW_ROE(arrow::ipc::GetDictionaryPayload(static_cast<int64_t>(d), dictionaries[d],
+                                               opts, &payload));
+    ARROW_ROE(
+        arrow::ipc::WriteIpcPayload(payload, opts, stream.get(), &metadata_length));
+  }
+
+  arrow::ipc::IpcPayload payload;
+  ARROW_ROE(arrow::ipc::GetRecordBatchPayload(batch, opts, &payload));
+  ARROW_ROE(arrow::ipc::WriteIpcPayload(payload, opts, stream.get(), &metadata_length));
+
+  auto finish_result = stream->Finish();
+  if (!finish_result.ok()) {
+    return Status(Error::ArrowError, finish_result.status().message());
+  }
+  *out = finish_result.ValueOrDie();
+  return Status::OK();
+}
+
 auto Serializer::Serialize(const ResizedBatches& in, SerializedBatches* out) -> Status {
   SerializedBatches result;
 
@@ -24,18 +118,33 @@ auto Serializer::Serialize(const ResizedBatches& in, SerializedBatches* out) ->
 
   // Serialize each batch.
   for (const auto& batch : in) {
-    auto serialize_result = arrow::ipc::SerializeRecordBatch(*batch.batch, opts);
-    if (!serialize_result.ok()) {
-      return Status(Error::ArrowError,
-                    "Could not serialize batch: " + serialize_result.status().message());
+    // Pass on the sequence numbers of records that were all discarded.
+    if (batch.batch == nullptr) {
+      result.push_back({nullptr, batch.seq_range});
+      continue;
+    }
+    std::shared_ptr<arrow::Buffer> serialized;
+    if (dict_types.empty()) {
+      auto serialize_result = arrow::ipc::SerializeRecordBatch(*batch.batch, opts);
+      if (!serialize_result.ok()) {
+        return Status(Error::ArrowError, "Could not serialize batch: " +
+                                             serialize_result.status().message());
+      }
+      serialized = serialize_result.ValueOrDie();
+    } else {
+      std::shared_ptr<arrow::RecordBatch> encoded;
+      arrow::ArrayVector dictionaries;
+      BOLSON_ROE(EncodeDictionaries(batch.batch, &encoded, &dictionaries));
+      BOLSON_ROE(WriteMessage(*encoded, dictionaries, &serialized));
     }
-    auto serialized = serialize_result.ValueOrDie();
     if (serialized->size() > max_ipc_size) {
       return Status(Error::GenericError,
                     "Maximum IPC message size exceeded."
                     "Reduce max number of rows per batch.");
     }
-    result.push_back({serialize_result.ValueOrDie(), batch.seq_range});
+    SerializedBatch serialized_batch{serialized, batch.seq_range};
+    serialized_batch.num_rows = batch.batch->num_rows();
+    result.push_back(serialized_batch);
   }
 
   *out = result;
@@ -46,7 +155,9 @@ auto Serializer::Serialize(const ResizedBatches& in, SerializedBatches* out) ->
 auto ByteSizeOf(const SerializedBatches& batches) -> size_t {
   size_t result = 0;
   for (const auto& b : batches) {
-    result += b.message->size();
+    if (b.message != nullptr) {
+      result += b.message->size();
+    }
   }
   return result;
 }
@@ -16,6 +16,9 @@
 
 #include <arrow/ipc/api.h>
 
+#include <string>
+#include <unordered_map>
+
 #include "bolson/convert/resizer.h"
 #include "bolson/status.h"
 
@@ -23,12 +26,15 @@ namespace bolson::convert {
 
 /// A serialized RecordBatch.
 struct SerializedBatch {
-  /// The serialized batch.
+  /// The serialized batch, or nullptr if a filter discarded all of its records.
   std::shared_ptr<arrow::Buffer> message = nullptr;
   /// The range of sequence numbers it contains.
   illex::SeqRange seq_range = {0, 0};
   /// When the batch was where in the pipeline.
   TimePoints time_points;
+  /// The number of records it contains, which is less than the size of the range if a
+  /// filter discarded records.
+  int64_t num_rows = 0;
 };
 
 /// \brief Returns true if lhs batch has lower first index than rhs batch.
@@ -37,7 +43,8 @@ auto operator<(const SerializedBatch& a, const SerializedBatch& b) -> bool;
 /// Batches that were serialized to an Arrow IPC message.
 using SerializedBatches = std::vector<SerializedBatch>;
 
-/// Return the number of records in a serialized batch.
+/// Return the number of sequence numbers in a serialized batch, including discarded
+/// records.
 auto RecordSizeOf(const SerializedBatch& batch) -> size_t;
 
 /// Return the number of bytes in multiple serialized batches.
@@ -45,14 +52,23 @@ auto ByteSizeOf(const SerializedBatches& batches) -> size_t;
 
 /**
  * \brief Class used to serialize a batch of Arrow RecordBatches into Arrow IPC messages.
+ *
+ * Columns of which the field in the output schema is dictionary-encoded are encoded
+ * while serializing. Each message is then prefixed with a dictionary batch for every
+ * dictionary-encoded field, holding only the values the record batch refers to, so
+ * every message can be decoded on its own together with the schema.
  */
 class Serializer {
  public:
   /**
    * \brief Serializer constructor.
    * \param max_ipc_size Maximum size of Arrow IPC messages.
+   * \param pool         Memory pool to allocate IPC messages from.
+   * \param schema       The output schema, which may contain dictionary-encoded fields.
    */
-  explicit Serializer(size_t max_ipc_size) : max_ipc_size(max_ipc_size) {}
+  explicit Serializer(size_t max_ipc_size,
+                      arrow::MemoryPool* pool = arrow::default_memory_pool(),
+                      const std::shared_ptr<arrow::Schema>& schema = nullptr);
   /**
    * \brief Serialize RecordBatches.
    *
@@ -66,9 +82,22 @@ class Serializer {
   auto Serialize(const ResizedBatches& in, SerializedBatches* out) -> Status;
 
  private:
+  /// \brief Dictionary-encode columns, returning the dictionaries in field order.
+  auto EncodeDictionaries(const std::shared_ptr<arrow::RecordBatch>& batch,
+                          std::shared_ptr<arrow::RecordBatch>* out,
+                          arrow::ArrayVector* dictionaries) -> Status;
+
+  /// \brief Write the dictionary batches followed by the record batch.
+  auto WriteMessage(const arrow::RecordBatch& batch,
+                    const arrow::ArrayVector& dictionaries,
+                    std::shared_ptr<arrow::Buffer>* out) -> Status;
+
   /// Options for Arrow's IPC writer.
   arrow::ipc::IpcWriteOptions opts = arrow::ipc::IpcWriteOptions::Defaults();
 
+  /// Dictionary-encoded fields of the output schema, by name.
+  std::unordered_map<std::string, std::shared_ptr<arrow::DictionaryType>> dict_types;
+
   /// Maximum IPC size. Serialize() will return an Error if this is exceeded.
   size_t max_ipc_size;
 };
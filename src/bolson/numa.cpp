@@ -0,0 +1,175 @@
+// Copyright 2020 Teratide B.V.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "bolson/numa.h"
+
+#include <dirent.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+
+#include "bolson/log.h"
+
+namespace bolson {
+
+// Memory policy constants of the mbind system call, to not depend on libnuma headers.
+constexpr int kMemPolicyPreferred = 1;
+constexpr unsigned int kMemPolicyMoveFlag = 1u << 1u;
+
+auto ToString(Placement placement) -> std::string {
+  switch (placement) {
+    case Placement::NONE:
+      return "none";
+    case Placement::NUMA:
+      return "NUMA";
+  }
+  return "Corrupt bolson::Placement enum value.";
+}
+
+void AddPlacementOptionToCLI(CLI::App* sub, Placement* out) {
+  sub->add_option("--placement", *out,
+                  "Placement of threads and buffers. \"numa\" pins client, converter and "
+                  "publish threads to NUMA nodes round-robin, places input buffers on "
+                  "the nodes, and makes converter threads prefer buffers on their node.")
+      ->transform(CLI::CheckedTransformer(
+          std::map<std::string, Placement>{{"none", Placement::NONE},
+                                           {"numa", Placement::NUMA}},
+          CLI::ignore_case))
+      ->default_val(Placement::NONE);
+}
+
+/// \brief Parse a kernel CPU list, e.g. "0-3,8,10-11".
+static auto ParseCpuList(const std::string& list) -> std::vector<int> {
+  std::vector<int> result;
+  std::stringstream ss(list);
+  std::string range;
+  while (std::getline(ss, range, ',')) {
+    if (range.empty() || !std::isdigit(range[0])) continue;
+    auto dash = range.find('-');
+    int first = std::stoi(range.substr(0, dash));
+    int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+    for (int cpu = first; cpu <= last; cpu++) {
+      result.push_back(cpu);
+    }
+  }
+  return result;
+}
+
+auto Topology::Detect(Topology* out) -> Status {
+  Topology result;
+  const std::string sys_nodes = "/sys/devices/system/node";
+  DIR* dir = opendir(sys_nodes.c_str());
+  if (dir != nullptr) {
+    while (auto* entry = readdir(dir)) {
+      std::string name(entry->d_name);
+      if ((name.rfind("node", 0) != 0) || (name.size() == 4) ||
+          !std::all_of(name.begin() + 4, name.end(), ::isdigit)) {
+        continue;
+      }
+      std::ifstream cpulist(sys_nodes + "/" + name + "/cpulist");
+      std::string list;
+      std::getline(cpulist, list);
+      NumaNode node{std::stoi(name.substr(4)), ParseCpuList(list)};
+      // Memory-only nodes can't run threads.
+      if (!node.cpus.empty()) {
+        result.nodes.push_back(node);
+      }
+    }
+    closedir(dir);
+  }
+
+  if (result.nodes.empty()) {
+    NumaNode node;
+    const auto num_cpus = static_cast<int>(std::thread::hardware_concurrency());
+    for (int cpu = 0; cpu < num_cpus; cpu++) {
+      node.cpus.push_back(cpu);
+    }
+    result.nodes.push_back(node);
+  }
+  std::sort(result.nodes.begin(), result.nodes.end(),
+            [](const NumaNode& a, const NumaNode& b) { return a.id < b.id; });
+
+  *out = result;
+  return Status::OK();
+}
+
+auto Topology::ToString() const -> std::string {
+  std::stringstream ss;
+  ss << nodes.size() << " node(s)";
+  for (const auto& node : nodes) {
+    ss << ", node " << node.id << ": " << node.cpus.size() << " CPUs";
+  }
+  return ss.str();
+}
+
+/// \brief Pin a thread by its native handle.
+static auto PinNativeThread(pthread_t thread, const NumaNode& node) -> Status {
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (auto cpu : node.cpus) {
+    CPU_SET(cpu, &set);
+  }
+  auto err = pthread_setaffinity_np(thread, sizeof(set), &set);
+  if (err != 0) {
+    return Status(Error::GenericError, "Unable to pin thread to NUMA node " +
+                                           std::to_string(node.id) + ": " +
+                                           std::strerror(err));
+  }
+  return Status::OK();
+}
+
+auto PinThread(std::thread* thread, const NumaNode& node) -> Status {
+  return PinNativeThread(thread->native_handle(), node);
+}
+
+auto PinCurrentThread(const NumaNode& node) -> Status {
+  return PinNativeThread(pthread_self(), node);
+}
+
+void WarnOnPlacementFailure(const Status& status) {
+  if (!status.ok()) {
+    spdlog::warn("{}", status.msg());
+  }
+}
+
+auto BindMemory(void* addr, size_t size, const NumaNode& node) -> Status {
+  // The range must start at a page boundary.
+  const auto page = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+  auto start = reinterpret_cast<uintptr_t>(addr) & ~(page - 1);
+  auto len = reinterpret_cast<uintptr_t>(addr) + size - start;
+
+  constexpr size_t bits = 8 * sizeof(unsigned long);
+  std::vector<unsigned long> mask(node.id / bits + 1, 0);
+  mask[node.id / bits] = 1ul << (node.id % bits);
+
+  if (syscall(SYS_mbind, start, len, kMemPolicyPreferred, mask.data(),
+              mask.size() * bits + 1, kMemPolicyMoveFlag) != 0) {
+    return Status(Error::GenericError, "Unable to move memory to NUMA node " +
+                                           std::to_string(node.id) + ": " +
+                                           std::strerror(errno));
+  }
+  return Status::OK();
+}
+
+}  // namespace bolson
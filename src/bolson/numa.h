@@ -0,0 +1,88 @@
+// Copyright 2020 Teratide B.V.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#pragma once
+
+#include <CLI/CLI.hpp>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bolson/status.h"
+
+namespace bolson {
+
+/// Placement of threads and buffers on the host.
+enum class Placement {
+  NONE,  ///< Threads float freely, buffers are placed wherever they are first touched.
+  NUMA   ///< Threads are pinned to, and buffers placed on, NUMA nodes round-robin.
+};
+
+/// \brief Return human-readable Placement enum.
+auto ToString(Placement placement) -> std::string;
+
+/// \brief Options exposed to CLI.
+void AddPlacementOptionToCLI(CLI::App* sub, Placement* out);
+
+/// A NUMA node of the host.
+struct NumaNode {
+  /// The node id used by the kernel.
+  int id = 0;
+  /// The CPUs of this node.
+  std::vector<int> cpus;
+};
+
+/// The NUMA topology of the host.
+struct Topology {
+  /// All nodes that have CPUs.
+  std::vector<NumaNode> nodes;
+
+  /**
+   * \brief Detect the NUMA topology of the host.
+   *
+   * If no topology is exposed by the kernel, this results in a single node with all
+   * CPUs.
+   *
+   * \param out The detected topology.
+   * \return Status::OK() if successful, some error otherwise.
+   */
+  static auto Detect(Topology* out) -> Status;
+
+  /// \brief Return the node to place the i-th thread or buffer of some kind on.
+  [[nodiscard]] auto node(size_t i) const -> size_t { return i % nodes.size(); }
+
+  /// \brief Return a human-readable description of the topology.
+  [[nodiscard]] auto ToString() const -> std::string;
+};
+
+/// \brief Pin a thread to the CPUs of a node.
+auto PinThread(std::thread* thread, const NumaNode& node) -> Status;
+
+/// \brief Pin the calling thread to the CPUs of a node.
+auto PinCurrentThread(const NumaNode& node) -> Status;
+
+/// \brief Log a warning if placement failed, since placement is only a hint.
+void WarnOnPlacementFailure(const Status& status);
+
+/**
+ * \brief Move memory to a node, and prefer the node for pages faulted in later.
+ * \param addr The start of the memory.
+ * \param size The number of bytes.
+ * \param node The node to move the memory to.
+ * \return Status::OK() if successful, some error otherwise.
+ */
+auto BindMemory(void* addr, size_t size, const NumaNode& node) -> Status;
+
+}  // namespace bolson
@@ -18,13 +18,21 @@
 #include <arrow/io/api.h>
 #include <arrow/ipc/api.h>
 #include <arrow/json/api.h>
+#include <arrow/json/chunked_builder.h>
+#include <arrow/json/parser.h>
+#include <arrow/util/task_group.h>
 
 #include <CLI/CLI.hpp>
+#include <algorithm>
+#include <cstring>
+#include <functional>
 #include <memory>
 #include <string_view>
+#include <thread>
 
 #include "bolson/log.h"
 #include "bolson/parse/parser.h"
+#include "bolson/parse/timestamp.h"
 
 namespace bolson::parse {
 
@@ -41,10 +49,9 @@ auto ReadSchemaFromFile(const std::string& file, std::shared_ptr<arrow::Schema>*
   }
   auto file_input_stream = result_file_open.ValueOrDie();
 
-  // Dictionaries are not supported yet, hence nullptr. If there are actual dictionaries,
-  // the function will return an error status, which is propagated to the caller of this
-  // function.
-  auto read_schema_result = arrow::ipc::ReadSchema(file_input_stream.get(), nullptr);
+  // Dictionary-encoded fields are supported, their dictionaries are built per message.
+  arrow::ipc::DictionaryMemo dict_memo;
+  auto read_schema_result = arrow::ipc::ReadSchema(file_input_stream.get(), &dict_memo);
 
   if (read_schema_result.ok()) {
     *out = read_schema_result.ValueOrDie();
@@ -62,39 +69,86 @@ auto ArrowOptions::ReadSchema() -> Status {
   return Status::OK();
 }
 
+auto ProjectSchema(const std::shared_ptr<arrow::Schema>& schema,
+                   const std::vector<std::string>& columns,
+                   std::shared_ptr<arrow::Schema>* out) -> Status {
+  if (columns.empty()) {
+    *out = schema;
+    return Status::OK();
+  }
+  arrow::FieldVector fields;
+  for (const auto& column : columns) {
+    auto field = schema->GetFieldByName(column);
+    if (field == nullptr) {
+      return Status(Error::GenericError, "Column \"" + column +
+                                             "\" is not a unique field of schema: " +
+                                             schema->ToString());
+    }
+    for (const auto& f : fields) {
+      if (f->name() == column) {
+        return Status(Error::GenericError, "Column \"" + column + "\" selected twice.");
+      }
+    }
+    fields.push_back(field);
+  }
+  *out = arrow::schema(fields, schema->metadata());
+  return Status::OK();
+}
+
+auto ArrowOptions::ProjectedSchema(std::shared_ptr<arrow::Schema>* out) const -> Status {
+  std::shared_ptr<arrow::Schema> full = schema;
+  if (full == nullptr) {
+    BOLSON_ROE(ReadSchemaFromFile(schema_path, &full));
+  }
+  return ProjectSchema(full, columns, out);
+}
+
 auto ArrowParserContext::Make(const ArrowOptions& opts, size_t num_parsers,
                               std::shared_ptr<ParserContext>* out) -> Status {
   auto result = std::make_shared<ArrowParserContext>();
 
-  // Use default allocator.
-  result->allocator_ = std::make_shared<buffer::Allocator>();
+  // Use a host memory allocator.
+  result->allocator_ = buffer::MakeHostAllocator(opts.buf_pages, opts.buf_page_aligned);
 
   // Determine Arrow JSON parser options.
   arrow::json::ParseOptions parse_opts;
-  if (opts.schema == nullptr) {
-    BOLSON_ROE(ReadSchemaFromFile(opts.schema_path, &result->input_schema_));
-  } else {
-    result->input_schema_ = opts.schema;
-  }
+  std::shared_ptr<arrow::Schema> schema;
+  BOLSON_ROE(opts.ProjectedSchema(&schema));
+  // Dictionary-encoded fields are parsed as their values, and encoded when serialized.
+  BOLSON_ROE(DecodeDictionaries(*schema, &result->input_schema_));
 
   // Add the sequence number field to the output schema if specified.
   if (opts.seq_column) {
-    BOLSON_ROE(WithSeqField(*result->input_schema_, &result->output_schema_));
+    BOLSON_ROE(WithSeqField(*schema, &result->output_schema_));
   } else {
-    result->output_schema_ = result->input_schema_;
+    result->output_schema_ = schema;
   }
+  // Timestamp strings are parsed to Arrow timestamps after parsing the JSONs.
+  BOLSON_ROE(WithTimestampFields(*result->output_schema_, opts.timestamps,
+                                 &result->output_schema_));
 
   parse_opts.explicit_schema = result->input_schema_;
-  parse_opts.unexpected_field_behavior = arrow::json::UnexpectedFieldBehavior::Error;
-
-  // Determine Arrow JSON table reader options.
-  arrow::json::ReadOptions read_opts;
-  read_opts.use_threads = false;  // threading is handled by Bolson
-  read_opts.block_size = 2 * read_opts.block_size;
+  // Fields that are not projected are skipped without converting their values.
+  parse_opts.unexpected_field_behavior =
+      opts.columns.empty() ? arrow::json::UnexpectedFieldBehavior::Error
+                           : arrow::json::UnexpectedFieldBehavior::Ignore;
+
+  // Spawn the pool to parse chunks of buffers, if enabled. Every converter thread helps
+  // out while its buffer is parsed, so this only needs the additional threads.
+  std::shared_ptr<TaskPool> pool;
+  if (opts.chunk_size > 0) {
+    auto threads = opts.chunk_threads == 0 ? std::thread::hardware_concurrency()
+                                           : opts.chunk_threads;
+    pool = std::make_shared<TaskPool>(threads > num_parsers ? threads - num_parsers : 0);
+  }
 
-  // Initialize all parsers.
-  result->parsers_ = std::vector<std::shared_ptr<ArrowParser>>(
-      num_parsers, std::make_shared<ArrowParser>(parse_opts, read_opts, opts.seq_column));
+  // Initialize a parser for every thread, so parsers don't share any state.
+  for (size_t p = 0; p < num_parsers; p++) {
+    auto parser = std::make_shared<ArrowParser>(parse_opts, opts.seq_column,
+                                                opts.chunk_size, pool);
+    parser->set_timestamp_columns(opts.timestamps);
+    result->parsers_.push_back(parser);
+  }
   *out = std::static_pointer_cast<ParserContext>(result);
 
   // Allocate buffers. Use number of parsers if number of buffers is 0 in options.
@@ -104,64 +158,122 @@ auto ArrowParserContext::Make(const ArrowOptions& opts, size_t num_parsers,
   return Status::OK();
 }
 
+auto ArrowParser::ParseRaw(const std::byte* data, size_t size,
+                           std::shared_ptr<arrow::RecordBatch>* out) const -> Status {
+  // Parse the data as a single block, directly to a RecordBatch. This follows
+  // arrow::json::ParseOne, which always allocates from the default memory pool.
+  // The block parser and builder can't be reset, and chunks of a buffer are parsed
+  // concurrently, so they are made for every call. This costs a few microseconds, which
+  // only matters for buffers of a few JSONs. Their allocations are served from the size
+  // class cache of the thread memory pool, if enabled.
+  std::unique_ptr<arrow::json::BlockParser> parser;
+  std::shared_ptr<arrow::Array> parsed;
+  ARROW_ROE(arrow::json::BlockParser::Make(memory_pool_, parse_opts, &parser));
+  auto status = parser->Parse(arrow::Buffer::Wrap(data, size));
+  if (status.ok()) {
+    status = parser->Finish(&parsed);
+  }
+  if (!status.ok()) {
+    SPDLOG_DEBUG("Encountered error while parsing: {}",
+                 std::string(reinterpret_cast<const char*>(data), size));
+    return Status(Error::ArrowError,
+                  "Unable to parse JSONs to RecordBatch: " + status.message());
+  }
+
+  // Convert the unconverted parsed values to the types of the explicit schema.
+  std::shared_ptr<arrow::json::ChunkedArrayBuilder> builder;
+  ARROW_ROE(arrow::json::MakeChunkedArrayBuilder(arrow::internal::TaskGroup::MakeSerial(),
+                                                 memory_pool_, nullptr, batch_type,
+                                                 &builder));
+  builder->Insert(0, arrow::field("", batch_type), parsed);
+  std::shared_ptr<arrow::ChunkedArray> converted;
+  ARROW_ROE(builder->Finish(&converted));
+
+  const auto& fields = static_cast<const arrow::StructArray&>(*converted->chunk(0));
+  arrow::ArrayVector columns(fields.num_fields());
+  for (int i = 0; i < fields.num_fields(); i++) {
+    columns[i] = fields.field(i);
+  }
+  *out = arrow::RecordBatch::Make(batch_schema, fields.length(), columns);
+  return Status::OK();
+}
+
+auto ArrowParser::AppendBatch(const std::shared_ptr<arrow::RecordBatch>& batch,
+                              illex::SeqRange seq_range,
+                              std::vector<ParsedBatch>* batches_out) const -> Status {
+  std::shared_ptr<arrow::RecordBatch> final_batch;
+
+  if (seq_column) {
+    BOLSON_ROE(AddSeqColumn(batch, seq_range, &final_batch, memory_pool_));
+  } else {
+    final_batch = AddSeqAsSchemaMeta(batch, seq_range);
+  }
+  BOLSON_ROE(ConvertTimestamps(&final_batch));
+
+  batches_out->emplace_back(final_batch, seq_range);
+  return Status::OK();
+}
+
+auto ArrowParser::ParseChunked(const illex::JSONBuffer& in,
+                               std::vector<ParsedBatch>* batches_out) -> Status {
+  // Split the buffer at the first newline after every chunk size bytes.
+  const auto* data = in.data();
+  const auto* end = in.data() + in.size();
+  std::vector<std::pair<const std::byte*, size_t>> chunks;
+  while (data != end) {
+    auto size = std::min(chunk_size, static_cast<size_t>(end - data));
+    const auto* last = data + size - 1;
+    const auto* newline =
+        static_cast<const std::byte*>(std::memchr(last, '\n', end - last));
+    const auto* next = newline == nullptr ? end : newline + 1;
+    chunks.emplace_back(data, next - data);
+    data = next;
+  }
+
+  // Parse all chunks on the pool.
+  std::vector<std::shared_ptr<arrow::RecordBatch>> batches(chunks.size());
+  std::vector<Status> statuses(chunks.size(), Status::OK());
+  std::vector<std::function<void()>> tasks;
+  tasks.reserve(chunks.size());
+  for (size_t c = 0; c < chunks.size(); c++) {
+    tasks.emplace_back([this, c, &chunks, &batches, &statuses]() {
+      statuses[c] = ParseRaw(chunks[c].first, chunks[c].second, &batches[c]);
+    });
+  }
+  pool->Run(tasks);
+
+  // Stitch the chunks together, assigning consecutive sequence numbers to the rows.
+  uint64_t first = in.range().first;
+  for (size_t c = 0; c < chunks.size(); c++) {
+    BOLSON_ROE(statuses[c]);
+    // Chunks of only whitespace result in no rows.
+    if ((batches[c] == nullptr) || (batches[c]->num_rows() == 0)) continue;
+    illex::SeqRange range = {first, first + batches[c]->num_rows() - 1};
+    BOLSON_ROE(AppendBatch(batches[c], range, batches_out));
+    first = range.last + 1;
+  }
+  if (first != in.range().last + 1) {
+    return Status(Error::ArrowError,
+                  "Parsed " + std::to_string(first - in.range().first) +
+                      " JSONs, but sequence range holds " +
+                      std::to_string(in.range().last - in.range().first + 1) + ".");
+  }
+  return Status::OK();
+}
+
 auto ArrowParser::Parse(const std::vector<illex::JSONBuffer*>& buffers_in,
                         std::vector<ParsedBatch>* batches_out) -> Status {
   assert(batches_out != nullptr);
 
   for (auto* in : buffers_in) {
     assert(in != nullptr);
-    auto buffer = arrow::Buffer::Wrap(in->data(), in->size());
-    auto br = std::make_shared<arrow::io::BufferReader>(buffer);
-    auto tr_make_result = arrow::json::TableReader::Make(arrow::default_memory_pool(), br,
-                                                         read_opts, parse_opts);
-    if (!tr_make_result.ok()) {
-      return Status(Error::ArrowError, "Unable to make JSON Table Reader: " +
-                                           tr_make_result.status().message());
-    }
-    auto t_reader = tr_make_result.ValueOrDie();
-
-    auto tr_read_result = t_reader->Read();
-    if (!tr_read_result.ok()) {
-      SPDLOG_DEBUG("Encountered error while parsing: {}",
-                   std::string(reinterpret_cast<const char*>(in->data()), in->size()));
-      return Status(Error::ArrowError, "Unable to read JSONs to RecordBatch(es): " +
-                                           tr_read_result.status().message());
-    }
-    auto table = tr_read_result.ValueOrDie();
-
-    // Combine potential chunks in this table and read the first batch.
-    auto table_combine_result = table->CombineChunks();
-    if (!table_combine_result.ok()) {
-      return Status(Error::ArrowError, table_combine_result.status().message());
-    }
-    auto tb_reader = arrow::TableBatchReader(*table_combine_result.ValueOrDie());
-    auto table_reader_next_result = tb_reader.Next();
-    if (!table_reader_next_result.ok()) {
-      return Status(Error::ArrowError, table_reader_next_result.status().message());
-    }
-
-    auto combined_batch = table_reader_next_result.ValueOrDie();
-
-    std::shared_ptr<arrow::RecordBatch> final_batch;
-
-    if (seq_column) {
-      std::shared_ptr<arrow::UInt64Array> seq;
-      arrow::UInt64Builder builder;
-      ARROW_ROE(builder.Reserve(in->range().last - in->range().first + 1));
-      for (uint64_t s = in->range().first; s <= in->range().last; s++) {
-        builder.UnsafeAppend(s);
-      }
-      ARROW_ROE(builder.Finish(&seq));
-      auto final_batch_result = combined_batch->AddColumn(0, "bolson_seq", seq);
-      if (!final_batch_result.ok()) {
-        return Status(Error::ArrowError, final_batch_result.status().message());
-      }
-      final_batch = final_batch_result.ValueOrDie();
+    if ((pool != nullptr) && (chunk_size > 0) && (in->size() > chunk_size)) {
+      BOLSON_ROE(ParseChunked(*in, batches_out));
     } else {
-      final_batch = AddSeqAsSchemaMeta(combined_batch, in->range());
+      std::shared_ptr<arrow::RecordBatch> batch;
+      BOLSON_ROE(ParseRaw(in->data(), in->size(), &batch));
+      BOLSON_ROE(AppendBatch(batch, in->range(), batches_out));
     }
-
-    batches_out->emplace_back(final_batch, in->range());
   }
 
   return Status::OK();
@@ -185,10 +297,27 @@ void AddArrowOptionsToCLI(CLI::App* sub, ArrowOptions* out) {
       ->check(CLI::ExistingFile);
   sub->add_option("--arrow-buf-cap", out->buf_capacity, "Arrow input buffer capacity.")
       ->default_val(16 * 1024 * 1024);
+  buffer::AddPageSizeOptionToCLI(sub, "--arrow-buf-pages", &out->buf_pages);
   sub->add_flag(
          "--arrow-seq-col", out->seq_column,
          "Arrow parser, retain ordering information by adding a sequence number column.")
       ->default_val(false);
+  sub->add_option("--arrow-chunk-size", out->chunk_size,
+                  "Arrow parser, split buffers into chunks of about this many bytes at "
+                  "newlines, and parse the chunks in parallel. 0 disables chunking.")
+      ->default_val(0);
+  sub->add_option("--arrow-chunk-threads", out->chunk_threads,
+                  "Arrow parser, total number of threads parsing chunks, including "
+                  "converter threads. 0 uses the number of hardware threads.")
+      ->default_val(0);
+  sub->add_option("--columns", out->columns,
+                  "Parse only these top-level fields of the schema, comma-separated. "
+                  "Other fields are skipped. Arrow, simdjson and RapidJSON parsers only.")
+      ->delimiter(',');
+  sub->add_option("--timestamps", out->timestamps,
+                  "Convert these utf8 fields holding ISO-8601 timestamps to Arrow "
+                  "timestamps in nanoseconds since the epoch, UTC, comma-separated.")
+      ->delimiter(',');
 }
 
 }  // namespace bolson::parse
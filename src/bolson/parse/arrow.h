@@ -20,10 +20,14 @@
 
 #include <CLI/CLI.hpp>
 #include <memory>
+#include <string>
 #include <utility>
 #include <variant>
+#include <vector>
 
+#include "bolson/buffer/huge_page_allocator.h"
 #include "bolson/parse/parser.h"
+#include "bolson/parse/pool.h"
 #include "bolson/status.h"
 #include "bolson/utils.h"
 
@@ -38,6 +42,18 @@ namespace bolson::parse {
 auto ReadSchemaFromFile(const std::string& file, std::shared_ptr<arrow::Schema>* out)
     -> Status;
 
+/**
+ * \brief Project a schema on a subset of its top-level fields.
+ * \param schema  The schema to project.
+ * \param columns Names of the fields to keep, in the order of the result. If empty, all
+ *                fields are kept.
+ * \param out     The projected schema.
+ * \return Status::OK() if successful, some error otherwise.
+ */
+auto ProjectSchema(const std::shared_ptr<arrow::Schema>& schema,
+                   const std::vector<std::string>& columns,
+                   std::shared_ptr<arrow::Schema>* out) -> Status;
+
 /// \brief Options for Arrow's built-in JSON parser.
 struct ArrowOptions {
   /// Arrow schema.
@@ -48,10 +64,25 @@ struct ArrowOptions {
   size_t num_buffers = 0;
   /// Capacity of input buffers.
   size_t buf_capacity = 16 * 1024 * 1024;
+  /// Page size backing the input buffers.
+  buffer::PageSize buf_pages = buffer::PageSize::DEFAULT;
+  /// Whether input buffers must occupy whole pages, to place them on NUMA nodes.
+  bool buf_page_aligned = false;
   /// Whether to store sequence numbers as a column.
   bool seq_column = true;
+  /// Split buffers into chunks of about this many bytes to parse in parallel, 0 = off.
+  size_t chunk_size = 0;
+  /// Number of threads parsing chunks, 0 = number of hardware threads.
+  size_t chunk_threads = 0;
+  /// Top-level fields to parse. Other fields of the JSONs are skipped. Empty = all.
+  std::vector<std::string> columns;
+  /// Top-level utf8 fields holding ISO-8601 timestamps, to convert to Arrow timestamps.
+  std::vector<std::string> timestamps;
 
   auto ReadSchema() -> Status;
+
+  /// \brief Obtain the schema, read from file if not set, projected on the columns.
+  auto ProjectedSchema(std::shared_ptr<arrow::Schema>* out) const -> Status;
 };
 
 /// \brief Options exposed to CLI.
@@ -60,19 +91,46 @@ void AddArrowOptionsToCLI(CLI::App* sub, ArrowOptions* out);
 /// \brief Parser implementation using Arrow's built-in JSON parser.
 class ArrowParser : public Parser {
  public:
-  explicit ArrowParser(arrow::json::ParseOptions parse_options,
-                       arrow::json::ReadOptions read_options, bool seq_column)
+  explicit ArrowParser(arrow::json::ParseOptions parse_options, bool seq_column,
+                       size_t chunk_size = 0, std::shared_ptr<TaskPool> pool = nullptr)
       : parse_opts(std::move(parse_options)),
-        read_opts(read_options),
-        seq_column(seq_column) {}
-
+        seq_column(seq_column),
+        chunk_size(chunk_size),
+        pool(std::move(pool)),
+        batch_type(arrow::struct_(parse_opts.explicit_schema->fields())),
+        batch_schema(arrow::schema(parse_opts.explicit_schema->fields())) {}
+
+  /**
+   * \brief Parse buffers containing raw JSON data.
+   *
+   * If a chunk size and pool are set, buffers larger than the chunk size are split at
+   * newlines and the chunks are parsed on the pool. Every chunk results in a separate
+   * batch, with the sub-range of sequence numbers of the JSONs in the chunk.
+   */
   auto Parse(const std::vector<illex::JSONBuffer*>& buffers_in,
              std::vector<ParsedBatch>* batches_out) -> Status override;
 
  private:
+  /// \brief Parse raw JSON data to a single RecordBatch without sequence numbers.
+  auto ParseRaw(const std::byte* data, size_t size,
+                std::shared_ptr<arrow::RecordBatch>* out) const -> Status;
+
+  /// \brief Parse a buffer in chunks on the pool.
+  auto ParseChunked(const illex::JSONBuffer& in, std::vector<ParsedBatch>* batches_out)
+      -> Status;
+
+  /// \brief Add sequence numbers to a parsed batch and append it to the output.
+  auto AppendBatch(const std::shared_ptr<arrow::RecordBatch>& batch,
+                   illex::SeqRange seq_range, std::vector<ParsedBatch>* batches_out) const
+      -> Status;
+
   arrow::json::ParseOptions parse_opts;
-  arrow::json::ReadOptions read_opts;
   bool seq_column;
+  size_t chunk_size;
+  std::shared_ptr<TaskPool> pool;
+  /// Type the parsed values are converted to, and schema of the resulting batches.
+  std::shared_ptr<arrow::DataType> batch_type;
+  std::shared_ptr<arrow::Schema> batch_schema;
 };
 
 /// \brief Context for Arrow parsers.
@@ -83,6 +141,8 @@ class ArrowParserContext : public ParserContext {
 
   auto parsers() -> std::vector<std::shared_ptr<Parser>> override;
 
+  [[nodiscard]] auto AcceptsForeignBuffers() const -> bool override { return true; }
+
   [[nodiscard]] auto input_schema() const -> std::shared_ptr<arrow::Schema> override;
   [[nodiscard]] auto output_schema() const -> std::shared_ptr<arrow::Schema> override;
 
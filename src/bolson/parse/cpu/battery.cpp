@@ -0,0 +1,53 @@
+// Copyright 2020 Teratide B.V.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "bolson/parse/cpu/battery.h"
+
+#include <arrow/api.h>
+
+#include <memory>
+
+#include "bolson/parse/opae/battery.h"
+#include "bolson/parse/parser.h"
+
+namespace bolson::parse::cpu {
+
+auto BatterySchema::input_schema() -> std::shared_ptr<arrow::Schema> {
+  return opae::BatteryParser::output_schema();
+}
+
+auto BatterySchema::output_schema(bool seq_column, std::shared_ptr<arrow::Schema>* out)
+    -> Status {
+  if (seq_column) {
+    BOLSON_ROE(WithSeqField(*input_schema(), out));
+  } else {
+    *out = input_schema();
+  }
+  return Status::OK();
+}
+
+auto BatterySchema::Finish(const std::shared_ptr<arrow::RecordBatch>& batch,
+                           illex::SeqRange seq_range, bool seq_column,
+                           arrow::MemoryPool* pool,
+                           std::shared_ptr<arrow::RecordBatch>* out) -> Status {
+  if (seq_column) {
+    BOLSON_ROE(AddSeqColumn(batch, seq_range, out, pool));
+  } else {
+    *out = AddSeqAsSchemaMeta(batch, seq_range);
+  }
+  return Status::OK();
+}
+
+}  // namespace bolson::parse::cpu
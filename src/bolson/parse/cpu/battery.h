@@ -0,0 +1,48 @@
+// Copyright 2020 Teratide B.V.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#pragma once
+
+#include <arrow/api.h>
+
+#include <array>
+#include <memory>
+
+#include "bolson/parse/cpu/fixed.h"
+#include "bolson/status.h"
+
+namespace bolson::parse::cpu {
+
+/// \brief The "battery status" schema, producing the same batches as the OPAE parser.
+struct BatterySchema {
+  static constexpr std::array<FieldSpec, 1> fields = {{
+      {"voltage", FieldKind::UINT64_LIST},
+  }};
+
+  static auto input_schema() -> std::shared_ptr<arrow::Schema>;
+  static auto output_schema(bool seq_column, std::shared_ptr<arrow::Schema>* out)
+      -> Status;
+  static auto Finish(const std::shared_ptr<arrow::RecordBatch>& batch,
+                     illex::SeqRange seq_range, bool seq_column,
+                     arrow::MemoryPool* pool, std::shared_ptr<arrow::RecordBatch>* out)
+      -> Status;
+};
+
+/// CPU parser for the "battery status" schema.
+using BatteryParser = FixedSchemaParser<BatterySchema>;
+/// Context for CPU parsers for the "battery status" schema.
+using BatteryParserContext = FixedSchemaParserContext<BatterySchema>;
+
+}  // namespace bolson::parse::cpu
@@ -0,0 +1,138 @@
+// Copyright 2020 Teratide B.V.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+namespace bolson::parse::cpu {
+
+/// Kinds of fields supported by fixed-schema parsers.
+enum class FieldKind {
+  UINT64,      ///< An unsigned integer, as arrow::uint64.
+  BOOL,        ///< A boolean, as arrow::boolean.
+  STRING,      ///< A string without escape sequences, as arrow::utf8.
+  UINT64_LIST  ///< An array of unsigned integers, as (fixed-size) list of arrow::uint64.
+};
+
+/// \brief Compile-time description of a JSON field.
+struct FieldSpec {
+  /// The name of the field.
+  std::string_view name;
+  /// The kind of the field.
+  FieldKind kind;
+  /// Number of items if the field is a fixed-size list, 0 otherwise.
+  int32_t list_size = 0;
+};
+
+/// \brief Cursor over raw JSON data, with scanning primitives for fixed-schema parsers.
+class Cursor {
+ public:
+  Cursor(const char* pos, const char* end) : begin_(pos), pos_(pos), end_(end) {}
+
+  /// \brief Return the offset of the cursor in the scanned data.
+  [[nodiscard]] auto offset() const -> size_t { return pos_ - begin_; }
+
+  /// \brief Skip whitespace and return whether the end of the data is reached.
+  auto AtEnd() -> bool {
+    SkipWhitespace();
+    return pos_ == end_;
+  }
+
+  /// \brief Consume a character, skipping preceding whitespace.
+  auto Expect(char c) -> bool {
+    SkipWhitespace();
+    if ((pos_ != end_) && (*pos_ == c)) {
+      pos_++;
+      return true;
+    }
+    return false;
+  }
+
+  /// \brief Consume a key and the colon that follows it.
+  auto ExpectKey(std::string_view key) -> bool {
+    if (!Expect('"')) return false;
+    if ((static_cast<size_t>(end_ - pos_) < key.size() + 1) ||
+        (std::memcmp(pos_, key.data(), key.size()) != 0) || (pos_[key.size()] != '"')) {
+      return false;
+    }
+    pos_ += key.size() + 1;
+    return Expect(':');
+  }
+
+  /// \brief Consume an unsigned integer.
+  auto ParseUInt64(uint64_t* out) -> bool {
+    SkipWhitespace();
+    const char* first = pos_;
+    uint64_t value = 0;
+    while ((pos_ != end_) && (*pos_ >= '0') && (*pos_ <= '9')) {
+      auto digit = static_cast<uint64_t>(*pos_ - '0');
+      if (value > (UINT64_MAX - digit) / 10) return false;
+      value = value * 10 + digit;
+      pos_++;
+    }
+    *out = value;
+    return pos_ != first;
+  }
+
+  /// \brief Consume a boolean.
+  auto ParseBool(bool* out) -> bool {
+    SkipWhitespace();
+    if (Match("true")) {
+      *out = true;
+      return true;
+    }
+    if (Match("false")) {
+      *out = false;
+      return true;
+    }
+    return false;
+  }
+
+  /// \brief Consume a string. Strings with escape sequences are not supported.
+  auto ParseString(std::string_view* out) -> bool {
+    if (!Expect('"')) return false;
+    const auto* close = static_cast<const char*>(std::memchr(pos_, '"', end_ - pos_));
+    if (close == nullptr) return false;
+    if (std::memchr(pos_, '\\', close - pos_) != nullptr) return false;
+    *out = std::string_view(pos_, close - pos_);
+    pos_ = close + 1;
+    return true;
+  }
+
+ private:
+  void SkipWhitespace() {
+    while ((pos_ != end_) &&
+           ((*pos_ == ' ') || (*pos_ == '\n') || (*pos_ == '\r') || (*pos_ == '\t'))) {
+      pos_++;
+    }
+  }
+
+  auto Match(std::string_view literal) -> bool {
+    if ((static_cast<size_t>(end_ - pos_) < literal.size()) ||
+        (std::memcmp(pos_, literal.data(), literal.size()) != 0)) {
+      return false;
+    }
+    pos_ += literal.size();
+    return true;
+  }
+
+  const char* begin_;
+  const char* pos_;
+  const char* end_;
+};
+
+}  // namespace bolson::parse::cpu
@@ -0,0 +1,303 @@
+// Copyright 2020 Teratide B.V.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#pragma once
+
+#include <arrow/api.h>
+
+#include <array>
+#include <cstring>
+#include <memory>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "bolson/parse/arrow.h"
+#include "bolson/parse/cpu/cursor.h"
+#include "bolson/parse/parser.h"
+#include "bolson/parse/timestamp.h"
+#include "bolson/status.h"
+
+/// CPU implementations of parsers specialized for a fixed schema.
+namespace bolson::parse::cpu {
+
+/// \brief Buffers to build an Arrow column of a fixed-schema field.
+struct ColumnBuilder {
+  explicit ColumnBuilder(arrow::MemoryPool* pool = arrow::default_memory_pool())
+      : values(pool), bools(pool), offsets(pool), chars(pool) {}
+
+  /// Unsigned integer values or list items.
+  arrow::TypedBufferBuilder<uint64_t> values;
+  /// Boolean values.
+  arrow::TypedBufferBuilder<bool> bools;
+  /// Offsets of strings or variable-length lists.
+  arrow::TypedBufferBuilder<int32_t> offsets;
+  /// String characters.
+  arrow::BufferBuilder chars;
+};
+
+/**
+ * \brief Parser for JSONs with fields of a fixed schema in a fixed order.
+ *
+ * The Schema type supplies the field table and the resulting Arrow schemas:
+ *  - `static constexpr std::array<FieldSpec, N> fields`
+ *  - `static auto input_schema() -> std::shared_ptr<arrow::Schema>`
+ *  - `static auto output_schema(bool seq_column, std::shared_ptr<arrow::Schema>* out)`
+ *  - `static auto Finish(batch, seq_range, seq_column, pool, out)` to add sequence
+ *    numbers, allocating from the memory pool.
+ *
+ * Scanning of every field is unrolled at compile time from the field table.
+ */
+template <typename Schema>
+class FixedSchemaParser : public Parser {
+ public:
+  static constexpr size_t kNumFields = Schema::fields.size();
+
+  explicit FixedSchemaParser(bool seq_column) : seq_column_(seq_column) {}
+
+  auto Parse(const std::vector<illex::JSONBuffer*>& buffers_in,
+             std::vector<ParsedBatch>* batches_out) -> Status override {
+    assert(batches_out != nullptr);
+    for (auto* in : buffers_in) {
+      assert(in != nullptr);
+      ParsedBatch parsed;
+      BOLSON_ROE(ParseBuffer(*in, &parsed));
+      batches_out->push_back(parsed);
+    }
+    return Status::OK();
+  }
+
+  /// \brief Set the memory pool, rebuilding the column builders from it.
+  auto set_memory_pool(arrow::MemoryPool* pool) -> Status override {
+    memory_pool_ = pool;
+    columns_.fill(ColumnBuilder(pool));
+    return Status::OK();
+  }
+
+ private:
+  auto ParseBuffer(const illex::JSONBuffer& in, ParsedBatch* out) -> Status {
+    const auto num_jsons = static_cast<int64_t>(in.range().last - in.range().first + 1);
+    BOLSON_ROE(Reset(num_jsons));
+
+    const auto* data = reinterpret_cast<const char*>(in.data());
+    Cursor cursor(data, data + in.size());
+    int64_t num_rows = 0;
+    while (!cursor.AtEnd()) {
+      if (!cursor.Expect('{')) return Unexpected(cursor, "{");
+      BOLSON_ROE(ParseFields(&cursor, std::make_index_sequence<kNumFields>{}));
+      if (!cursor.Expect('}')) return Unexpected(cursor, "}");
+      num_rows++;
+    }
+    if (num_rows != num_jsons) {
+      return Status(Error::GenericError,
+                    "Parsed " + std::to_string(num_rows) +
+                        " JSONs, but sequence range holds " + std::to_string(num_jsons) +
+                        ".");
+    }
+
+    arrow::ArrayVector columns;
+    BOLSON_ROE(FinishColumns(num_rows, &columns, std::make_index_sequence<kNumFields>{}));
+    auto batch = arrow::RecordBatch::Make(Schema::input_schema(), num_rows, columns);
+    std::shared_ptr<arrow::RecordBatch> result;
+    BOLSON_ROE(Schema::Finish(batch, in.range(), seq_column_, memory_pool_, &result));
+    BOLSON_ROE(ConvertTimestamps(&result));
+    *out = ParsedBatch(result, in.range());
+    return Status::OK();
+  }
+
+  auto Reset(int64_t num_jsons) -> Status {
+    for (size_t f = 0; f < kNumFields; f++) {
+      auto& column = columns_[f];
+      // Drop any values appended before parsing the previous buffer failed.
+      column.values.Reset();
+      column.bools.Reset();
+      column.offsets.Reset();
+      column.chars.Reset();
+      switch (Schema::fields[f].kind) {
+        case FieldKind::UINT64:
+          ARROW_ROE(column.values.Reserve(num_jsons));
+          break;
+        case FieldKind::BOOL:
+          ARROW_ROE(column.bools.Reserve(num_jsons));
+          break;
+        case FieldKind::STRING:
+          ARROW_ROE(column.offsets.Reserve(num_jsons + 1));
+          ARROW_ROE(column.offsets.Append(0));
+          break;
+        case FieldKind::UINT64_LIST:
+          ARROW_ROE(column.values.Reserve(num_jsons * Schema::fields[f].list_size));
+          if (Schema::fields[f].list_size == 0) {
+            ARROW_ROE(column.offsets.Reserve(num_jsons + 1));
+            ARROW_ROE(column.offsets.Append(0));
+          }
+          break;
+      }
+    }
+    return Status::OK();
+  }
+
+  template <size_t... I>
+  auto ParseFields(Cursor* cursor, std::index_sequence<I...>) -> Status {
+    auto status = Status::OK();
+    // Stops at the first field that fails.
+    static_cast<void>((((status = ParseField<I>(cursor)), status.ok()) && ...));
+    return status;
+  }
+
+  template <size_t I>
+  auto ParseField(Cursor* cursor) -> Status {
+    constexpr const FieldSpec& spec = Schema::fields[I];
+    auto& column = columns_[I];
+    if constexpr (I > 0) {
+      if (!cursor->Expect(',')) return Unexpected(*cursor, ",");
+    }
+    if (!cursor->ExpectKey(spec.name)) {
+      return Unexpected(*cursor, "key \"" + std::string(spec.name) + "\"");
+    }
+    if constexpr (spec.kind == FieldKind::UINT64) {
+      uint64_t value = 0;
+      if (!cursor->ParseUInt64(&value)) return Unexpected(*cursor, "unsigned integer");
+      ARROW_ROE(column.values.Append(value));
+    } else if constexpr (spec.kind == FieldKind::BOOL) {
+      bool value = false;
+      if (!cursor->ParseBool(&value)) return Unexpected(*cursor, "boolean");
+      ARROW_ROE(column.bools.Append(value));
+    } else if constexpr (spec.kind == FieldKind::STRING) {
+      std::string_view value;
+      if (!cursor->ParseString(&value)) return Unexpected(*cursor, "unescaped string");
+      ARROW_ROE(column.chars.Append(value.data(), value.size()));
+      ARROW_ROE(column.offsets.Append(static_cast<int32_t>(column.chars.length())));
+    } else if constexpr (spec.kind == FieldKind::UINT64_LIST) {
+      if (!cursor->Expect('[')) return Unexpected(*cursor, "[");
+      int32_t num_items = 0;
+      if (!cursor->Expect(']')) {
+        do {
+          uint64_t value = 0;
+          if (!cursor->ParseUInt64(&value)) {
+            return Unexpected(*cursor, "unsigned integer");
+          }
+          ARROW_ROE(column.values.Append(value));
+          num_items++;
+        } while (cursor->Expect(','));
+        if (!cursor->Expect(']')) return Unexpected(*cursor, "]");
+      }
+      if constexpr (spec.list_size > 0) {
+        if (num_items != spec.list_size) {
+          return Status(Error::GenericError,
+                        "Field \"" + std::string(spec.name) + "\" holds " +
+                            std::to_string(num_items) + " items, expected " +
+                            std::to_string(spec.list_size) + ".");
+        }
+      } else {
+        ARROW_ROE(column.offsets.Append(static_cast<int32_t>(column.values.length())));
+      }
+    }
+    return Status::OK();
+  }
+
+  template <size_t... I>
+  auto FinishColumns(int64_t num_rows, arrow::ArrayVector* out, std::index_sequence<I...>)
+      -> Status {
+    auto status = Status::OK();
+    static_cast<void>((((status = FinishColumn<I>(num_rows, out)), status.ok()) && ...));
+    return status;
+  }
+
+  template <size_t I>
+  auto FinishColumn(int64_t num_rows, arrow::ArrayVector* out) -> Status {
+    constexpr const FieldSpec& spec = Schema::fields[I];
+    auto& column = columns_[I];
+    std::shared_ptr<arrow::Buffer> values;
+    std::shared_ptr<arrow::Buffer> offsets;
+    if constexpr (spec.kind == FieldKind::UINT64) {
+      ARROW_ROE(column.values.Finish(&values));
+      out->push_back(std::make_shared<arrow::UInt64Array>(num_rows, values));
+    } else if constexpr (spec.kind == FieldKind::BOOL) {
+      ARROW_ROE(column.bools.Finish(&values));
+      out->push_back(std::make_shared<arrow::BooleanArray>(num_rows, values));
+    } else if constexpr (spec.kind == FieldKind::STRING) {
+      ARROW_ROE(column.offsets.Finish(&offsets));
+      ARROW_ROE(column.chars.Finish(&values));
+      out->push_back(std::make_shared<arrow::StringArray>(num_rows, offsets, values));
+    } else if constexpr (spec.kind == FieldKind::UINT64_LIST) {
+      auto num_items = column.values.length();
+      ARROW_ROE(column.values.Finish(&values));
+      auto items = std::make_shared<arrow::UInt64Array>(num_items, values);
+      auto type = Schema::input_schema()->field(I)->type();
+      if constexpr (spec.list_size > 0) {
+        out->push_back(
+            std::make_shared<arrow::FixedSizeListArray>(type, num_rows, items));
+      } else {
+        ARROW_ROE(column.offsets.Finish(&offsets));
+        out->push_back(
+            std::make_shared<arrow::ListArray>(type, num_rows, offsets, items));
+      }
+    }
+    return Status::OK();
+  }
+
+  static auto Unexpected(const Cursor& cursor, const std::string& expected) -> Status {
+    return Status(Error::GenericError, "Expected " + expected + " at offset " +
+                                           std::to_string(cursor.offset()) + ".");
+  }
+
+  bool seq_column_;
+  std::array<ColumnBuilder, kNumFields> columns_;
+};
+
+/// \brief Context for fixed-schema parsers, using the Arrow buffer options.
+template <typename Schema>
+class FixedSchemaParserContext : public ParserContext {
+ public:
+  static auto Make(const ArrowOptions& opts, size_t num_parsers,
+                   std::shared_ptr<ParserContext>* out) -> Status {
+    auto result = std::make_shared<FixedSchemaParserContext<Schema>>();
+    result->allocator_ = buffer::MakeHostAllocator(opts.buf_pages, opts.buf_page_aligned);
+    BOLSON_ROE(Schema::output_schema(opts.seq_column, &result->output_schema_));
+    BOLSON_ROE(WithTimestampFields(*result->output_schema_, opts.timestamps,
+                                   &result->output_schema_));
+    for (size_t p = 0; p < num_parsers; p++) {
+      auto parser = std::make_shared<FixedSchemaParser<Schema>>(opts.seq_column);
+      parser->set_timestamp_columns(opts.timestamps);
+      result->parsers_.push_back(parser);
+    }
+    *out = std::static_pointer_cast<ParserContext>(result);
+
+    // Allocate buffers. Use number of parsers if number of buffers is 0 in options.
+    auto num_buffers = opts.num_buffers == 0 ? num_parsers : opts.num_buffers;
+    BOLSON_ROE(result->AllocateBuffers(num_buffers, opts.buf_capacity));
+    return Status::OK();
+  }
+
+  auto parsers() -> std::vector<std::shared_ptr<Parser>> override {
+    return CastPtrs<Parser>(parsers_);
+  }
+
+  [[nodiscard]] auto AcceptsForeignBuffers() const -> bool override { return true; }
+
+  [[nodiscard]] auto input_schema() const -> std::shared_ptr<arrow::Schema> override {
+    return Schema::input_schema();
+  }
+
+  [[nodiscard]] auto output_schema() const -> std::shared_ptr<arrow::Schema> override {
+    return output_schema_;
+  }
+
+ private:
+  std::shared_ptr<arrow::Schema> output_schema_;
+  std::vector<std::shared_ptr<FixedSchemaParser<Schema>>> parsers_;
+};
+
+}  // namespace bolson::parse::cpu
@@ -0,0 +1,55 @@
+// Copyright 2020 Teratide B.V.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "bolson/parse/cpu/trip.h"
+
+#include <arrow/api.h>
+
+#include <memory>
+
+#include "bolson/parse/opae/trip.h"
+
+namespace bolson::parse::cpu {
+
+auto TripSchema::input_schema() -> std::shared_ptr<arrow::Schema> {
+  return opae::TripParser::input_schema();
+}
+
+auto TripSchema::output_schema(bool /*seq_column*/, std::shared_ptr<arrow::Schema>* out)
+    -> Status {
+  *out = opae::TripParser::output_schema();
+  return Status::OK();
+}
+
+auto TripSchema::Finish(const std::shared_ptr<arrow::RecordBatch>& batch,
+                        illex::SeqRange seq_range, bool /*seq_column*/,
+                        arrow::MemoryPool* pool,
+                        std::shared_ptr<arrow::RecordBatch>* out) -> Status {
+  std::shared_ptr<arrow::UInt64Array> seq;
+  arrow::UInt64Builder builder(pool);
+  ARROW_ROE(builder.Reserve(batch->num_rows()));
+  for (uint64_t s = seq_range.first; s <= seq_range.last; s++) {
+    builder.UnsafeAppend(s);
+  }
+  ARROW_ROE(builder.Finish(&seq));
+
+  arrow::ArrayVector columns = batch->columns();
+  columns.insert(columns.begin(), seq);
+  *out = arrow::RecordBatch::Make(opae::TripParser::output_schema(), batch->num_rows(),
+                                  columns);
+  return Status::OK();
+}
+
+}  // namespace bolson::parse::cpu
@@ -0,0 +1,67 @@
+// Copyright 2020 Teratide B.V.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#pragma once
+
+#include <arrow/api.h>
+
+#include <array>
+#include <memory>
+
+#include "bolson/parse/cpu/fixed.h"
+#include "bolson/status.h"
+
+namespace bolson::parse::cpu {
+
+/// \brief The "trip report" schema, producing the same batches as the OPAE parser.
+struct TripSchema {
+  static constexpr std::array<FieldSpec, 19> fields = {{
+      {"timestamp", FieldKind::STRING},
+      {"timezone", FieldKind::UINT64},
+      {"vin", FieldKind::UINT64},
+      {"odometer", FieldKind::UINT64},
+      {"hypermiling", FieldKind::BOOL},
+      {"avgspeed", FieldKind::UINT64},
+      {"sec_in_band", FieldKind::UINT64_LIST, 12},
+      {"miles_in_time_range", FieldKind::UINT64_LIST, 24},
+      {"const_speed_miles_in_band", FieldKind::UINT64_LIST, 12},
+      {"vary_speed_miles_in_band", FieldKind::UINT64_LIST, 12},
+      {"sec_decel", FieldKind::UINT64_LIST, 10},
+      {"sec_accel", FieldKind::UINT64_LIST, 10},
+      {"braking", FieldKind::UINT64_LIST, 6},
+      {"accel", FieldKind::UINT64_LIST, 6},
+      {"orientation", FieldKind::BOOL},
+      {"small_speed_var", FieldKind::UINT64_LIST, 13},
+      {"large_speed_var", FieldKind::UINT64_LIST, 13},
+      {"accel_decel", FieldKind::UINT64},
+      {"speed_changes", FieldKind::UINT64},
+  }};
+
+  static auto input_schema() -> std::shared_ptr<arrow::Schema>;
+  /// Like the OPAE parser, the output always contains the sequence number column.
+  static auto output_schema(bool seq_column, std::shared_ptr<arrow::Schema>* out)
+      -> Status;
+  static auto Finish(const std::shared_ptr<arrow::RecordBatch>& batch,
+                     illex::SeqRange seq_range, bool seq_column,
+                     arrow::MemoryPool* pool, std::shared_ptr<arrow::RecordBatch>* out)
+      -> Status;
+};
+
+/// CPU parser for the "trip report" schema.
+using TripParser = FixedSchemaParser<TripSchema>;
+/// Context for CPU parsers for the "trip report" schema.
+using TripParserContext = FixedSchemaParserContext<TripSchema>;
+
+}  // namespace bolson::parse::cpu
@@ -17,14 +17,23 @@
 #include <CLI/CLI.hpp>
 
 #include "bolson/parse/arrow.h"
+#include "bolson/parse/cpu/battery.h"
+#include "bolson/parse/cpu/trip.h"
 #include "bolson/parse/opae/battery.h"
 #include "bolson/parse/opae/trip.h"
+#include "bolson/parse/rapidjson.h"
+#include "bolson/parse/simd.h"
+#include "bolson/parse/wait.h"
 
 namespace bolson::parse {
 
 /// Available parser implementations.
 enum class Impl {
   ARROW,         ///< A CPU version based on Arrow's internal JSON parser using RapidJSON.
+  SIMDJSON,      ///< A CPU version based on simdjson, using the Arrow options.
+  RAPIDJSON,     ///< A CPU version based on RapidJSON SAX, using the Arrow options.
+  CPU_BATTERY,   ///< A CPU version specialized for the "battery status" schema.
+  CPU_TRIP,      ///< A CPU version specialized for the "trip report" schema.
   OPAE_BATTERY,  ///< An FPGA version for the "battery status" schema.
   OPAE_TRIP      ///< An FPGA version for for the "trip report" schema.
 };
@@ -36,10 +45,16 @@ struct ParserOptions {
   ArrowOptions arrow;
   opae::BatteryOptions battery;
   opae::TripOptions trip;
+  opae::Platform opae_platform = opae::Platform::OPAE;
+  WaitOptions opae_wait;
 
   static auto impls_map() -> std::map<std::string, parse::Impl> {
     static std::map<std::string, parse::Impl> result = {
         {"arrow", parse::Impl::ARROW},
+        {"simdjson", parse::Impl::SIMDJSON},
+        {"rapidjson", parse::Impl::RAPIDJSON},
+        {"cpu-battery", parse::Impl::CPU_BATTERY},
+        {"cpu-trip", parse::Impl::CPU_TRIP},
         {"opae-battery", parse::Impl::OPAE_BATTERY},
         {"opae-trip", parse::Impl::OPAE_TRIP}};
 
@@ -49,20 +64,30 @@ struct ParserOptions {
 
 inline void AddParserOptions(CLI::App* sub, ParserOptions* opts) {
   sub->add_option("-p,--parser", opts->impl,
-                  "Parser implementation. OPAE parsers have fixed schema and ignore "
-                  "schema supplied to -i.")
+                  "Parser implementation. OPAE and CPU battery/trip parsers have fixed "
+                  "schema and ignore schema supplied to -i.")
       ->transform(CLI::CheckedTransformer(ParserOptions::impls_map(), CLI::ignore_case))
       ->default_val(parse::Impl::ARROW);
 
   parse::AddArrowOptionsToCLI(sub, &opts->arrow);
   parse::opae::AddBatteryOptionsToCLI(sub, &opts->battery);
   parse::opae::AddTripOptionsToCLI(sub, &opts->trip);
+  parse::opae::AddPlatformOptionToCLI(sub, &opts->opae_platform);
+  parse::AddWaitOptionsToCLI(sub, &opts->opae_wait);
 }
 
 inline auto ToString(const Impl& impl) -> std::string {
   switch (impl) {
     case Impl::ARROW:
       return "Arrow (CPU)";
+    case Impl::SIMDJSON:
+      return "simdjson (CPU)";
+    case Impl::RAPIDJSON:
+      return "RapidJSON SAX (CPU)";
+    case Impl::CPU_BATTERY:
+      return "Battery status (CPU)";
+    case Impl::CPU_TRIP:
+      return "Trip report (CPU)";
     case Impl::OPAE_BATTERY:
       return "OPAE battery status (FPGA)";
     case Impl::OPAE_TRIP:
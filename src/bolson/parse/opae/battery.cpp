@@ -73,24 +73,21 @@ auto BatteryParserContext::PrepareOutputBatches() -> Status {
   return Status::OK();
 }
 
-auto BatteryParserContext::Make(const BatteryOptions& opts,
+auto BatteryParserContext::Make(const BatteryOptions& opts, Platform platform,
+                                const WaitOptions& wait,
                                 std::shared_ptr<ParserContext>* out) -> Status {
   std::string afu_id;
   DeriveAFUID(opts.afu_id, BOLSON_DEFAULT_OPAE_BATTERY_AFUID, opts.num_parsers, &afu_id);
   SPDLOG_DEBUG("BatteryParserContext | Using AFU ID: {}", afu_id);
 
   // Create and set up result.
-  auto result = std::shared_ptr<BatteryParserContext>(new BatteryParserContext(opts));
+  auto result = std::shared_ptr<BatteryParserContext>(
+      new BatteryParserContext(opts, platform, wait));
   SPDLOG_DEBUG("BatteryParserContext | Setting up for {} parsers.", result->num_parsers_);
 
-  FLETCHER_ROE(fletcher::Platform::Make("opae", &result->platform, false));
-
+  // Create and initialize the platform.
   result->afu_id_ = afu_id;
-  char* afu_id_ptr = result->afu_id_.data();
-  result->platform->init_data = &afu_id_ptr;
-
-  // Initialize the platform.
-  FLETCHER_ROE(result->platform->Init());
+  BOLSON_ROE(MakePlatform(platform, &result->afu_id_, &result->platform));
 
   // Allocate input buffers.
   BOLSON_ROE(result->AllocateBuffers(result->num_parsers_,
@@ -145,7 +142,7 @@ auto BatteryParserContext::PrepareParsers() -> Status {
   for (size_t i = 0; i < num_parsers_; i++) {
     parsers_.push_back(std::make_shared<BatteryParser>(
         platform.get(), context.get(), kernel.get(), &h2d_addr_map, i, num_parsers_,
-        raw_out_offsets[i], raw_out_values[i], &platform_mutex, seq_column));
+        raw_out_offsets[i], raw_out_values[i], seq_column, wait_));
   }
   return Status::OK();
 }
@@ -170,9 +167,14 @@ auto BatteryParserContext::output_schema() const -> std::shared_ptr<arrow::Schem
   return output_schema_;
 }
 
-BatteryParserContext::BatteryParserContext(const BatteryOptions& opts)
-    : num_parsers_(opts.num_parsers), afu_id_(opts.afu_id), seq_column(opts.seq_column) {
-  allocator_ = std::make_shared<buffer::OpaeAllocator>();
+BatteryParserContext::BatteryParserContext(const BatteryOptions& opts,
+                                           Platform platform, const WaitOptions& wait)
+    : num_parsers_(opts.num_parsers),
+      afu_id_(opts.afu_id),
+      seq_column(opts.seq_column),
+      wait_(wait) {
+  // Only the OPAE platform requires buffers backed by huge pages.
+  allocator_ = std::make_shared<buffer::OpaeAllocator>(platform == Platform::OPAE);
 }
 
 static auto WrapOutput(int32_t num_rows, uint8_t* offsets, uint8_t* values,
@@ -209,11 +211,11 @@ static auto WrapOutput(int32_t num_rows, uint8_t* offsets, uint8_t* values,
 }
 
 auto BatteryParser::ParseOne(illex::JSONBuffer* in, ParsedBatch* out) -> Status {
-  platform_mutex->lock();
+  // Every parser only accesses the registers of its own instance, so parsers don't need
+  // to serialize their MMIO accesses.
   auto* p = platform_;
-  SPDLOG_DEBUG("BatteryParser {:2} | Obtained platform lock", idx_);
   SPDLOG_DEBUG("BatteryParser {:2} | Attempting to parse buffer:\n {}", idx_,
-               ToString(*in, true));
+               parse::ToString(*in, true));
 
   // Reset the kernel, start it, and poll until completion.
   // FLETCHER_ROE(kernel_->Reset());
@@ -248,35 +250,23 @@ auto BatteryParser::ParseOne(illex::JSONBuffer* in, ParsedBatch* out) -> Status
   }
 
   // FLETCHER_ROE(kernel_->PollUntilDone());
-  bool done = false;
-  uint32_t status = 0;
   dau_t num_rows;
-
-  do {
+  auto poll = [&](bool* done) -> Status {
+    uint32_t status = 0;
+    BOLSON_ROE(ReadMMIO(p, status_offset(idx_), &status, idx_, "status"));
 #ifndef NDEBUG
-    ReadMMIO(p, status_offset(idx_), &status, idx_, "status");
-    done = (status & stat_done) == stat_done;
-
     // Obtain the result for debugging.
     ReadMMIO(p, result_rows_offset_lo(idx_), &num_rows.lo, idx_, "rows lo");
     ReadMMIO(p, result_rows_offset_hi(idx_), &num_rows.hi, idx_, "rows hi");
     SPDLOG_DEBUG("BatteryParser {:2} | Number of rows: {}", idx_, num_rows.full);
-    platform_mutex->unlock();
-    std::this_thread::sleep_for(std::chrono::milliseconds(500));
-    platform_mutex->lock();
-#else
-    platform_->ReadMMIO(status_offset(idx_), &status);
-    done = (status & stat_done) == stat_done;
-
-    platform_mutex->unlock();
-    std::this_thread::sleep_for(std::chrono::microseconds(BOLSON_QUEUE_WAIT_US));
-    platform_mutex->lock();
 #endif
-  } while (!done);
+    *done = (status & stat_done) == stat_done;
+    return Status::OK();
+  };
+  BOLSON_ROE(waiter_.Wait(poll, in->size()));
 
   ReadMMIO(p, result_rows_offset_lo(idx_), &num_rows.lo, idx_, "rows lo");
   ReadMMIO(p, result_rows_offset_hi(idx_), &num_rows.hi, idx_, "rows hi");
-  platform_mutex->unlock();
 
   std::shared_ptr<arrow::RecordBatch> out_batch;
   BOLSON_ROE(WrapOutput(num_rows.full, reinterpret_cast<uint8_t*>(raw_out_offsets),
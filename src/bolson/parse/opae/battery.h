@@ -24,6 +24,7 @@
 #include "bolson/buffer/opae_allocator.h"
 #include "bolson/parse/opae/opae.h"
 #include "bolson/parse/parser.h"
+#include "bolson/parse/wait.h"
 #include "bolson/utils.h"
 
 #define BOLSON_DEFAULT_OPAE_BATTERY_PARSERS 8
@@ -48,7 +49,7 @@ class BatteryParser : public Parser {
   BatteryParser(fletcher::Platform* platform, fletcher::Context* context,
                 fletcher::Kernel* kernel, AddrMap* addr_map, size_t parser_idx,
                 size_t num_parsers, std::byte* raw_out_offsets, std::byte* raw_out_values,
-                std::mutex* platform_mutex, bool seq_column)
+                bool seq_column, const WaitOptions& wait)
       : platform_(platform),
         context_(context),
         kernel_(kernel),
@@ -57,14 +58,29 @@ class BatteryParser : public Parser {
         num_parsers(num_parsers),
         raw_out_offsets(raw_out_offsets),
         raw_out_values(raw_out_values),
-        platform_mutex(platform_mutex),
-        seq_column(seq_column) {}
+        seq_column(seq_column),
+        waiter_(wait) {}
 
   auto Parse(const std::vector<illex::JSONBuffer*>& in, std::vector<ParsedBatch>* out)
       -> Status override;
 
   auto ParseOne(illex::JSONBuffer* in, ParsedBatch* out) -> Status;
 
+  [[nodiscard]] auto wait_metrics() const -> WaitMetrics override {
+    return waiter_.metrics();
+  }
+
+  // Register offsets of the parser instances. Every instance has its own registers.
+  [[nodiscard]] auto custom_regs_offset() const -> size_t;
+  [[nodiscard]] auto ctrl_offset(size_t idx) const -> size_t;
+  [[nodiscard]] auto status_offset(size_t idx) const -> size_t;
+  [[nodiscard]] auto result_rows_offset_lo(size_t idx) const -> size_t;
+  [[nodiscard]] auto result_rows_offset_hi(size_t idx) const -> size_t;
+  [[nodiscard]] auto input_firstidx_offset(size_t idx) const -> size_t;
+  [[nodiscard]] auto input_lastidx_offset(size_t idx) const -> size_t;
+  [[nodiscard]] auto input_values_lo_offset(size_t idx) const -> size_t;
+  [[nodiscard]] auto input_values_hi_offset(size_t idx) const -> size_t;
+
  private:
   static const uint32_t stat_idle = (1u << 0u);
   static const uint32_t stat_busy = (1u << 1u);
@@ -105,16 +121,6 @@ class BatteryParser : public Parser {
   // 3 result num rows hi
   static const size_t custom_regs_per_inst = 4;
 
-  [[nodiscard]] auto custom_regs_offset() const -> size_t;
-  [[nodiscard]] auto ctrl_offset(size_t idx) const -> size_t;
-  [[nodiscard]] auto status_offset(size_t idx) const -> size_t;
-  [[nodiscard]] auto result_rows_offset_lo(size_t idx) const -> size_t;
-  [[nodiscard]] auto result_rows_offset_hi(size_t idx) const -> size_t;
-  [[nodiscard]] auto input_firstidx_offset(size_t idx) const -> size_t;
-  [[nodiscard]] auto input_lastidx_offset(size_t idx) const -> size_t;
-  [[nodiscard]] auto input_values_lo_offset(size_t idx) const -> size_t;
-  [[nodiscard]] auto input_values_hi_offset(size_t idx) const -> size_t;
-
   size_t idx_;
   size_t num_parsers;
   fletcher::Platform* platform_;
@@ -123,14 +129,14 @@ class BatteryParser : public Parser {
   AddrMap* h2d_addr_map;
   std::byte* raw_out_offsets;
   std::byte* raw_out_values;
-  std::mutex* platform_mutex;
   bool seq_column;
+  Waiter waiter_;
 };
 
 class BatteryParserContext : public ParserContext {
  public:
-  static auto Make(const BatteryOptions& opts, std::shared_ptr<ParserContext>* out)
-      -> Status;
+  static auto Make(const BatteryOptions& opts, Platform platform, const WaitOptions& wait,
+                   std::shared_ptr<ParserContext>* out) -> Status;
 
   auto parsers() -> std::vector<std::shared_ptr<Parser>> override;
   [[nodiscard]] auto CheckThreadCount(size_t num_threads) const -> size_t override;
@@ -139,7 +145,8 @@ class BatteryParserContext : public ParserContext {
   [[nodiscard]] auto output_schema() const -> std::shared_ptr<arrow::Schema> override;
 
  private:
-  explicit BatteryParserContext(const BatteryOptions& opts);
+  BatteryParserContext(const BatteryOptions& opts, Platform platform,
+                       const WaitOptions& wait);
 
   auto PrepareInputBatches() -> Status;
   auto PrepareOutputBatches() -> Status;
@@ -161,12 +168,11 @@ class BatteryParserContext : public ParserContext {
 
   std::vector<std::shared_ptr<BatteryParser>> parsers_;
 
-  std::mutex platform_mutex;
-
   std::shared_ptr<arrow::Schema> input_schema_;
   std::shared_ptr<arrow::Schema> output_schema_;
 
   bool seq_column;
+  WaitOptions wait_;
 };
 
 }  // namespace bolson::parse::opae
@@ -0,0 +1,105 @@
+// Copyright 2020 Teratide B.V.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "bolson/parse/opae/bench.h"
+
+#include <putong/timer.h>
+
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "bolson/parse/opae/battery.h"
+
+namespace bolson::parse::opae {
+
+/// \brief Access the registers of a battery status parser instance.
+static void AccessRegisters(const BenchOptions& opt, fletcher::Platform* platform,
+                            const BatteryParser* parser, size_t idx, std::mutex* lock,
+                            Status* status) {
+  // Write the input first index, which the parser instance only reads when started.
+  for (size_t a = 0; a < opt.accesses; a++) {
+    uint32_t value = 0;
+    if (lock != nullptr) lock->lock();
+    auto write_offset = parser->input_firstidx_offset(idx);
+    *status = WriteMMIO(platform, write_offset, 0, idx);
+    if (status->ok()) {
+      *status = ReadMMIO(platform, parser->status_offset(idx), &value, idx);
+    }
+    if (lock != nullptr) lock->unlock();
+    if (!status->ok()) return;
+  }
+}
+
+/// \brief Run the MMIO benchmark for some number of threads, return the time taken.
+static auto RunMMIOBench(const BenchOptions& opt, size_t num_threads, bool locked,
+                         double* seconds) -> Status {
+  std::string afu_id;
+  BOLSON_ROE(
+      DeriveAFUID("", BOLSON_DEFAULT_OPAE_BATTERY_AFUID, num_threads, &afu_id));
+  std::shared_ptr<fletcher::Platform> platform;
+  BOLSON_ROE(MakePlatform(opt.platform, &afu_id, &platform));
+
+  // Parsers are only used for their register map.
+  std::vector<BatteryParser> parsers;
+  for (size_t t = 0; t < num_threads; t++) {
+    parsers.emplace_back(platform.get(), nullptr, nullptr, nullptr, t, num_threads,
+                         nullptr, nullptr, false, WaitOptions());
+  }
+
+  std::mutex lock;
+  std::vector<Status> statuses(num_threads);
+  std::vector<std::thread> threads;
+  putong::Timer<> timer(true);
+  for (size_t t = 0; t < num_threads; t++) {
+    threads.emplace_back(AccessRegisters, opt, platform.get(), &parsers[t], t,
+                         locked ? &lock : nullptr, &statuses[t]);
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  timer.Stop();
+  *seconds = timer.seconds();
+
+  for (const auto& status : statuses) {
+    BOLSON_ROE(status);
+  }
+  return Status::OK();
+}
+
+auto BenchMMIO(const BenchOptions& opt) -> Status {
+  spdlog::info("Accessing MMIO registers {} times per thread on the {} platform...",
+               opt.accesses, ToString(opt.platform));
+
+  std::cout << "Platform lock,Threads,Accesses,Time,MAccesses/s" << std::endl;
+  for (auto locked : {true, false}) {
+    for (auto num_threads : opt.threads) {
+      double seconds = 0.0;
+      BOLSON_ROE(RunMMIOBench(opt, num_threads, locked, &seconds));
+      // Every access is a write and a read.
+      auto accesses = 2 * opt.accesses * num_threads;
+      std::cout << locked << "," << num_threads << "," << accesses << ",";
+      std::cout << std::setprecision(9) << std::fixed << seconds << ","
+                << static_cast<double>(accesses) / seconds * 1e-6;
+      std::cout << std::endl;
+    }
+  }
+
+  return Status::OK();
+}
+
+}  // namespace bolson::parse::opae
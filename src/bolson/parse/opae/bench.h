@@ -0,0 +1,42 @@
+// Copyright 2020 Teratide B.V.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <vector>
+
+#include "bolson/parse/opae/opae.h"
+#include "bolson/status.h"
+
+namespace bolson::parse::opae {
+
+/// Options for the OPAE MMIO contention benchmark.
+struct BenchOptions {
+  /// Numbers of threads to benchmark, each driving its own parser instance.
+  std::vector<size_t> threads = {1, 2, 4, 8};
+  /// Number of register write and read pairs per thread.
+  size_t accesses = 1024 * 1024;
+  /// The Fletcher platform to access the registers of.
+  Platform platform = Platform::EMU;
+};
+
+/**
+ * \brief Run the OPAE MMIO contention benchmark.
+ *
+ * Threads access the registers of their own "battery status" parser instance, either
+ * concurrently, or serialized through one platform lock like the parsers used to.
+ */
+auto BenchMMIO(const BenchOptions& opt) -> Status;
+
+}  // namespace bolson::parse::opae
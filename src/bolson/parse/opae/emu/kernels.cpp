@@ -0,0 +1,323 @@
+// Copyright 2020 Teratide B.V.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "bolson/parse/opae/emu/kernels.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <string_view>
+
+#include "bolson/parse/cpu/cursor.h"
+
+namespace bolson::parse::opae::emu {
+
+// AFU ID bases of the hardware designs, see BOLSON_DEFAULT_OPAE_BATTERY_AFUID and
+// BOLSON_DEFAULT_OPAE_TRIP_AFUID.
+static const std::string_view battery_afu_id_base = "9ca43fb0-c340-4908-b79b-5c89b4ef5e";
+static const std::string_view trip_afu_id_base = "5d2f9dba-e8d0-44f8-943d-36b25c2d40";
+
+// Fletcher default regs:
+// 0 control
+// 1 status
+// 2 return lo
+// 3 return hi
+static const size_t default_regs = 4;
+
+auto Kernel::Read(size_t offset) const -> uint32_t { return (*regs_)[offset].load(); }
+
+void Kernel::Write(size_t offset, uint32_t value) { (*regs_)[offset].store(value); }
+
+auto Kernel::ReadAddress(size_t offset) const -> std::byte* {
+  uint64_t address = (static_cast<uint64_t>(Read(offset + 1)) << 32u) | Read(offset);
+  return reinterpret_cast<std::byte*>(address);
+}
+
+void Kernel::Write64(size_t offset, uint64_t value) {
+  Write(offset, static_cast<uint32_t>(value));
+  Write(offset + 1, static_cast<uint32_t>(value >> 32u));
+}
+
+void Kernel::AddBusyTime(std::chrono::steady_clock::time_point start) {
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  busy_ns_ += std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+}
+
+// Battery status register map, see bolson::parse::opae::BatteryParser.
+// Per instance: input range, output range, input values address, output offsets and
+// values addresses, and the custom registers: control, status, rows lo, rows hi.
+static const size_t battery_regs_per_inst = 2 * 2 + 2 + 4;
+static const size_t battery_custom_regs_per_inst = 4;
+
+BatteryKernel::BatteryKernel(Registers* regs, size_t num_parsers)
+    : Kernel(regs), num_parsers_(num_parsers), threads_(num_parsers) {}
+
+BatteryKernel::~BatteryKernel() { Join(); }
+
+auto BatteryKernel::custom_regs_offset() const -> size_t {
+  return default_regs + num_parsers_ * battery_regs_per_inst;
+}
+
+auto BatteryKernel::input_values_offset(size_t idx) const -> size_t {
+  return default_regs + 2 * 2 * num_parsers_ + 2 * idx;
+}
+
+auto BatteryKernel::output_offsets_offset(size_t idx) const -> size_t {
+  return default_regs + (2 * 2 + 2) * num_parsers_ + 4 * idx;
+}
+
+auto BatteryKernel::output_values_offset(size_t idx) const -> size_t {
+  return output_offsets_offset(idx) + 2;
+}
+
+void BatteryKernel::OnWrite(uint64_t offset, uint32_t value) {
+  // Parsers are controlled through their own control register.
+  auto custom = custom_regs_offset();
+  auto end = custom + battery_custom_regs_per_inst * num_parsers_;
+  if ((offset < custom) || (offset >= end) ||
+      ((offset - custom) % battery_custom_regs_per_inst != 0)) {
+    return;
+  }
+  auto idx = (offset - custom) / battery_custom_regs_per_inst;
+  if ((value & ctrl_reset) != 0) {
+    if (threads_[idx].joinable()) threads_[idx].join();
+    Write(offset + 1, stat_idle);
+    Write64(offset + 2, 0);
+  }
+  if ((value & ctrl_start) != 0) {
+    if (threads_[idx].joinable()) threads_[idx].join();
+    Write(offset + 1, stat_busy);
+    runs_++;
+    threads_[idx] = std::thread(&BatteryKernel::Run, this, idx);
+  }
+}
+
+void BatteryKernel::Join() {
+  for (auto& thread : threads_) {
+    if (thread.joinable()) thread.join();
+  }
+}
+
+void BatteryKernel::Run(size_t idx) {
+  auto start = std::chrono::steady_clock::now();
+  auto size = Read(default_regs + 2 * idx + 1);
+  const auto* in = reinterpret_cast<const char*>(ReadAddress(input_values_offset(idx)));
+  auto* offsets = reinterpret_cast<int32_t*>(ReadAddress(output_offsets_offset(idx)));
+  auto* values = reinterpret_cast<uint64_t*>(ReadAddress(output_values_offset(idx)));
+
+  // Like the hardware, stop at the first malformed JSON.
+  cpu::Cursor cursor(in, in + size);
+  uint64_t rows = 0;
+  int32_t num_values = 0;
+  offsets[0] = 0;
+  while (!cursor.AtEnd()) {
+    if (!cursor.Expect('{') || !cursor.ExpectKey("voltage") || !cursor.Expect('[')) {
+      break;
+    }
+    bool valid = true;
+    if (!cursor.Expect(']')) {
+      do {
+        valid = cursor.ParseUInt64(&values[num_values]);
+        num_values++;
+      } while (valid && cursor.Expect(','));
+      valid = valid && cursor.Expect(']');
+    }
+    if (!valid || !cursor.Expect('}')) break;
+    rows++;
+    offsets[rows] = num_values;
+  }
+
+  auto status = custom_regs_offset() + battery_custom_regs_per_inst * idx + 1;
+  Write64(status + 1, rows);
+  AddBusyTime(start);
+  Write(status, stat_done);
+}
+
+// Trip report register map, see bolson::parse::opae::TripParser.
+// Per instance: input range and input values address. Then the output range and the
+// addresses of the 21 output buffers, followed by the custom registers per instance:
+// tag and bytes consumed.
+static const size_t trip_regs_per_inst = 2 + 2;
+static const size_t trip_output_regs = 2 + 42;
+static const size_t trip_custom_regs_per_inst = 2;
+
+/// Fields of the "trip report" schema, in the order the hardware expects them.
+static const std::array<cpu::FieldSpec, 19> trip_fields = {{
+    {"timestamp", cpu::FieldKind::STRING},
+    {"timezone", cpu::FieldKind::UINT64},
+    {"vin", cpu::FieldKind::UINT64},
+    {"odometer", cpu::FieldKind::UINT64},
+    {"hypermiling", cpu::FieldKind::BOOL},
+    {"avgspeed", cpu::FieldKind::UINT64},
+    {"sec_in_band", cpu::FieldKind::UINT64_LIST, 12},
+    {"miles_in_time_range", cpu::FieldKind::UINT64_LIST, 24},
+    {"const_speed_miles_in_band", cpu::FieldKind::UINT64_LIST, 12},
+    {"vary_speed_miles_in_band", cpu::FieldKind::UINT64_LIST, 12},
+    {"sec_decel", cpu::FieldKind::UINT64_LIST, 10},
+    {"sec_accel", cpu::FieldKind::UINT64_LIST, 10},
+    {"braking", cpu::FieldKind::UINT64_LIST, 6},
+    {"accel", cpu::FieldKind::UINT64_LIST, 6},
+    {"orientation", cpu::FieldKind::BOOL},
+    {"small_speed_var", cpu::FieldKind::UINT64_LIST, 13},
+    {"large_speed_var", cpu::FieldKind::UINT64_LIST, 13},
+    {"accel_decel", cpu::FieldKind::UINT64},
+    {"speed_changes", cpu::FieldKind::UINT64},
+}};
+
+/// Output buffers: timestamp offsets and values, tag, and one per other field.
+using TripBuffers = std::array<std::byte*, 2 + trip_fields.size()>;
+
+/// \brief Parse one trip report into a row of the output buffers.
+static auto ParseTripReport(cpu::Cursor* cursor, uint64_t tag, uint64_t row,
+                            const TripBuffers& out) -> bool {
+  if (!cursor->Expect('{')) return false;
+  for (size_t f = 0; f < trip_fields.size(); f++) {
+    const auto& field = trip_fields[f];
+    if ((f > 0) && !cursor->Expect(',')) return false;
+    if (!cursor->ExpectKey(field.name)) return false;
+    // The timestamp is the only string, the other fields follow the tag buffer.
+    auto* buffer = out[f + 2];
+    switch (field.kind) {
+      case cpu::FieldKind::STRING: {
+        std::string_view str;
+        if (!cursor->ParseString(&str)) return false;
+        auto* offsets = reinterpret_cast<int32_t*>(out[0]);
+        std::memcpy(reinterpret_cast<char*>(out[1]) + offsets[row], str.data(),
+                    str.size());
+        offsets[row + 1] = offsets[row] + static_cast<int32_t>(str.size());
+        break;
+      }
+      case cpu::FieldKind::UINT64:
+        if (!cursor->ParseUInt64(&reinterpret_cast<uint64_t*>(buffer)[row])) {
+          return false;
+        }
+        break;
+      case cpu::FieldKind::BOOL: {
+        bool value = false;
+        if (!cursor->ParseBool(&value)) return false;
+        reinterpret_cast<uint8_t*>(buffer)[row] = value ? 1 : 0;
+        break;
+      }
+      case cpu::FieldKind::UINT64_LIST: {
+        auto* items = reinterpret_cast<uint64_t*>(buffer) + row * field.list_size;
+        if (!cursor->Expect('[')) return false;
+        for (int32_t i = 0; i < field.list_size; i++) {
+          if ((i > 0) && !cursor->Expect(',')) return false;
+          if (!cursor->ParseUInt64(&items[i])) return false;
+        }
+        if (!cursor->Expect(']')) return false;
+        break;
+      }
+    }
+  }
+  if (!cursor->Expect('}')) return false;
+  reinterpret_cast<uint64_t*>(out[2])[row] = tag;
+  return true;
+}
+
+TripKernel::TripKernel(Registers* regs, size_t num_parsers)
+    : Kernel(regs), num_parsers_(num_parsers) {}
+
+TripKernel::~TripKernel() { Join(); }
+
+auto TripKernel::custom_regs_offset() const -> size_t {
+  return default_regs + num_parsers_ * trip_regs_per_inst + trip_output_regs;
+}
+
+auto TripKernel::input_values_offset(size_t idx) const -> size_t {
+  return default_regs + 2 * num_parsers_ + 2 + 2 * idx;
+}
+
+auto TripKernel::output_buffer_offset(size_t buffer) const -> size_t {
+  return default_regs + num_parsers_ * trip_regs_per_inst + 2 + 2 * buffer;
+}
+
+void TripKernel::OnWrite(uint64_t offset, uint32_t value) {
+  // Parsers are controlled through the Fletcher control register.
+  if (offset != 0) return;
+  if ((value & ctrl_reset) != 0) {
+    Join();
+    Write(1, stat_idle);
+    Write64(2, 0);
+  }
+  if ((value & ctrl_start) != 0) {
+    Join();
+    Write(1, stat_busy);
+    runs_++;
+    thread_ = std::thread(&TripKernel::Run, this);
+  }
+}
+
+void TripKernel::Join() {
+  if (thread_.joinable()) thread_.join();
+}
+
+void TripKernel::Run() {
+  auto start = std::chrono::steady_clock::now();
+  std::vector<cpu::Cursor> cursors;
+  std::vector<uint64_t> tags;
+  for (size_t i = 0; i < num_parsers_; i++) {
+    auto size = Read(default_regs + 2 * i + 1);
+    const auto* in = reinterpret_cast<const char*>(ReadAddress(input_values_offset(i)));
+    cursors.emplace_back(in, in + size);
+    tags.push_back(Read(custom_regs_offset() + trip_custom_regs_per_inst * i));
+  }
+  TripBuffers out{};
+  for (size_t b = 0; b < out.size(); b++) {
+    out[b] = ReadAddress(output_buffer_offset(b));
+  }
+  reinterpret_cast<int32_t*>(out[0])[0] = 0;
+
+  // Take records from the instances round-robin. An instance stops at the end of its
+  // input, or at the first malformed JSON.
+  uint64_t rows = 0;
+  std::vector<bool> active(num_parsers_, true);
+  size_t num_active = num_parsers_;
+  while (num_active > 0) {
+    for (size_t i = 0; i < num_parsers_; i++) {
+      if (!active[i]) continue;
+      if (cursors[i].AtEnd() || !ParseTripReport(&cursors[i], tags[i], rows, out)) {
+        active[i] = false;
+        num_active--;
+        continue;
+      }
+      rows++;
+    }
+  }
+
+  for (size_t i = 0; i < num_parsers_; i++) {
+    Write(custom_regs_offset() + trip_custom_regs_per_inst * i + 1,
+          static_cast<uint32_t>(cursors[i].offset()));
+  }
+  Write64(2, rows);
+  AddBusyTime(start);
+  Write(1, stat_done);
+}
+
+void MakeKernel(const std::string& afu_id, Registers* regs,
+                std::unique_ptr<Kernel>* out) {
+  out->reset();
+  if (afu_id.size() != battery_afu_id_base.size() + 2) return;
+  auto base = std::string_view(afu_id).substr(0, afu_id.size() - 2);
+  auto digits = afu_id.substr(afu_id.size() - 2);
+  char* end = nullptr;
+  auto num_parsers = std::strtoul(digits.c_str(), &end, 16);
+  if ((*end != '\0') || (num_parsers == 0)) return;
+  if (base == battery_afu_id_base) {
+    *out = std::make_unique<BatteryKernel>(regs, num_parsers);
+  } else if (base == trip_afu_id_base) {
+    *out = std::make_unique<TripKernel>(regs, num_parsers);
+  }
+}
+
+}  // namespace bolson::parse::opae::emu
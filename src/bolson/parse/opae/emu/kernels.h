@@ -0,0 +1,155 @@
+// Copyright 2020 Teratide B.V.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+/// Number of 32-bit MMIO registers of the emulated device.
+#define BOLSON_EMU_NUM_REGS 4096
+
+/// Software emulation of the OPAE parser kernels, to run FPGA parsers without an FPGA.
+namespace bolson::parse::opae::emu {
+
+/// MMIO registers of the emulated device.
+using Registers = std::array<std::atomic<uint32_t>, BOLSON_EMU_NUM_REGS>;
+
+/**
+ * \brief Abstract emulated kernel, reacting to MMIO writes of the host.
+ *
+ * Kernels implement the register map of the hardware design. Buffer addresses written
+ * by the host are host pointers, as the emulated platform maps device addresses 1:1.
+ */
+class Kernel {
+ public:
+  virtual ~Kernel() = default;
+
+  /**
+   * \brief Handle a register write of the host, after the value is stored.
+   *
+   * Writes to the registers of different parser instances may be handled concurrently.
+   * The registers of one instance are written by one host thread at a time.
+   */
+  virtual void OnWrite(uint64_t offset, uint32_t value) = 0;
+
+  /// \brief Wait for all running parser instances to finish.
+  virtual void Join() = 0;
+
+  /// \brief Return the total time parser instances spent parsing.
+  [[nodiscard]] auto busy_time() const -> std::chrono::nanoseconds {
+    return std::chrono::nanoseconds(busy_ns_.load());
+  }
+
+  /// \brief Return the number of times parser instances were started.
+  [[nodiscard]] auto runs() const -> uint64_t { return runs_.load(); }
+
+ protected:
+  explicit Kernel(Registers* regs) : regs_(regs) {}
+
+  [[nodiscard]] auto Read(size_t offset) const -> uint32_t;
+  void Write(size_t offset, uint32_t value);
+  /// \brief Return the address in the register pair at offset (lo) and offset + 1 (hi).
+  [[nodiscard]] auto ReadAddress(size_t offset) const -> std::byte*;
+  /// \brief Write a 64-bit value to the register pair at offset (lo) and offset + 1 (hi).
+  void Write64(size_t offset, uint64_t value);
+  /// \brief Account for the time a parser instance spent parsing.
+  void AddBusyTime(std::chrono::steady_clock::time_point start);
+
+  static const uint32_t stat_idle = (1u << 0u);
+  static const uint32_t stat_busy = (1u << 1u);
+  static const uint32_t stat_done = (1u << 2u);
+  static const uint32_t ctrl_start = (1u << 0u);
+  static const uint32_t ctrl_reset = (1u << 2u);
+
+  Registers* regs_;
+  std::atomic<uint64_t> busy_ns_ = 0;
+  std::atomic<uint64_t> runs_ = 0;
+};
+
+/**
+ * \brief Emulated "battery status" kernel.
+ *
+ * Every parser instance has its own control and status registers, and is started
+ * independently. Started instances parse on their own thread.
+ */
+class BatteryKernel : public Kernel {
+ public:
+  BatteryKernel(Registers* regs, size_t num_parsers);
+  ~BatteryKernel() override;
+
+  void OnWrite(uint64_t offset, uint32_t value) override;
+  void Join() override;
+
+ private:
+  /// \brief Parse the input buffer of a parser instance.
+  void Run(size_t idx);
+
+  [[nodiscard]] auto custom_regs_offset() const -> size_t;
+  [[nodiscard]] auto input_values_offset(size_t idx) const -> size_t;
+  [[nodiscard]] auto output_offsets_offset(size_t idx) const -> size_t;
+  [[nodiscard]] auto output_values_offset(size_t idx) const -> size_t;
+
+  size_t num_parsers_;
+  std::vector<std::thread> threads_;
+};
+
+/**
+ * \brief Emulated "trip report" kernel.
+ *
+ * All parser instances are started at once through the Fletcher control register, and
+ * write to a single output batch. Like the hardware, records of different instances are
+ * interleaved, and tagged with the tag register of their instance.
+ */
+class TripKernel : public Kernel {
+ public:
+  TripKernel(Registers* regs, size_t num_parsers);
+  ~TripKernel() override;
+
+  void OnWrite(uint64_t offset, uint32_t value) override;
+  void Join() override;
+
+ private:
+  /// \brief Parse the input buffers of all parser instances.
+  void Run();
+
+  [[nodiscard]] auto custom_regs_offset() const -> size_t;
+  [[nodiscard]] auto input_values_offset(size_t idx) const -> size_t;
+  [[nodiscard]] auto output_buffer_offset(size_t buffer) const -> size_t;
+
+  size_t num_parsers_;
+  std::thread thread_;
+};
+
+/**
+ * \brief Make the kernel of a hardware design.
+ *
+ * The AFU ID selects the design, and its last two hex digits the number of parser
+ * instances, as derived by the OPAE parser contexts.
+ *
+ * \param afu_id The AFU ID of the design.
+ * \param regs   The registers of the emulated device.
+ * \param out    The kernel, or nullptr if the AFU ID is of no known design.
+ */
+void MakeKernel(const std::string& afu_id, Registers* regs,
+                std::unique_ptr<Kernel>* out);
+
+}  // namespace bolson::parse::opae::emu
@@ -0,0 +1,144 @@
+// Copyright 2020 Teratide B.V.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Fletcher platform library of the emulated device, loaded by Fletcher as
+// libfletcher_emu.so when creating the "emu" platform.
+
+#include <fletcher/fletcher.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+
+#include "bolson/parse/opae/emu/kernels.h"
+
+using bolson::parse::opae::emu::Kernel;
+using bolson::parse::opae::emu::MakeKernel;
+using bolson::parse::opae::emu::Registers;
+
+/// The emulated device.
+struct Device {
+  /// The MMIO registers.
+  Registers regs{};
+  /// The kernel of the hardware design selected by the AFU ID.
+  std::unique_ptr<Kernel> kernel;
+};
+
+static std::unique_ptr<Device> device;
+
+extern "C" {
+
+fstatus_t platformGetName(char* name, size_t size) {
+  std::strncpy(name, "emu", size);
+  return FLETCHER_STATUS_OK;
+}
+
+fstatus_t platformInit(void* arg) {
+  // Like the OPAE platform, the init data is a pointer to the AFU ID string.
+  std::string afu_id;
+  if (arg != nullptr) {
+    afu_id = *static_cast<char**>(arg);
+  }
+  device = std::make_unique<Device>();
+  for (auto& reg : device->regs) {
+    reg.store(0);
+  }
+  MakeKernel(afu_id, &device->regs, &device->kernel);
+  if (device->kernel == nullptr) {
+    std::fprintf(stderr, "[EMU] No emulated kernel for AFU ID \"%s\".\n", afu_id.c_str());
+    device.reset();
+    return FLETCHER_STATUS_ERROR;
+  }
+  return FLETCHER_STATUS_OK;
+}
+
+fstatus_t platformWriteMMIO(uint64_t offset, uint32_t value) {
+  if ((device == nullptr) || (offset >= device->regs.size())) {
+    return FLETCHER_STATUS_ERROR;
+  }
+  // Like OPAE MMIO, writes are not serialized, so host threads driving different parser
+  // instances don't contend.
+  device->regs[offset].store(value);
+  device->kernel->OnWrite(offset, value);
+  return FLETCHER_STATUS_OK;
+}
+
+fstatus_t platformReadMMIO(uint64_t offset, uint32_t* value) {
+  if ((device == nullptr) || (offset >= device->regs.size())) {
+    return FLETCHER_STATUS_ERROR;
+  }
+  *value = device->regs[offset].load();
+  return FLETCHER_STATUS_OK;
+}
+
+// Device memory is host memory, and device addresses are host addresses.
+
+fstatus_t platformDeviceMalloc(da_t* device_address, int64_t size) {
+  void* buffer = std::malloc(size);
+  if (buffer == nullptr) {
+    return FLETCHER_STATUS_ERROR;
+  }
+  *device_address = reinterpret_cast<da_t>(buffer);
+  return FLETCHER_STATUS_OK;
+}
+
+fstatus_t platformDeviceFree(da_t device_address) {
+  std::free(reinterpret_cast<void*>(device_address));
+  return FLETCHER_STATUS_OK;
+}
+
+fstatus_t platformCopyHostToDevice(const uint8_t* host_source, da_t device_destination,
+                                   int64_t size) {
+  std::memcpy(reinterpret_cast<void*>(device_destination), host_source, size);
+  return FLETCHER_STATUS_OK;
+}
+
+fstatus_t platformCopyDeviceToHost(da_t device_source, uint8_t* host_destination,
+                                   int64_t size) {
+  std::memcpy(host_destination, reinterpret_cast<const void*>(device_source), size);
+  return FLETCHER_STATUS_OK;
+}
+
+fstatus_t platformPrepareHostBuffer(const uint8_t* host_source, da_t* device_destination,
+                                    int64_t size, int* alloced) {
+  // Like OPAE shared memory, the device accesses the host buffer directly.
+  *device_destination = reinterpret_cast<da_t>(host_source);
+  *alloced = 0;
+  return FLETCHER_STATUS_OK;
+}
+
+fstatus_t platformCacheHostBuffer(const uint8_t* host_source, da_t* device_destination,
+                                  int64_t size) {
+  if (platformDeviceMalloc(device_destination, size) != FLETCHER_STATUS_OK) {
+    return FLETCHER_STATUS_ERROR;
+  }
+  return platformCopyHostToDevice(host_source, *device_destination, size);
+}
+
+fstatus_t platformTerminate(void* arg) {
+  if (device != nullptr) {
+    device->kernel->Join();
+    // Report the time spent in the emulated kernel, to separate it from host overhead.
+    auto busy = std::chrono::duration<double>(device->kernel->busy_time()).count();
+    std::fprintf(stderr, "[EMU] Kernel parsed for %.6f s in %lu runs.\n", busy,
+                 static_cast<unsigned long>(device->kernel->runs()));
+    device.reset();
+  }
+  return FLETCHER_STATUS_OK;
+}
+
+}  // extern "C"
@@ -15,13 +15,74 @@
 #include "bolson/parse/opae/opae.h"
 
 #include <arrow/api.h>
+#include <dlfcn.h>
 #include <fletcher/common.h>
 #include <fletcher/context.h>
+#include <unistd.h>
 
+#include <array>
+#include <climits>
 #include <memory>
 
+/// The Fletcher platform library of the emulated platform.
+#define BOLSON_EMU_PLATFORM_LIB "libfletcher_emu.so"
+
 namespace bolson::parse::opae {
 
+auto ToString(Platform platform) -> std::string {
+  switch (platform) {
+    case Platform::OPAE:
+      return "OPAE";
+    case Platform::EMU:
+      return "Emulated";
+  }
+  return "Corrupt bolson::parse::opae::Platform enum value.";
+}
+
+void AddPlatformOptionToCLI(CLI::App* sub, Platform* platform,
+                            Platform default_platform) {
+  sub->add_option("--opae-platform", *platform,
+                  "Fletcher platform of the OPAE parsers. \"emu\" emulates the parser "
+                  "kernels in software, to run without an FPGA.")
+      ->transform(CLI::CheckedTransformer(
+          std::map<std::string, Platform>{{"opae", Platform::OPAE},
+                                          {"emu", Platform::EMU}},
+          CLI::ignore_case))
+      ->default_val(default_platform);
+}
+
+/// \brief Load the emulated platform library, so Fletcher finds it by name.
+static auto LoadEmulator() -> Status {
+  if (dlopen(BOLSON_EMU_PLATFORM_LIB, RTLD_NOW | RTLD_GLOBAL) != nullptr) {
+    return Status::OK();
+  }
+  // The library is built next to the executables, which may not be on the library path.
+  std::string error = dlerror();
+  std::array<char, PATH_MAX> exe{};
+  auto len = readlink("/proc/self/exe", exe.data(), exe.size() - 1);
+  if (len > 0) {
+    std::string path(exe.data(), len);
+    path = path.substr(0, path.rfind('/') + 1) + BOLSON_EMU_PLATFORM_LIB;
+    if (dlopen(path.c_str(), RTLD_NOW | RTLD_GLOBAL) != nullptr) {
+      return Status::OK();
+    }
+  }
+  return Status(Error::OpaeError, "Unable to load emulated platform: " + error);
+}
+
+auto MakePlatform(Platform platform, std::string* afu_id,
+                  std::shared_ptr<fletcher::Platform>* out) -> Status {
+  if (platform == Platform::EMU) {
+    BOLSON_ROE(LoadEmulator());
+  }
+  FLETCHER_ROE(
+      fletcher::Platform::Make(platform == Platform::EMU ? "emu" : "opae", out, false));
+  char* afu_id_ptr = afu_id->data();
+  (*out)->init_data = &afu_id_ptr;
+  FLETCHER_ROE((*out)->Init());
+  return Status::OK();
+}
+
 auto input_schema() -> std::shared_ptr<arrow::Schema> {
   static auto result = fletcher::WithMetaRequired(
       *arrow::schema({arrow::field("input", arrow::uint8(), false)}), "input",
@@ -19,7 +19,9 @@
 #include <fletcher/fletcher.h>
 #include <fletcher/platform.h>
 
+#include <CLI/CLI.hpp>
 #include <memory>
+#include <string>
 
 #include "bolson/log.h"
 #include "bolson/status.h"
@@ -36,6 +38,33 @@
 /// Fletcher OPAE FPGA implementations of specific schema parsers
 namespace bolson::parse::opae {
 
+/// Fletcher platforms to run the FPGA parsers on.
+enum class Platform {
+  OPAE,  ///< Intel OPAE FPGA platform.
+  EMU    ///< Software emulation of the parser kernels, requiring no FPGA.
+};
+
+/// \brief Return human-readable Platform enum.
+auto ToString(Platform platform) -> std::string;
+
+/// \brief Add the option to select the Fletcher platform to a CLI subcommand.
+void AddPlatformOptionToCLI(CLI::App* sub, Platform* platform,
+                            Platform default_platform = Platform::OPAE);
+
+/**
+ * \brief Create and initialize a Fletcher platform.
+ *
+ * The emulated platform is loaded from libfletcher_emu.so, searched for on the library
+ * path and next to the executable.
+ *
+ * \param platform The platform to create.
+ * \param afu_id   The AFU ID of the hardware design to initialize the platform with.
+ * \param out      The initialized platform.
+ * \return Status::OK() if successful, some error otherwise.
+ */
+auto MakePlatform(Platform platform, std::string* afu_id,
+                  std::shared_ptr<fletcher::Platform>* out) -> Status;
+
 /// \brief Return the Arrow schema "input: uint8" used as input batch.
 auto input_schema() -> std::shared_ptr<arrow::Schema>;
 
@@ -22,8 +22,13 @@
 #include <fletcher/platform.h>
 #include <putong/timer.h>
 
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
 #include <CLI/CLI.hpp>
 #include <chrono>
+#include <cstring>
 #include <memory>
 #include <thread>
 #include <utility>
@@ -33,6 +38,7 @@
 #include "bolson/log.h"
 #include "bolson/parse/opae/opae.h"
 #include "bolson/parse/parser.h"
+#include "bolson/parse/timestamp.h"
 
 /// Return Bolson error status when Fletcher error status is supplied.
 #define FLETCHER_ROE(s)                                                 \
@@ -291,6 +297,14 @@ auto TripParser::input_values_hi_offset(size_t idx) const -> size_t {
   return input_values_lo_offset(idx) + 1;
 }
 
+auto TripParser::output_firstidx_offset() const -> size_t {
+  return default_regs + input_range_regs_per_inst * num_hardware_parsers_;
+}
+
+auto TripParser::output_addr_lo_offset(size_t buffer) const -> size_t {
+  return input_values_lo_offset(num_hardware_parsers_) + 2 * buffer;
+}
+
 auto TripParser::tag_offset(size_t idx) const -> size_t {
   return custom_regs_offset() + custom_regs_per_inst * idx;
 }
@@ -413,68 +427,127 @@ static auto WrapTripReport(int32_t num_rows,
   return Status::OK();
 }
 
-auto TripParserContext::PrepareOutputBatch() -> Status {
-  for (const auto& f : output_schema_sw()->fields()) {
-    if (f->type()->Equals(arrow::uint64())) {
-      std::shared_ptr<arrow::PrimitiveArray> array;
-      BOLSON_ROE(AllocatePrimitiveArray(&allocator, arrow::uint64(),
-                                        allocator.fixed_capacity(), &array));
-      output_arrays_sw.push_back(array);
-      output_arrays_hw.push_back(array);
-    } else if (f->type()->Equals(arrow::uint8())) {
-      std::shared_ptr<arrow::PrimitiveArray> array;
-      BOLSON_ROE(AllocatePrimitiveArray(&allocator, arrow::uint8(),
-                                        allocator.fixed_capacity(), &array));
-      output_arrays_sw.push_back(array);
-      output_arrays_hw.push_back(array);
-    } else if (f->type()->Equals(arrow::utf8())) {
-      std::shared_ptr<arrow::StringArray> array;
-      BOLSON_ROE(AllocateStringArray(&allocator, allocator.fixed_capacity(),
-                                     allocator.fixed_capacity(), &array));
-      output_arrays_sw.push_back(array);
-      output_arrays_hw.push_back(array);
-    } else if (f->type()->id() == arrow::Type::FIXED_SIZE_LIST) {
-      std::shared_ptr<arrow::PrimitiveArray> values_array;
-      std::shared_ptr<arrow::FixedSizeListArray> fixed_size_list_array;
-      auto field = std::static_pointer_cast<arrow::FixedSizeListType>(f->type());
-      BOLSON_ROE(AllocatePrimitiveArray(&allocator, arrow::uint64(),
-                                        allocator.fixed_capacity(), &values_array));
-      BOLSON_ROE(AllocateFixedSizeListArray(field->value_type(), values_array,
-                                            field->list_size(), &fixed_size_list_array));
-      output_arrays_sw.push_back(fixed_size_list_array);
-      output_arrays_hw.push_back(values_array);
+auto TripParserContext::PrepareOutputSets() -> Status {
+  for (size_t i = 0; i < num_sets_; i++) {
+    TripOutputSet set;
+    for (const auto& f : output_schema_sw()->fields()) {
+      if (f->type()->Equals(arrow::uint64())) {
+        std::shared_ptr<arrow::PrimitiveArray> array;
+        BOLSON_ROE(AllocatePrimitiveArray(&allocator, arrow::uint64(),
+                                          allocator.fixed_capacity(), &array));
+        set.arrays_sw.push_back(array);
+        set.arrays_hw.push_back(array);
+      } else if (f->type()->Equals(arrow::uint8())) {
+        std::shared_ptr<arrow::PrimitiveArray> array;
+        BOLSON_ROE(AllocatePrimitiveArray(&allocator, arrow::uint8(),
+                                          allocator.fixed_capacity(), &array));
+        set.arrays_sw.push_back(array);
+        set.arrays_hw.push_back(array);
+      } else if (f->type()->Equals(arrow::utf8())) {
+        std::shared_ptr<arrow::StringArray> array;
+        BOLSON_ROE(AllocateStringArray(&allocator, allocator.fixed_capacity(),
+                                       allocator.fixed_capacity(), &array));
+        set.arrays_sw.push_back(array);
+        set.arrays_hw.push_back(array);
+      } else if (f->type()->id() == arrow::Type::FIXED_SIZE_LIST) {
+        std::shared_ptr<arrow::PrimitiveArray> values_array;
+        std::shared_ptr<arrow::FixedSizeListArray> fixed_size_list_array;
+        auto field = std::static_pointer_cast<arrow::FixedSizeListType>(f->type());
+        BOLSON_ROE(AllocatePrimitiveArray(&allocator, arrow::uint64(),
+                                          allocator.fixed_capacity(), &values_array));
+        BOLSON_ROE(AllocateFixedSizeListArray(field->value_type(), values_array,
+                                              field->list_size(),
+                                              &fixed_size_list_array));
+        set.arrays_sw.push_back(fixed_size_list_array);
+        set.arrays_hw.push_back(values_array);
+      }
     }
+    batches_out_hw.push_back(
+        arrow::RecordBatch::Make(output_schema_hw(), 0, set.arrays_hw));
+    output_sets.push_back(std::move(set));
   }
 
-  batch_out_sw = arrow::RecordBatch::Make(output_schema_sw(), 0, output_arrays_sw);
-  batch_out_hw = arrow::RecordBatch::Make(output_schema_hw(), 0, output_arrays_hw);
-
   return Status::OK();
 }
 
-static auto ConvertTagsToSeq(const std::shared_ptr<arrow::UInt64Array>& tags,
-                             std::vector<uint64_t> seq_nos,
-                             std::shared_ptr<arrow::UInt64Array>* out) -> Status {
-  arrow::UInt64Builder bld;
-  ARROW_ROE(bld.Reserve(tags->length()));
+/// \brief Return array data sharing the buffers of data, with their ownership tied to a
+/// lease.
+static auto LeaseData(const std::shared_ptr<arrow::ArrayData>& data,
+                      const std::shared_ptr<void>& lease)
+    -> std::shared_ptr<arrow::ArrayData> {
+  auto result = data->Copy();
+  for (auto& buffer : result->buffers) {
+    if (buffer != nullptr) {
+      // The buffers themselves are owned by the output set.
+      buffer = std::shared_ptr<arrow::Buffer>(lease, buffer.get());
+    }
+  }
+  for (auto& child : result->child_data) {
+    child = LeaseData(child, lease);
+  }
+  return result;
+}
 
-  for (size_t i = 0; i < tags->length(); i++) {
-    assert(tags->Value(i) < seq_nos.size());
-    bld.UnsafeAppend(seq_nos[tags->Value(i)]++);
+/// \brief Return arrays sharing the buffers of arrays, with their ownership tied to a
+/// lease.
+static auto LeaseArrays(const std::vector<std::shared_ptr<arrow::Array>>& arrays,
+                        const std::shared_ptr<void>& lease)
+    -> std::vector<std::shared_ptr<arrow::Array>> {
+  std::vector<std::shared_ptr<arrow::Array>> result;
+  for (const auto& array : arrays) {
+    result.push_back(arrow::MakeArray(LeaseData(array->data(), lease)));
+  }
+  return result;
+}
+
+void ConvertTagsToSeq(const arrow::UInt64Array& tags, std::vector<uint64_t>* seq_nos) {
+  auto* values = const_cast<uint64_t*>(tags.raw_values());
+  auto* next = seq_nos->data();
+  for (int64_t i = 0; i < tags.length(); i++) {
+    assert(values[i] < seq_nos->size());
+    values[i] = next[values[i]]++;
   }
-  ARROW_ROE(bld.Finish(out));
-  return Status::OK();
 }
 
-static auto ConvertUInt8ToBool(const std::shared_ptr<arrow::UInt8Array>& col,
+void PackBytes(const uint8_t* bytes, int64_t length, uint8_t* bits) {
+  int64_t i = 0;
+#if defined(__AVX2__)
+  const __m256i zero_256 = _mm256_setzero_si256();
+  for (; i + 32 <= length; i += 32) {
+    auto v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(bytes + i));
+    auto zeros = _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, zero_256));
+    auto mask = ~static_cast<uint32_t>(zeros);
+    std::memcpy(bits + i / 8, &mask, sizeof(mask));
+  }
+#endif
+#if defined(__SSE2__)
+  const __m128i zero_128 = _mm_setzero_si128();
+  for (; i + 16 <= length; i += 16) {
+    auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes + i));
+    auto zeros = static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, zero_128)));
+    uint16_t mask = ~zeros;
+    std::memcpy(bits + i / 8, &mask, sizeof(mask));
+  }
+#endif
+  // Remaining bytes, eight at a time.
+  for (; i < length; i += 8) {
+    uint8_t byte = 0;
+    for (int64_t b = 0; (b < 8) && (i + b < length); b++) {
+      byte |= static_cast<uint8_t>(bytes[i + b] != 0) << b;
+    }
+    bits[i / 8] = byte;
+  }
+}
+
+static auto ConvertUInt8ToBool(const arrow::UInt8Array& col, arrow::MemoryPool* pool,
                                std::shared_ptr<arrow::BooleanArray>* out) -> Status {
-  arrow::BooleanBuilder bld;
-  ARROW_ROE(bld.Reserve(col->length()));
-  const uint8_t* values = col->raw_values();
-  for (size_t i = 0; i < col->length(); i++) {
-    bld.UnsafeAppend(static_cast<bool>(values[i]));
+  auto alloc = arrow::AllocateBuffer(arrow::BitUtil::BytesForBits(col.length()), pool);
+  if (!alloc.ok()) {
+    return Status(Error::ArrowError, alloc.status().message());
   }
-  ARROW_ROE(bld.Finish(out));
+  std::shared_ptr<arrow::Buffer> bits = std::move(alloc).ValueOrDie();
+  PackBytes(col.raw_values(), col.length(), bits->mutable_data());
+  *out = std::make_shared<arrow::BooleanArray>(col.length(), std::move(bits));
   return Status::OK();
 }
 
@@ -490,23 +563,22 @@ static auto ConvertUInt8ToBool(const std::shared_ptr<arrow::UInt8Array>& col,
  *    into sequence numbers to comply to the other out of order parser implementations
  */
 static auto FixResult(const std::shared_ptr<arrow::RecordBatch>& batch,
-                      std::vector<uint64_t> seq_nos)
-    -> std::shared_ptr<arrow::RecordBatch> {
+                      std::vector<uint64_t>* seq_nos, arrow::MemoryPool* pool,
+                      std::shared_ptr<arrow::RecordBatch>* out) -> Status {
   // Work-around to turn tag into sequence numbers (overwrites existing buffer)
   assert(batch->column_name(1) == "tag");  // sanity check
   assert(batch->column(1)->type_id() == arrow::Type::UINT64);
-  std::shared_ptr<arrow::UInt64Array> seq;
-  ConvertTagsToSeq(std::static_pointer_cast<arrow::UInt64Array>(batch->column(1)),
-                   std::move(seq_nos), &seq);
+  const auto& seq = batch->column(1);
+  ConvertTagsToSeq(static_cast<const arrow::UInt64Array&>(*seq), seq_nos);
 
   // Work-around to turn uint8 fields back into boolean again.
   std::shared_ptr<arrow::BooleanArray> hypermiling, orientation;
-  ConvertUInt8ToBool(
-      std::static_pointer_cast<arrow::UInt8Array>(batch->GetColumnByName("hypermiling")),
-      &hypermiling);
-  ConvertUInt8ToBool(
-      std::static_pointer_cast<arrow::UInt8Array>(batch->GetColumnByName("orientation")),
-      &orientation);
+  BOLSON_ROE(ConvertUInt8ToBool(
+      static_cast<const arrow::UInt8Array&>(*batch->GetColumnByName("hypermiling")),
+      pool, &hypermiling));
+  BOLSON_ROE(ConvertUInt8ToBool(
+      static_cast<const arrow::UInt8Array&>(*batch->GetColumnByName("orientation")),
+      pool, &orientation));
 
   std::vector<std::shared_ptr<arrow::Array>> columns = {
       seq,
@@ -536,82 +608,148 @@ static auto FixResult(const std::shared_ptr<arrow::RecordBatch>& batch,
   }
 
   // Work-around to fix schema field order (should be zero-copy)
-  auto result =
+  *out =
       arrow::RecordBatch::Make(TripParser::output_schema(), batch->num_rows(), columns);
 
-  return result;
+  return Status::OK();
 }
 
-[[nodiscard]] auto TripParser::Parse(const std::vector<illex::JSONBuffer*>& in,
-                                     std::vector<ParsedBatch>* out) -> Status {
-  std::vector<uint64_t> seq_nos;
+auto TripParser::Submit(const std::vector<illex::JSONBuffer*>& in) -> Status {
+  if (in_flight_) {
+    return Status(Error::OpaeError, "TripParser cannot submit while a run is in flight.");
+  }
+  if (in.size() > num_hardware_parsers_) {
+    return Status(Error::OpaeError, "TripParser cannot submit " +
+                                        std::to_string(in.size()) + " buffers to " +
+                                        std::to_string(num_hardware_parsers_) +
+                                        " hardware parsers.");
+  }
+  // The kernel overwrites the output set, so no batch of an earlier run may still
+  // reference it.
+  const auto& set = output_sets_->at(next_output_set_);
+  if ((finished_ && (finished_->output_set == next_output_set_)) ||
+      !set.lease.expired()) {
+    return Status(Error::OpaeError, "TripParser output set " +
+                                        std::to_string(next_output_set_) +
+                                        " is still in use.");
+  }
 
-  size_t bytes_total = 0;
-  size_t expected_rows = 0;
+  Run run;
+  run.output_set = next_output_set_;
   for (size_t i = 0; i < in.size(); i++) {
-    SPDLOG_DEBUG("TripParser | Parsing buffer {:2}:\n{}", i, ToString(*in[i], false));
+    SPDLOG_DEBUG("TripParser | Parsing buffer {:2}:\n{}", i,
+                 parse::ToString(*in[i], false));
     BOLSON_ROE(WriteInputMetaData(platform_, in[i], i));
-    seq_nos.push_back(in[i]->range().first);
-    bytes_total += in[i]->size();
-    expected_rows += in[i]->num_jsons();
+    run.seq_nos.push_back(in[i]->range().first);
+    run.expected_rows += in[i]->num_jsons();
+    run.bytes += in[i]->size();
+  }
+  // Hardware parsers without a buffer get an empty one.
+  for (size_t i = in.size(); i < num_hardware_parsers_; i++) {
+    BOLSON_ROE(WriteMMIO(platform_, input_lastidx_offset(i), 0, i, "input last idx"));
   }
+  BOLSON_ROE(WriteOutputMetaData(set));
 
   // Reset kernel.
   kernel_->Reset();
   // Start kernel.
   kernel_->Start();
-  // Wait for finish.
-  // kernel_->PollUntilDone();
 
-  // Grab the return value (number of parsed JSON objects) and wrap the output Batch.
-  dau_t ret_val;
-  ret_val.full = 0;
-  uint64_t num_rows = 0;
-  uint32_t status = 0;
+  in_flight_ = std::move(run);
+  next_output_set_ = (next_output_set_ + 1) % output_sets_->size();
+  return Status::OK();
+}
 
-  do {
+auto TripParser::Wait() -> Status {
+  if (!in_flight_) {
+    return Status::OK();
+  }
+  auto run = std::move(*in_flight_);
+  in_flight_.reset();
+
+  auto poll = [this](bool* done) -> Status {
+    uint32_t status = 0;
     // status reg @ offset 1
-    ReadMMIO(platform_, 1, &status, 0, "Status");
+    BOLSON_ROE(ReadMMIO(platform_, 1, &status, 0, "Status"));
 #ifndef NDEBUG
     uint64_t bytes_consumed = 0;
     for (int i = 0; i < num_hardware_parsers_; i++) {
       uint32_t bc = 0;
       BOLSON_ROE(ReadMMIO(platform_, bytes_consumed_offset(i), &bc, 0,
                           "Bytes consumed " + std::to_string(i)));
-      SPDLOG_DEBUG("TripParser | Parser {:2} bytes consumed: {}/{}", i, bc,
-                   in[i]->size());
+      SPDLOG_DEBUG("TripParser | Parser {:2} bytes consumed: {}", i, bc);
       bytes_consumed += bc;
     }
-    SPDLOG_DEBUG("TripParser | Total bytes consumed: {}/{}", bytes_consumed, bytes_total);
-    std::this_thread::sleep_for(std::chrono::milliseconds(500));
-#else
-    std::this_thread::sleep_for(std::chrono::microseconds(BOLSON_QUEUE_WAIT_US));
+    SPDLOG_DEBUG("TripParser | Total bytes consumed: {}", bytes_consumed);
 #endif
-  } while ((status & stat_done) != stat_done);
+    *done = (status & stat_done) == stat_done;
+    return Status::OK();
+  };
+  BOLSON_ROE(waiter_.Wait(poll, run.bytes));
 
   // Grab the return value (number of parsed JSON objects) and wrap the output Batch.
+  dau_t ret_val;
+  ret_val.full = 0;
   FLETCHER_ROE(kernel_->GetReturn(&ret_val.lo, &ret_val.hi));
-  num_rows = static_cast<uint64_t>(ret_val.full);
+  run.num_rows = static_cast<uint64_t>(ret_val.full);
 
-  if (num_rows != expected_rows) {
+  if (run.num_rows != run.expected_rows) {
     return Status(Error::OpaeError,
-                  "Expected " + std::to_string(expected_rows) +
+                  "Expected " + std::to_string(run.expected_rows) +
                       " rows, but OPAE TripParser returned batch with " +
-                      std::to_string(num_rows) + " rows.");
+                      std::to_string(run.num_rows) + " rows.");
   }
 
+  finished_ = std::move(run);
+  return Status::OK();
+}
+
+auto TripParser::Collect(std::vector<ParsedBatch>* out) -> Status {
+  if (!finished_) {
+    return Status::OK();
+  }
+  auto run = std::move(*finished_);
+  finished_.reset();
+
+  // The batch shares ownership of a lease, which expires when all its zero-copy
+  // descendants are released. Only then may the kernel write to the output set again.
+  auto& set = output_sets_->at(run.output_set);
+  std::shared_ptr<void> lease = std::make_shared<size_t>(run.output_set);
+  set.lease = lease;
+
   std::shared_ptr<arrow::RecordBatch> unfixed_result;
-  BOLSON_ROE(
-      WrapTripReport(num_rows, *output_arrays_sw_, output_schema_sw(), &unfixed_result));
-  auto result = FixResult(unfixed_result, seq_nos);
+  BOLSON_ROE(WrapTripReport(run.num_rows, LeaseArrays(set.arrays_sw, lease),
+                            output_schema_sw(), &unfixed_result));
+  std::shared_ptr<arrow::RecordBatch> result;
+  BOLSON_ROE(FixResult(unfixed_result, &run.seq_nos, memory_pool_, &result));
+  BOLSON_ROE(ConvertTimestamps(&result));
 
   out->push_back(ParsedBatch(result, {0, static_cast<uint64_t>(result->num_rows() - 1)}));
 
   return Status::OK();
 }
 
+auto TripParser::num_output_sets() const -> size_t { return output_sets_->size(); }
+
+auto TripParser::wait_metrics() const -> WaitMetrics { return waiter_.metrics(); }
+
+auto TripParser::WriteOutputMetaData(const TripOutputSet& set) -> Status {
+  BOLSON_ROE(WriteMMIO(platform_, output_firstidx_offset(), 0, 0, "output first idx"));
+  BOLSON_ROE(WriteMMIO(platform_, output_firstidx_offset() + 1, 0, 0, "output last idx"));
+  for (size_t b = 0; b < set.addresses.size(); b++) {
+    dau_t addr;
+    addr.full = set.addresses[b];
+    BOLSON_ROE(WriteMMIO(platform_, output_addr_lo_offset(b), addr.lo, 0,
+                         "output addr lo " + std::to_string(b)));
+    BOLSON_ROE(WriteMMIO(platform_, output_addr_lo_offset(b) + 1, addr.hi, 0,
+                         "output addr hi " + std::to_string(b)));
+  }
+  return Status::OK();
+}
+
 auto TripParser::WriteInputMetaData(fletcher::Platform* platform, illex::JSONBuffer* in,
                                     size_t idx) -> Status {
+  BOLSON_ROE(WriteMMIO(platform, input_firstidx_offset(idx), 0, idx, "input first idx"));
   // rewrite the input last index because of opae limitations.
   BOLSON_ROE(WriteMMIO(platform, input_lastidx_offset(idx),
                        static_cast<uint32_t>(in->size()), idx, "input last idx"));
@@ -631,14 +769,15 @@ auto TripParser::WriteInputMetaData(fletcher::Platform* platform, illex::JSONBuf
 
 TripParser::TripParser(fletcher::Platform* platform, fletcher::Context* context,
                        fletcher::Kernel* kernel, AddrMap* addr_map,
-                       std::vector<std::shared_ptr<arrow::Array>>* output_arrays,
-                       size_t num_parsers)
+                       std::vector<TripOutputSet>* output_sets, size_t num_parsers,
+                       const WaitOptions& wait)
     : platform_(platform),
       context_(context),
       kernel_(kernel),
       h2d_addr_map(addr_map),
-      output_arrays_sw_(output_arrays),
-      num_hardware_parsers_(num_parsers) {}
+      output_sets_(output_sets),
+      num_hardware_parsers_(num_parsers),
+      waiter_(wait) {}
 
 auto ToString(const illex::JSONBuffer& buffer, bool show_contents) -> std::string {
   std::stringstream ss;
@@ -660,6 +799,14 @@ void AddTripOptionsToCLI(CLI::App* sub, TripOptions* out) {
   sub->add_option("--trip-num-parsers", out->num_parsers,
                   "OPAE \"trip report\" number of parser instances.")
       ->default_val(BOLSON_DEFAULT_OPAE_TRIP_PARSERS);
+  sub->add_flag("--trip-timestamp", out->timestamp,
+                "OPAE \"trip report\", convert the ISO-8601 timestamp field to an Arrow "
+                "timestamp in nanoseconds since the epoch, UTC.")
+      ->default_val(false);
+  sub->add_flag("--trip-double-buffer", out->double_buffer,
+                "OPAE \"trip report\", allocate a second set of input and output buffers "
+                "to parse the next input while the previous batch is processed.")
+      ->default_val(false);
 }
 
 auto TripReportBatchToString(const arrow::RecordBatch& batch) -> std::string {
@@ -693,6 +840,10 @@ auto TripReportBatchToString(const arrow::RecordBatch& batch) -> std::string {
           ss << std::static_pointer_cast<arrow::StringArray>(batch.column(c))
                     ->GetString(r);
           break;
+        case arrow::Type::TIMESTAMP:
+          ss << std::static_pointer_cast<arrow::TimestampArray>(batch.column(c))
+                    ->Value(r);
+          break;
         default:
           ss << "INVALID TYPE!";
       }
@@ -708,56 +859,54 @@ auto TripParserContext::input_schema() const -> std::shared_ptr<arrow::Schema> {
 }
 
 auto TripParserContext::output_schema() const -> std::shared_ptr<arrow::Schema> {
-  return TripParser::output_schema();
+  return output_schema_;
 }
 
 auto TripParserContext::CheckThreadCount(size_t num_threads) const -> size_t { return 1; }
 
 auto TripParserContext::CheckBufferCount(size_t num_buffers) const -> size_t {
-  return num_parsers_;
+  return num_parsers_ * num_sets_;
 }
 
-auto TripParserContext::Make(const TripOptions& opts, std::shared_ptr<ParserContext>* out)
+auto TripParserContext::Make(const TripOptions& opts, Platform platform,
+                             const WaitOptions& wait, std::shared_ptr<ParserContext>* out)
     -> Status {
   std::string afu_id;
   DeriveAFUID(opts.afu_id, BOLSON_DEFAULT_OPAE_TRIP_AFUID, opts.num_parsers, &afu_id);
   SPDLOG_DEBUG("TripParserContext | Using AFU ID: {}", afu_id);
 
   // Create and set up result.
-  auto result = std::shared_ptr<TripParserContext>(new TripParserContext(opts));
+  auto result =
+      std::shared_ptr<TripParserContext>(new TripParserContext(opts, platform, wait));
   SPDLOG_DEBUG("TripParserContext | Setting up for {} parsers.", result->num_parsers_);
 
-  FLETCHER_ROE(fletcher::Platform::Make("opae", &result->platform, false));
-
+  // Create and initialize the platform.
   result->afu_id_ = afu_id;
-  char* afu_id_ptr = result->afu_id_.data();
-  result->platform->init_data = &afu_id_ptr;
-
-  // Initialize the platform.
-  FLETCHER_ROE(result->platform->Init());
+  BOLSON_ROE(MakePlatform(platform, &result->afu_id_, &result->platform));
 
   // Allocate input buffers.
-  BOLSON_ROE(result->AllocateBuffers(result->num_parsers_,
+  BOLSON_ROE(result->AllocateBuffers(result->num_parsers_ * result->num_sets_,
                                      result->allocator_->fixed_capacity()));
 
   // Pull everything through the fletcher stack once.
   FLETCHER_ROE(fletcher::Context::Make(&result->context, result->platform));
 
   BOLSON_ROE(result->PrepareInputBatches());
-  BOLSON_ROE(result->PrepareOutputBatch());
+  BOLSON_ROE(result->PrepareOutputSets());
 
   for (const auto& batch : result->batches_in) {
     FLETCHER_ROE(result->context->QueueRecordBatch(batch));
   }
 
-  FLETCHER_ROE(result->context->QueueRecordBatch(result->batch_out_hw));
+  for (const auto& batch : result->batches_out_hw) {
+    FLETCHER_ROE(result->context->QueueRecordBatch(batch));
+  }
 
   // Enable context.
   FLETCHER_ROE(result->context->Enable());
-  // Construct kernel handler.
+  // Construct kernel handler. The parser writes the metadata of every run, since the
+  // context holds more buffers than the kernel has registers for when double-buffered.
   result->kernel = std::make_shared<fletcher::Kernel>(result->context);
-  // Write metadata.
-  FLETCHER_ROE(result->kernel->WriteMetaData());
 
   // Workaround to obtain buffer device address.
   result->h2d_addr_map = ExtractAddrMap(result->context.get());
@@ -767,6 +916,18 @@ auto TripParserContext::Make(const TripOptions& opts, std::shared_ptr<ParserCont
                  kv.second);
   }
 
+  // Obtain the device addresses of the output buffers, in register order.
+  for (auto& set : result->output_sets) {
+    for (const auto& array : set.arrays_hw) {
+      for (const auto& buffer : array->data()->buffers) {
+        if (buffer != nullptr) {
+          const auto* host = reinterpret_cast<const std::byte*>(buffer->data());
+          set.addresses.push_back(result->h2d_addr_map.at(host));
+        }
+      }
+    }
+  }
+
   SPDLOG_DEBUG("TripParserContext | Preparing parser.");
   BOLSON_ROE(result->PrepareParser());
 
@@ -779,14 +940,27 @@ auto TripParserContext::parsers() -> std::vector<std::shared_ptr<Parser>> {
   return {parser};
 }
 
-TripParserContext::TripParserContext(const TripOptions& opts)
-    : num_parsers_(opts.num_parsers), afu_id_(opts.afu_id) {
-  allocator_ = std::make_shared<buffer::OpaeAllocator>();
+TripParserContext::TripParserContext(const TripOptions& opts, Platform platform,
+                                     const WaitOptions& wait)
+    : num_parsers_(opts.num_parsers),
+      afu_id_(opts.afu_id),
+      timestamp_(opts.timestamp),
+      num_sets_(opts.double_buffer ? 2 : 1),
+      wait_(wait),
+      allocator(platform == Platform::OPAE) {
+  // Only the OPAE platform requires buffers backed by huge pages.
+  allocator_ = std::make_shared<buffer::OpaeAllocator>(platform == Platform::OPAE);
 }
 
 auto TripParserContext::PrepareParser() -> Status {
   parser = std::make_shared<TripParser>(platform.get(), context.get(), kernel.get(),
-                                        &h2d_addr_map, &output_arrays_sw, num_parsers_);
+                                        &h2d_addr_map, &output_sets, num_parsers_, wait_);
+  // Timestamps are converted after fixing up the result of the kernel.
+  output_schema_ = TripParser::output_schema();
+  if (timestamp_) {
+    BOLSON_ROE(WithTimestampFields(*output_schema_, {"timestamp"}, &output_schema_));
+    parser->set_timestamp_columns({"timestamp"});
+  }
   return Status::OK();
 }
 
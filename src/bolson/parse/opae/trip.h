@@ -19,10 +19,14 @@
 
 #include <CLI/CLI.hpp>
 #include <memory>
+#include <optional>
 #include <utility>
+#include <vector>
 
 #include "bolson/buffer/opae_allocator.h"
+#include "bolson/parse/opae/opae.h"
 #include "bolson/parse/parser.h"
+#include "bolson/parse/wait.h"
 
 #define BOLSON_DEFAULT_OPAE_TRIP_PARSERS 4
 #define BOLSON_DEFAULT_OPAE_TRIP_AFUID "5d2f9dba-e8d0-44f8-943d-36b25c2d40"
@@ -32,25 +36,48 @@ namespace bolson::parse::opae {
 struct TripOptions {
   std::string afu_id;
   size_t num_parsers = BOLSON_DEFAULT_OPAE_TRIP_PARSERS;
+  /// Whether to convert the ISO-8601 "timestamp" field to an Arrow timestamp.
+  bool timestamp = false;
+  /// Whether to submit the next input buffers while the previous batch is processed.
+  bool double_buffer = false;
 };
 
 void AddTripOptionsToCLI(CLI::App* sub, TripOptions* out);
 
 using AddrMap = std::unordered_map<const std::byte*, da_t>;
 
+/// \brief Output buffers the trip report kernel writes a batch to.
+struct TripOutputSet {
+  /// Arrays wrapping the output buffers, with fixed size list fields, as used downstream.
+  std::vector<std::shared_ptr<arrow::Array>> arrays_sw;
+  /// Arrays wrapping the output buffers, with fixed size list fields wrapped as primitive
+  /// arrays, as used by Fletcher.
+  std::vector<std::shared_ptr<arrow::Array>> arrays_hw;
+  /// Device addresses of the output buffers, in the order of the kernel registers.
+  std::vector<da_t> addresses;
+  /// Expires when no batch wrapping the output buffers exists anymore.
+  std::weak_ptr<void> lease;
+};
+
 /**
  * \brief Host-side representation of the N:1 hardware parsers for trip report.
+ *
+ * With multiple output sets, the kernel can parse the next set of input buffers into
+ * one output set while the batch in the other output set is still being processed.
  */
-class TripParser : public Parser {
+class TripParser : public AsyncParser {
  public:
   /// \brief TripParser constructor.
   TripParser(fletcher::Platform* platform, fletcher::Context* context,
              fletcher::Kernel* kernel, AddrMap* addr_map,
-             std::vector<std::shared_ptr<arrow::Array>>* output_arrays,
-             size_t num_parsers);
+             std::vector<TripOutputSet>* output_sets, size_t num_parsers,
+             const WaitOptions& wait);
 
-  auto Parse(const std::vector<illex::JSONBuffer*>& in, std::vector<ParsedBatch>* out)
-      -> Status override;
+  auto Submit(const std::vector<illex::JSONBuffer*>& in) -> Status override;
+  auto Wait() -> Status override;
+  auto Collect(std::vector<ParsedBatch>* out) -> Status override;
+  [[nodiscard]] auto num_output_sets() const -> size_t override;
+  [[nodiscard]] auto wait_metrics() const -> WaitMetrics override;
 
   static auto input_schema() -> std::shared_ptr<arrow::Schema>;
   static auto output_schema() -> std::shared_ptr<arrow::Schema>;
@@ -63,14 +90,31 @@ class TripParser : public Parser {
   static const uint32_t ctrl_stop = (1u << 1u);
   static const uint32_t ctrl_reset = (1u << 2u);
 
+  /// A run of the kernel on a set of input buffers.
+  struct Run {
+    /// The output set the kernel writes to.
+    size_t output_set = 0;
+    /// The first sequence number of the input buffer of every hardware parser.
+    std::vector<uint64_t> seq_nos;
+    /// The number of JSONs in all input buffers.
+    size_t expected_rows = 0;
+    /// The number of bytes in all input buffers.
+    size_t bytes = 0;
+    /// The number of rows returned by the kernel.
+    uint64_t num_rows = 0;
+  };
+
   auto WriteInputMetaData(fletcher::Platform* platform, illex::JSONBuffer* in, size_t idx)
       -> Status;
+  auto WriteOutputMetaData(const TripOutputSet& set) -> Status;
 
   [[nodiscard]] auto custom_regs_offset() const -> size_t;
   static auto input_firstidx_offset(size_t idx) -> size_t;
   static auto input_lastidx_offset(size_t idx) -> size_t;
   [[nodiscard]] auto input_values_lo_offset(size_t idx) const -> size_t;
   [[nodiscard]] auto input_values_hi_offset(size_t idx) const -> size_t;
+  [[nodiscard]] auto output_firstidx_offset() const -> size_t;
+  [[nodiscard]] auto output_addr_lo_offset(size_t buffer) const -> size_t;
   [[nodiscard]] auto tag_offset(size_t idx) const -> size_t;
   [[nodiscard]] auto bytes_consumed_offset(size_t idx) const -> size_t;
 
@@ -79,7 +123,15 @@ class TripParser : public Parser {
   fletcher::Context* context_;
   fletcher::Kernel* kernel_;
   AddrMap* h2d_addr_map;
-  std::vector<std::shared_ptr<arrow::Array>>* output_arrays_sw_{};
+  std::vector<TripOutputSet>* output_sets_;
+  /// The output set of the next run.
+  size_t next_output_set_ = 0;
+  /// The run the kernel is working on, if any.
+  std::optional<Run> in_flight_;
+  /// The finished run of which the batch is not collected yet, if any.
+  std::optional<Run> finished_;
+  /// Waits for the kernel to finish runs.
+  Waiter waiter_;
 };
 
 /**
@@ -87,8 +139,8 @@ class TripParser : public Parser {
  */
 class TripParserContext : public ParserContext {
  public:
-  static auto Make(const TripOptions& opts, std::shared_ptr<ParserContext>* out)
-      -> Status;
+  static auto Make(const TripOptions& opts, Platform platform, const WaitOptions& wait,
+                   std::shared_ptr<ParserContext>* out) -> Status;
 
   auto parsers() -> std::vector<std::shared_ptr<Parser>> override;
   [[nodiscard]] auto CheckThreadCount(size_t num_threads) const -> size_t override;
@@ -97,28 +149,30 @@ class TripParserContext : public ParserContext {
   [[nodiscard]] auto output_schema() const -> std::shared_ptr<arrow::Schema> override;
 
  private:
-  explicit TripParserContext(const TripOptions& opts);
+  TripParserContext(const TripOptions& opts, Platform platform, const WaitOptions& wait);
 
   [[nodiscard]] auto PrepareInputBatches() -> Status;
-  [[nodiscard]] auto PrepareOutputBatch() -> Status;
+  [[nodiscard]] auto PrepareOutputSets() -> Status;
   [[nodiscard]] auto PrepareParser() -> Status;
 
   size_t num_parsers_;
   std::string afu_id_;
+  bool timestamp_;
+  std::shared_ptr<arrow::Schema> output_schema_;
+
+  /// Number of input buffer and output sets, two when double-buffered.
+  size_t num_sets_;
+  /// How the parser waits for the kernel.
+  WaitOptions wait_;
 
   buffer::OpaeAllocator allocator;
 
   std::vector<std::shared_ptr<arrow::RecordBatch>> batches_in;
-  std::shared_ptr<arrow::RecordBatch> batch_out_hw;
+  std::vector<std::shared_ptr<arrow::RecordBatch>> batches_out_hw;
 
   // We create different views of the data for Fletcher integration and the downstream
   // code, since Fletcher currently doesn't support fixed size lists without workarounds.
-  std::vector<std::shared_ptr<arrow::Array>> output_arrays_sw;
-  // In case of 'output_arrays_hw', we wrap the buffers behind fixed size list fields
-  // as primitive arrays.
-  std::vector<std::shared_ptr<arrow::Array>> output_arrays_hw;
-
-  std::shared_ptr<arrow::RecordBatch> batch_out_sw;
+  std::vector<TripOutputSet> output_sets;
 
   std::shared_ptr<fletcher::Platform> platform;
   std::shared_ptr<fletcher::Context> context;
@@ -131,4 +185,28 @@ class TripParserContext : public ParserContext {
 
 auto TripReportBatchToString(const arrow::RecordBatch& batch) -> std::string;
 
+/**
+ * \brief Turn the tags of the kernel into sequence numbers, in place.
+ *
+ * Rows of a parser instance are in order, so the n-th row tagged with some instance gets
+ * the n-th sequence number of the input buffer of that instance. Overwrites the tag
+ * buffer, which the kernel writes to again in a later run.
+ *
+ * \param tags    The tags of all rows.
+ * \param seq_nos The next sequence number of every instance, advanced for every row.
+ */
+void ConvertTagsToSeq(const arrow::UInt64Array& tags, std::vector<uint64_t>* seq_nos);
+
+/**
+ * \brief Pack bytes into a bitmap in Arrow bit order, setting bits of non-zero bytes.
+ *
+ * Uses SSE2, and AVX2 when built with BOLSON_AVX2. Padding bits of the last byte are
+ * cleared.
+ *
+ * \param bytes  The bytes to pack.
+ * \param length The number of bytes.
+ * \param bits   The bitmap, of at least (length + 7) / 8 bytes.
+ */
+void PackBytes(const uint8_t* bytes, int64_t length, uint8_t* bits);
+
 }  // namespace bolson::parse::opae
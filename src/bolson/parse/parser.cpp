@@ -14,10 +14,59 @@
 
 #include "bolson/parse/parser.h"
 
+#include "bolson/parse/timestamp.h"
 #include "bolson/status.h"
 
 namespace bolson::parse {
 
+auto ToString(Handoff handoff) -> std::string {
+  switch (handoff) {
+    case Handoff::QUEUE:
+      return "Queue";
+    case Handoff::MUTEX:
+      return "Mutex";
+  }
+  return "Corrupt bolson::parse::Handoff enum value.";
+}
+
+ReadyQueue::ReadyQueue() { queues_.push_back(std::make_unique<NodeQueue>()); }
+
+void ReadyQueue::SetNodes(
+    size_t num_nodes, std::unordered_map<const illex::JSONBuffer*, size_t> buffer_nodes) {
+  while (queues_.size() < num_nodes) {
+    queues_.push_back(std::make_unique<NodeQueue>());
+  }
+  nodes_ = std::move(buffer_nodes);
+}
+
+void ReadyQueue::enqueue(illex::JSONBuffer* buffer) {
+  size_t node = 0;
+  if (queues_.size() > 1) {
+    auto placed = nodes_.find(buffer);
+    if (placed != nodes_.end()) {
+      node = placed->second;
+    }
+  }
+  queues_[node]->enqueue(buffer);
+  items_.signal();
+}
+
+auto ReadyQueue::wait_dequeue_timed(size_t node, illex::JSONBuffer*& out,
+                                    std::chrono::microseconds timeout) -> bool {
+  if (!items_.wait(timeout.count())) {
+    return false;
+  }
+  // A buffer was enqueued on one of the queues, but it may not be visible yet.
+  node = node % queues_.size();
+  while (true) {
+    for (size_t q = 0; q < queues_.size(); q++) {
+      if (queues_[(node + q) % queues_.size()]->try_dequeue(out)) {
+        return true;
+      }
+    }
+  }
+}
+
 auto ToString(const illex::JSONBuffer& buffer, bool show_contents) -> std::string {
   std::stringstream ss;
   ss << "Buffer    : " << buffer.data() << "\n"
@@ -46,6 +95,90 @@ auto AddSeqAsSchemaMeta(const std::shared_ptr<arrow::RecordBatch>& batch,
   }
 }
 
+auto AddSeqColumn(const std::shared_ptr<arrow::RecordBatch>& batch,
+                  illex::SeqRange seq_range, std::shared_ptr<arrow::RecordBatch>* out,
+                  arrow::MemoryPool* pool) -> Status {
+  std::shared_ptr<arrow::UInt64Array> seq;
+  arrow::UInt64Builder builder(pool);
+  ARROW_ROE(builder.Reserve(seq_range.last - seq_range.first + 1));
+  for (uint64_t s = seq_range.first; s <= seq_range.last; s++) {
+    builder.UnsafeAppend(s);
+  }
+  ARROW_ROE(builder.Finish(&seq));
+  auto result = batch->AddColumn(0, "bolson_seq", seq);
+  if (!result.ok()) {
+    return Status(Error::ArrowError, result.status().message());
+  }
+  *out = result.ValueOrDie();
+  return Status::OK();
+}
+
+auto AppendNull(arrow::ArrayBuilder* builder) -> Status {
+  ARROW_ROE(builder->AppendNull());
+  // Struct builders don't append to their children, which must keep the same length.
+  if (builder->type()->id() == arrow::Type::STRUCT) {
+    for (int c = 0; c < builder->num_children(); c++) {
+      BOLSON_ROE(AppendNull(builder->child(c)));
+    }
+  }
+  return Status::OK();
+}
+
+auto Parser::ConvertTimestamps(std::shared_ptr<arrow::RecordBatch>* batch) const
+    -> Status {
+  for (const auto& column : timestamp_columns_) {
+    auto index = (*batch)->schema()->GetFieldIndex(column);
+    if ((index < 0) || ((*batch)->column(index)->type_id() != arrow::Type::STRING)) {
+      return Status(Error::GenericError,
+                    "Parsed batch has no string column \"" + column + "\".");
+    }
+    std::shared_ptr<arrow::Array> timestamps;
+    BOLSON_ROE(ParseTimestamps(
+        static_cast<const arrow::StringArray&>(*(*batch)->column(index)), memory_pool_,
+        &timestamps));
+    auto field = (*batch)->schema()->field(index)->WithType(TimestampType());
+    auto result = (*batch)->SetColumn(index, field, timestamps);
+    if (!result.ok()) {
+      return Status(Error::ArrowError, result.status().message());
+    }
+    *batch = result.ValueOrDie();
+  }
+  return Status::OK();
+}
+
+/// \brief Return true if a type is, or is nested with, a dictionary type.
+static auto HasDictionary(const arrow::DataType& type) -> bool {
+  if (type.id() == arrow::Type::DICTIONARY) return true;
+  for (const auto& child : type.fields()) {
+    if (HasDictionary(*child->type())) return true;
+  }
+  return false;
+}
+
+auto DecodeDictionaries(const arrow::Schema& schema, std::shared_ptr<arrow::Schema>* out)
+    -> Status {
+  arrow::FieldVector fields;
+  for (const auto& field : schema.fields()) {
+    if (field->type()->id() == arrow::Type::DICTIONARY) {
+      const auto& dict = static_cast<const arrow::DictionaryType&>(*field->type());
+      if (HasDictionary(*dict.value_type())) {
+        return Status(Error::GenericError,
+                      "Nested dictionary in field \"" + field->name() + "\".");
+      }
+      fields.push_back(field->WithType(dict.value_type()));
+    } else if (HasDictionary(*field->type())) {
+      return Status(Error::GenericError, "Dictionary nested in field \"" +
+                                             field->name() +
+                                             "\". Only top-level fields may be "
+                                             "dictionary-encoded.");
+    } else {
+      fields.push_back(field);
+    }
+  }
+  *out = arrow::schema(fields, schema.metadata());
+  return Status::OK();
+}
+
 auto WithSeqField(const arrow::Schema& schema, std::shared_ptr<arrow::Schema>* output)
     -> Status {
   auto add_result =
@@ -65,10 +198,10 @@ auto ParserContext::AllocateBuffers(size_t num_buffers, size_t capacity) -> Stat
     return Status(Error::GenericError,
                   "Parser context has no allocator to allocate buffers.");
   }
-  // Allocate all buffers and create mutexes.
+  // Allocate all buffers and create mutexes. Padding is not exposed as capacity.
   for (size_t b = 0; b < num_buffers; b++) {
     std::byte* raw = nullptr;
-    BOLSON_ROE(allocator_->Allocate(capacity, &raw));
+    BOLSON_ROE(allocator_->Allocate(capacity + buffer_padding_, &raw));
     illex::JSONBuffer buf;
     BILLEX_ROE(illex::JSONBuffer::Create(raw, capacity, &buf));
     buffers_.push_back(buf);
@@ -76,6 +209,11 @@ auto ParserContext::AllocateBuffers(size_t num_buffers, size_t capacity) -> Stat
 
   mutexes_ = std::vector<std::mutex>(num_buffers);
 
+  // Initially, all buffers are empty and may be filled.
+  for (auto& buffer : buffers_) {
+    free_.enqueue(&buffer);
+  }
+
   return Status::OK();
 }
 
@@ -104,6 +242,39 @@ void ParserContext::UnlockBuffers() {
   }
 }
 
+auto ParserContext::ready_queue() -> ReadyQueue* { return &ready_; }
+
+auto ParserContext::free_queue() -> BufferQueue* { return &free_; }
+
+void ParserContext::ClaimBuffers() {
+  illex::JSONBuffer* buffer = nullptr;
+  for (size_t b = 0; b < buffers_.size(); b++) {
+    free_.wait_dequeue(buffer);
+  }
+}
+
+void ParserContext::PublishBuffers() {
+  for (auto& buffer : buffers_) {
+    if (buffer.empty()) {
+      free_.enqueue(&buffer);
+    } else {
+      ready_.enqueue(&buffer);
+    }
+  }
+}
+
+auto ParserContext::PlaceBuffers(const Topology& topology) -> Status {
+  std::unordered_map<const illex::JSONBuffer*, size_t> buffer_nodes;
+  for (size_t b = 0; b < buffers_.size(); b++) {
+    auto node = topology.node(b);
+    auto size = buffers_[b].capacity() + buffer_padding_;
+    BOLSON_ROE(BindMemory(buffers_[b].mutable_data(), size, topology.nodes[node]));
+    buffer_nodes[&buffers_[b]] = node;
+  }
+  ready_.SetNodes(topology.nodes.size(), std::move(buffer_nodes));
+  return Status::OK();
+}
+
 auto ParserContext::mutable_buffers() -> std::vector<illex::JSONBuffer*> {
   return ToPointers(buffers_);
 }
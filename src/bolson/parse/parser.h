@@ -15,19 +15,86 @@
 #pragma once
 
 #include <arrow/api.h>
+#include <blockingconcurrentqueue.h>
 #include <illex/client_buffering.h>
 
+#include <chrono>
+#include <memory>
+#include <string>
+#include <unordered_map>
 #include <utility>
 #include <variant>
 
 #include "bolson/buffer/allocator.h"
 #include "bolson/latency.h"
+#include "bolson/numa.h"
+#include "bolson/parse/wait.h"
 #include "bolson/status.h"
 #include "bolson/utils.h"
 
+/// Time converter threads block on the ready queue before checking for shutdown.
+#define BOLSON_READY_QUEUE_WAIT_US 1000
+
 /// Contains all constructs to parse JSONs to Arrow RecordBatches
 namespace bolson::parse {
 
+/// Mechanisms to hand off input buffers between the client and the parsers.
+enum class Handoff {
+  QUEUE,  ///< Buffers are passed through lock-free ready and free queues.
+  MUTEX   ///< Parsers scan all buffers, probing their mutexes for filled buffers.
+};
+
+/// \brief Return human-readable Handoff enum.
+auto ToString(Handoff handoff) -> std::string;
+
+/// A lock-free MPMC queue of input buffers.
+using BufferQueue = moodycamel::BlockingConcurrentQueue<illex::JSONBuffer*>;
+
+/**
+ * \brief A lock-free MPMC queue of filled buffers, split up per NUMA node.
+ *
+ * Buffers are enqueued on the queue of the node their memory is placed on. Consumers
+ * take buffers from the queue of their own node first, and from the other nodes if
+ * their own node has none. Buffers of unknown placement are enqueued on the first node.
+ * Without placement, there is just a single node.
+ */
+class ReadyQueue {
+ public:
+  ReadyQueue();
+
+  /**
+   * \brief Set the node of every buffer. Not thread-safe.
+   * \param num_nodes    The number of nodes.
+   * \param buffer_nodes The node index of every buffer.
+   */
+  void SetNodes(size_t num_nodes,
+                std::unordered_map<const illex::JSONBuffer*, size_t> buffer_nodes);
+
+  /// \brief Enqueue a filled buffer.
+  void enqueue(illex::JSONBuffer* buffer);
+
+  /// \brief Dequeue a filled buffer, preferring buffers on some node. Return true if
+  /// a buffer was dequeued before the timeout.
+  auto wait_dequeue_timed(size_t node, illex::JSONBuffer*& out,
+                          std::chrono::microseconds timeout) -> bool;
+
+  /// \brief Dequeue a filled buffer from any node. Return true if a buffer was dequeued
+  /// before the timeout.
+  auto wait_dequeue_timed(illex::JSONBuffer*& out, std::chrono::microseconds timeout)
+      -> bool {
+    return wait_dequeue_timed(0, out, timeout);
+  }
+
+ private:
+  using NodeQueue = moodycamel::ConcurrentQueue<illex::JSONBuffer*>;
+  /// A queue per node.
+  std::vector<std::unique_ptr<NodeQueue>> queues_;
+  /// The node of every placed buffer.
+  std::unordered_map<const illex::JSONBuffer*, size_t> nodes_;
+  /// The number of buffers in all queues.
+  moodycamel::LightweightSemaphore items_;
+};
+
 /**
  * \brief The result of parsing a raw JSON buffer.
  */
@@ -60,6 +127,66 @@ class Parser {
    */
   virtual auto Parse(const std::vector<illex::JSONBuffer*>& buffers_in,
                      std::vector<ParsedBatch>* batches_out) -> Status = 0;
+
+  /**
+   * \brief Set the memory pool to allocate parsed batches from.
+   *
+   * Implementations that keep builders across buffers rebuild them from the new pool.
+   * Implementations that don't allocate batches through Arrow memory pools ignore this.
+   */
+  virtual auto set_memory_pool(arrow::MemoryPool* pool) -> Status {
+    memory_pool_ = pool;
+    return Status::OK();
+  }
+
+  /// \brief Set the string columns to convert to timestamps after parsing.
+  void set_timestamp_columns(std::vector<std::string> columns) {
+    timestamp_columns_ = std::move(columns);
+  }
+
+  /// \brief Return the statistics of waiting on a device, for parsers that offload.
+  [[nodiscard]] virtual auto wait_metrics() const -> WaitMetrics { return {}; }
+
+ protected:
+  /// \brief Convert the timestamp columns of a parsed batch from ISO-8601 strings.
+  auto ConvertTimestamps(std::shared_ptr<arrow::RecordBatch>* batch) const -> Status;
+
+  /// The memory pool to allocate parsed batches from.
+  arrow::MemoryPool* memory_pool_ = arrow::default_memory_pool();
+  /// Names of the string columns to convert to timestamps.
+  std::vector<std::string> timestamp_columns_;
+};
+
+/**
+ * \brief Abstract class for parsers that offload parsing to a device.
+ *
+ * Parsing is split in three steps, so that host work can overlap with the device.
+ * A run of the device on a set of input buffers is started with Submit(). Wait() blocks
+ * until the run is finished, after which its input buffers may be reused. Collect()
+ * obtains the batches of the last finished run. At most one run is in flight, but the
+ * next run may be submitted before the batches of the previous run are collected, as
+ * long as the parser has multiple output sets to write them to.
+ */
+class AsyncParser : public Parser {
+ public:
+  /// \brief Start a run of the device on some input buffers.
+  virtual auto Submit(const std::vector<illex::JSONBuffer*>& buffers_in) -> Status = 0;
+
+  /// \brief Wait for the run in flight, if any, to finish.
+  virtual auto Wait() -> Status = 0;
+
+  /// \brief Append the batches of the last finished run, if any, to batches_out.
+  virtual auto Collect(std::vector<ParsedBatch>* batches_out) -> Status = 0;
+
+  /// \brief Return the number of runs whose batches may exist at the same time.
+  [[nodiscard]] virtual auto num_output_sets() const -> size_t = 0;
+
+  auto Parse(const std::vector<illex::JSONBuffer*>& buffers_in,
+             std::vector<ParsedBatch>* batches_out) -> Status override {
+    BOLSON_ROE(Submit(buffers_in));
+    BOLSON_ROE(Wait());
+    return Collect(batches_out);
+  }
 };
 
 /**
@@ -80,6 +207,17 @@ class ParserContext {
     return num_buffers;
   }
 
+  /**
+   * \brief Return whether parsers can parse buffers not allocated by this context.
+   *
+   * If true, clients may hand over buffers wrapping their own memory, e.g. a mapped file,
+   * through the ready queue, as long as they take them back from the free queue.
+   */
+  [[nodiscard]] virtual auto AcceptsForeignBuffers() const -> bool { return false; }
+
+  /// \brief Return whether parsers modify the contents of the buffers while parsing.
+  [[nodiscard]] virtual auto ModifiesBuffers() const -> bool { return false; }
+
   /// \brief Return the Arrow input schema used by the parsers to convert JSONS.
   [[nodiscard]] virtual auto input_schema() const -> std::shared_ptr<arrow::Schema> = 0;
 
@@ -102,16 +240,52 @@ class ParserContext {
   /// \brief Unlock all mutexes of all buffers.
   void UnlockBuffers();
 
+  /**
+   * \brief Return the queue of filled buffers.
+   *
+   * When using Handoff::QUEUE, a client publishes buffers it has filled on this queue.
+   * A parser that dequeues a buffer owns it until it returns it through free_queue().
+   */
+  auto ready_queue() -> ReadyQueue*;
+
+  /**
+   * \brief Return the queue of empty buffers.
+   *
+   * When using Handoff::QUEUE, parsers return drained buffers on this queue, and a
+   * client may take any buffer from it to fill. Initially holds all buffers.
+   */
+  auto free_queue() -> BufferQueue*;
+
+  /// \brief Take all buffers from the free queue, blocking until all are returned.
+  void ClaimBuffers();
+
+  /// \brief Publish all non-empty buffers on the ready queue, return the others.
+  void PublishBuffers();
+
+  /**
+   * \brief Place the input buffers on the nodes of a topology round-robin.
+   *
+   * Moves the memory of every buffer to its node, and routes the buffer to the ready
+   * queue of its node.
+   */
+  auto PlaceBuffers(const Topology& topology) -> Status;
+
  protected:
   virtual auto AllocateBuffers(size_t num_buffers, size_t capacity) -> Status;
   virtual auto FreeBuffers() -> Status;
 
   // The allocator used for the buffers.
   std::shared_ptr<buffer::Allocator> allocator_ = nullptr;
+  /// Bytes allocated beyond the capacity of each buffer, for parsers that over-read.
+  size_t buffer_padding_ = 0;
   /// The input buffers.
   std::vector<illex::JSONBuffer> buffers_;
   /// The mutexes for the input buffers.
   std::vector<std::mutex> mutexes_;
+  /// Filled buffers, ready to be parsed.
+  ReadyQueue ready_;
+  /// Empty buffers, ready to be filled.
+  BufferQueue free_;
 };
 
 /// \brief Print properties of the buffer in human-readable format.
@@ -121,6 +295,23 @@ auto ToString(const illex::JSONBuffer& buffer, bool show_contents = true) -> std
 auto AddSeqAsSchemaMeta(const std::shared_ptr<arrow::RecordBatch>& batch,
                         illex::SeqRange seq_range) -> std::shared_ptr<arrow::RecordBatch>;
 
+/// \brief Prepend a "bolson_seq" column with all sequence numbers in the range.
+auto AddSeqColumn(const std::shared_ptr<arrow::RecordBatch>& batch,
+                  illex::SeqRange seq_range, std::shared_ptr<arrow::RecordBatch>* out,
+                  arrow::MemoryPool* pool = arrow::default_memory_pool()) -> Status;
+
+/// \brief Append a null to a builder, including the children of struct builders.
+auto AppendNull(arrow::ArrayBuilder* builder) -> Status;
+
+/**
+ * \brief Return a schema with dictionary-encoded fields replaced by their value fields.
+ *
+ * Parsers parse the values of dictionary-encoded fields, which are encoded when the
+ * batches are serialized. Only top-level fields may be dictionary-encoded.
+ */
+auto DecodeDictionaries(const arrow::Schema& schema, std::shared_ptr<arrow::Schema>* out)
+    -> Status;
+
 /// \brief Return a new schema with the sequence number field added.
 auto WithSeqField(const arrow::Schema& schema, std::shared_ptr<arrow::Schema>* output)
     -> Status;
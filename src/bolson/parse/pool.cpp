@@ -0,0 +1,70 @@
+// Copyright 2020 Teratide B.V.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "bolson/parse/pool.h"
+
+#include <chrono>
+
+#include "bolson/parse/parser.h"
+
+namespace bolson::parse {
+
+TaskPool::TaskPool(size_t num_threads) {
+  for (size_t t = 0; t < num_threads; t++) {
+    threads_.emplace_back([this]() {
+      Task task;
+      while (!stop_.load()) {
+        if (queue_.wait_dequeue_timed(
+                task, std::chrono::microseconds(BOLSON_READY_QUEUE_WAIT_US))) {
+          Execute(task);
+        }
+      }
+    });
+  }
+}
+
+TaskPool::~TaskPool() {
+  stop_.store(true);
+  for (auto& thread : threads_) {
+    thread.join();
+  }
+}
+
+void TaskPool::Execute(const Task& task) {
+  (*task.fn)();
+  task.remaining->fetch_sub(1);
+}
+
+void TaskPool::Run(const std::vector<std::function<void()>>& tasks) {
+  std::atomic<size_t> remaining = tasks.size();
+  std::vector<Task> queued;
+  queued.reserve(tasks.size());
+  for (const auto& fn : tasks) {
+    queued.push_back({&fn, &remaining});
+  }
+  queue_.enqueue_bulk(queued.begin(), queued.size());
+
+  // Help out until all our tasks are completed.
+  Task task;
+  while (remaining.load() > 0) {
+    if (queue_.try_dequeue(task)) {
+      Execute(task);
+    } else {
+      std::this_thread::yield();
+    }
+  }
+}
+
+}  // namespace bolson::parse
@@ -0,0 +1,63 @@
+// Copyright 2020 Teratide B.V.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#pragma once
+
+#include <blockingconcurrentqueue.h>
+
+#include <atomic>
+#include <functional>
+#include <thread>
+#include <vector>
+
+namespace bolson::parse {
+
+/**
+ * \brief A pool of threads executing tasks from a shared queue.
+ *
+ * Threads that submit tasks help executing queued tasks until their own tasks are done,
+ * including tasks submitted by other threads. Hence, a pool without worker threads just
+ * executes tasks on the submitting threads.
+ */
+class TaskPool {
+ public:
+  /// \brief Construct a pool and spawn its worker threads.
+  explicit TaskPool(size_t num_threads);
+  /// \brief Stop and join the worker threads.
+  ~TaskPool();
+
+  TaskPool(const TaskPool&) = delete;
+  auto operator=(const TaskPool&) -> TaskPool& = delete;
+
+  /// \brief Run tasks on the pool, and return when all of them are completed.
+  void Run(const std::vector<std::function<void()>>& tasks);
+
+  /// \brief Return the number of worker threads.
+  [[nodiscard]] auto num_threads() const -> size_t { return threads_.size(); }
+
+ private:
+  struct Task {
+    const std::function<void()>* fn = nullptr;
+    std::atomic<size_t>* remaining = nullptr;
+  };
+
+  static void Execute(const Task& task);
+
+  moodycamel::BlockingConcurrentQueue<Task> queue_;
+  std::vector<std::thread> threads_;
+  std::atomic<bool> stop_ = false;
+};
+
+}  // namespace bolson::parse
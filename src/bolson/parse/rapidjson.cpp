@@ -0,0 +1,566 @@
+// Copyright 2020 Teratide B.V.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "bolson/parse/rapidjson.h"
+
+#include <arrow/api.h>
+#include <rapidjson/error/en.h>
+#include <rapidjson/reader.h>
+
+#include <limits>
+#include <memory>
+#include <string_view>
+#include <type_traits>
+
+#include "bolson/log.h"
+#include "bolson/parse/parser.h"
+#include "bolson/parse/timestamp.h"
+
+namespace bolson::parse {
+
+/// \brief Return whether an integer value fits in another integer type.
+template <typename To, typename From>
+static auto InRange(From v) -> bool {
+  if constexpr (std::is_signed_v<From>) {
+    if (v < 0) {
+      constexpr auto min = static_cast<int64_t>(std::numeric_limits<To>::min());
+      return std::is_signed_v<To> && (static_cast<int64_t>(v) >= min);
+    }
+  }
+  constexpr auto max = static_cast<uint64_t>(std::numeric_limits<To>::max());
+  return static_cast<uint64_t>(v) <= max;
+}
+
+/**
+ * \brief RapidJSON SAX handler appending values to Arrow builders.
+ *
+ * Keeps a stack of frames for the objects and arrays being parsed. Every value event is
+ * appended to the builder of the field named by the last key, or to the item builder of
+ * the enclosing list. On errors, the handler stops the reader and records the status.
+ *
+ * If unknown fields are skipped, the events of the value of an unknown top-level key are
+ * dropped, so the value is validated but never materialized.
+ */
+class SaxHandler {
+ public:
+  static auto Make(const std::shared_ptr<arrow::Schema>& schema, bool skip_unknown,
+                   arrow::MemoryPool* pool, std::unique_ptr<SaxHandler>* out) -> Status {
+    auto result = std::unique_ptr<SaxHandler>(new SaxHandler(schema, skip_unknown));
+    for (const auto& field : schema->fields()) {
+      std::unique_ptr<arrow::ArrayBuilder> builder;
+      ARROW_ROE(arrow::MakeBuilder(pool, field->type(), &builder));
+      result->builder_ptrs_.push_back(builder.get());
+      result->builders_.push_back(std::move(builder));
+    }
+    *out = std::move(result);
+    return Status::OK();
+  }
+
+  /// \brief Prepare the handler for a new buffer with an expected number of rows.
+  auto Reset(int64_t num_rows) -> Status {
+    depth_ = 0;
+    skip_depth_ = 0;
+    skip_value_ = false;
+    num_rows_ = 0;
+    status_ = Status::OK();
+    for (auto& builder : builders_) {
+      builder->Reset();
+      ARROW_ROE(builder->Reserve(num_rows));
+    }
+    return Status::OK();
+  }
+
+  /// \brief Finish the builders into columns.
+  auto Finish(arrow::ArrayVector* out) -> Status {
+    for (auto& builder : builders_) {
+      std::shared_ptr<arrow::Array> column;
+      ARROW_ROE(builder->Finish(&column));
+      out->push_back(column);
+    }
+    return Status::OK();
+  }
+
+  [[nodiscard]] auto num_rows() const -> int64_t { return num_rows_; }
+  [[nodiscard]] auto status() const -> const Status& { return status_; }
+
+  // RapidJSON handler concept.
+  auto Null() -> bool {
+    if (SkipScalar()) return true;
+    const arrow::Field* field = nullptr;
+    arrow::ArrayBuilder* builder = nullptr;
+    if (!Target(&field, &builder)) return false;
+    if (!field->nullable()) {
+      return Fail("Null value for non-nullable field \"" + field->name() + "\".");
+    }
+    return Check(AppendNull(builder));
+  }
+
+  auto Bool(bool b) -> bool {
+    if (SkipScalar()) return true;
+    const arrow::Field* field = nullptr;
+    arrow::ArrayBuilder* builder = nullptr;
+    if (!Target(&field, &builder)) return false;
+    if (field->type()->id() != arrow::Type::BOOL) return Mismatch(*field, "boolean");
+    return Check(static_cast<arrow::BooleanBuilder*>(builder)->Append(b));
+  }
+
+  auto Int(int i) -> bool { return Number(static_cast<int64_t>(i)); }
+  auto Uint(unsigned u) -> bool { return Number(static_cast<uint64_t>(u)); }
+  auto Int64(int64_t i) -> bool { return Number(i); }
+  auto Uint64(uint64_t u) -> bool { return Number(u); }
+  auto Double(double d) -> bool { return Number(d); }
+
+  auto RawNumber(const char* /*str*/, rapidjson::SizeType /*length*/, bool /*copy*/)
+      -> bool {
+    return Fail("Raw numbers are not supported.");
+  }
+
+  auto String(const char* str, rapidjson::SizeType length, bool /*copy*/) -> bool {
+    if (SkipScalar()) return true;
+    const arrow::Field* field = nullptr;
+    arrow::ArrayBuilder* builder = nullptr;
+    if (!Target(&field, &builder)) return false;
+    if (field->type()->id() != arrow::Type::STRING) return Mismatch(*field, "string");
+    return Check(static_cast<arrow::StringBuilder*>(builder)->Append(
+        str, static_cast<int32_t>(length)));
+  }
+
+  auto StartObject() -> bool {
+    if (SkipContainer()) return true;
+    // Top-level objects are rows of the batch.
+    if (depth_ == 0) {
+      auto& frame = Push();
+      frame.fields = &schema_->fields();
+      frame.builders = builder_ptrs_;
+      frame.length = builder_ptrs_.empty() ? 0 : builder_ptrs_[0]->length();
+      return true;
+    }
+    const arrow::Field* field = nullptr;
+    arrow::ArrayBuilder* builder = nullptr;
+    if (!Target(&field, &builder)) return false;
+    if (field->type()->id() != arrow::Type::STRUCT) return Mismatch(*field, "object");
+    auto* struct_builder = static_cast<arrow::StructBuilder*>(builder);
+    if (!Check(struct_builder->Append())) return false;
+    auto& frame = Push();
+    frame.fields = &field->type()->fields();
+    frame.builders.clear();
+    for (int c = 0; c < struct_builder->num_children(); c++) {
+      frame.builders.push_back(struct_builder->field_builder(c));
+    }
+    frame.length = frame.builders.empty() ? 0 : frame.builders[0]->length();
+    return true;
+  }
+
+  auto Key(const char* str, rapidjson::SizeType length, bool /*copy*/) -> bool {
+    if (skip_depth_ > 0) return true;
+    auto& frame = stack_[depth_ - 1];
+    const auto& fields = *frame.fields;
+    std::string_view key(str, length);
+    // Objects typically list their fields in schema order, so try the next one first.
+    size_t f = frame.next;
+    if ((f >= fields.size()) || (fields[f]->name() != key)) {
+      for (f = 0; f < fields.size(); f++) {
+        if (fields[f]->name() == key) break;
+      }
+      if (f == fields.size()) {
+        if (skip_unknown_ && (depth_ == 1)) {
+          skip_value_ = true;
+          return true;
+        }
+        return Fail("JSON field \"" + std::string(key) + "\" not in schema.");
+      }
+    }
+    frame.field = f;
+    frame.next = f + 1;
+    return true;
+  }
+
+  auto EndObject(rapidjson::SizeType /*member_count*/) -> bool {
+    if (EndSkippedContainer()) return true;
+    auto& frame = stack_[depth_ - 1];
+    // Fill in fields that were not present in the object.
+    for (size_t f = 0; f < frame.fields->size(); f++) {
+      const auto& field = (*frame.fields)[f];
+      auto* builder = frame.builders[f];
+      if (builder->length() == frame.length) {
+        if (!field->nullable()) {
+          return Fail("Non-nullable field \"" + field->name() + "\" missing.");
+        }
+        if (!Check(AppendNull(builder))) return false;
+      } else if (builder->length() != frame.length + 1) {
+        return Fail("Duplicate JSON field \"" + field->name() + "\".");
+      }
+    }
+    depth_--;
+    if (depth_ == 0) {
+      num_rows_++;
+    }
+    return true;
+  }
+
+  auto StartArray() -> bool {
+    if (SkipContainer()) return true;
+    if (depth_ == 0) return Fail("JSONs must be objects.");
+    const arrow::Field* field = nullptr;
+    arrow::ArrayBuilder* builder = nullptr;
+    if (!Target(&field, &builder)) return false;
+    const arrow::Field* item = nullptr;
+    arrow::ArrayBuilder* item_builder = nullptr;
+    int32_t fixed_size = -1;
+    switch (field->type()->id()) {
+      case arrow::Type::LIST: {
+        auto* list_builder = static_cast<arrow::ListBuilder*>(builder);
+        if (!Check(list_builder->Append())) return false;
+        item = static_cast<const arrow::ListType&>(*field->type()).value_field().get();
+        item_builder = list_builder->value_builder();
+        break;
+      }
+      case arrow::Type::FIXED_SIZE_LIST: {
+        auto* list_builder = static_cast<arrow::FixedSizeListBuilder*>(builder);
+        if (!Check(list_builder->Append())) return false;
+        const auto& type = static_cast<const arrow::FixedSizeListType&>(*field->type());
+        item = type.value_field().get();
+        item_builder = list_builder->value_builder();
+        fixed_size = type.list_size();
+        break;
+      }
+      default:
+        return Mismatch(*field, "array");
+    }
+    auto& frame = Push();
+    frame.fields = nullptr;
+    frame.item = item;
+    frame.item_builder = item_builder;
+    frame.num_items = 0;
+    frame.fixed_size = fixed_size;
+    return true;
+  }
+
+  auto EndArray(rapidjson::SizeType /*element_count*/) -> bool {
+    if (EndSkippedContainer()) return true;
+    auto& frame = stack_[depth_ - 1];
+    if ((frame.fixed_size >= 0) && (frame.num_items != frame.fixed_size)) {
+      return Fail("Expected " + std::to_string(frame.fixed_size) + " list items, got " +
+                  std::to_string(frame.num_items) + ".");
+    }
+    depth_--;
+    return true;
+  }
+
+ private:
+  /// An object or array that is being parsed.
+  struct Frame {
+    /// Fields of an object, nullptr for arrays.
+    const arrow::FieldVector* fields = nullptr;
+    /// Builders of the fields of an object.
+    std::vector<arrow::ArrayBuilder*> builders;
+    /// Length of the field builders before the object was parsed.
+    int64_t length = 0;
+    /// Index of the field of the last key, or the number of fields if not set.
+    size_t field = std::numeric_limits<size_t>::max();
+    /// Index of the field expected to be the next key.
+    size_t next = 0;
+    /// Item field of an array.
+    const arrow::Field* item = nullptr;
+    /// Item builder of an array.
+    arrow::ArrayBuilder* item_builder = nullptr;
+    /// Number of items parsed in an array.
+    int32_t num_items = 0;
+    /// Expected number of items of fixed-size lists, or -1.
+    int32_t fixed_size = -1;
+  };
+
+  SaxHandler(std::shared_ptr<arrow::Schema> schema, bool skip_unknown)
+      : schema_(std::move(schema)), skip_unknown_(skip_unknown) {}
+
+  /// \brief Return true if a scalar value event is part of a skipped value.
+  auto SkipScalar() -> bool {
+    if (skip_depth_ > 0) return true;
+    if (skip_value_) {
+      skip_value_ = false;
+      return true;
+    }
+    return false;
+  }
+
+  /// \brief Return true if an object or array starts that is part of a skipped value.
+  auto SkipContainer() -> bool {
+    if ((skip_depth_ > 0) || skip_value_) {
+      skip_value_ = false;
+      skip_depth_++;
+      return true;
+    }
+    return false;
+  }
+
+  /// \brief Return true if an object or array ends that is part of a skipped value.
+  auto EndSkippedContainer() -> bool {
+    if (skip_depth_ > 0) {
+      skip_depth_--;
+      return true;
+    }
+    return false;
+  }
+
+  /// \brief Push a new frame. Frames are reused to keep their builder vectors allocated.
+  auto Push() -> Frame& {
+    if (depth_ == stack_.size()) {
+      stack_.emplace_back();
+    }
+    auto& frame = stack_[depth_++];
+    frame.field = std::numeric_limits<size_t>::max();
+    frame.next = 0;
+    return frame;
+  }
+
+  /// \brief Obtain the field and builder the next value should be appended to.
+  auto Target(const arrow::Field** field, arrow::ArrayBuilder** builder) -> bool {
+    if (depth_ == 0) return Fail("JSONs must be objects.");
+    auto& frame = stack_[depth_ - 1];
+    if (frame.fields == nullptr) {
+      *field = frame.item;
+      *builder = frame.item_builder;
+      frame.num_items++;
+      return true;
+    }
+    if (frame.field >= frame.fields->size()) return Fail("Value without key.");
+    *field = (*frame.fields)[frame.field].get();
+    *builder = frame.builders[frame.field];
+    frame.field = std::numeric_limits<size_t>::max();
+    return true;
+  }
+
+  template <typename BuilderType, typename T>
+  auto AppendInteger(const arrow::Field& field, arrow::ArrayBuilder* builder, T v)
+      -> bool {
+    using CType = typename BuilderType::value_type;
+    if constexpr (std::is_floating_point_v<T>) {
+      return Mismatch(field, "floating-point number");
+    } else {
+      if (!InRange<CType>(v)) {
+        return Fail("Value " + std::to_string(v) + " of field \"" + field.name() +
+                    "\" out of range.");
+      }
+      return Check(static_cast<BuilderType*>(builder)->Append(static_cast<CType>(v)));
+    }
+  }
+
+  template <typename T>
+  auto Number(T v) -> bool {
+    if (SkipScalar()) return true;
+    const arrow::Field* field = nullptr;
+    arrow::ArrayBuilder* builder = nullptr;
+    if (!Target(&field, &builder)) return false;
+    switch (field->type()->id()) {
+      case arrow::Type::UINT8:
+        return AppendInteger<arrow::UInt8Builder>(*field, builder, v);
+      case arrow::Type::UINT16:
+        return AppendInteger<arrow::UInt16Builder>(*field, builder, v);
+      case arrow::Type::UINT32:
+        return AppendInteger<arrow::UInt32Builder>(*field, builder, v);
+      case arrow::Type::UINT64:
+        return AppendInteger<arrow::UInt64Builder>(*field, builder, v);
+      case arrow::Type::INT8:
+        return AppendInteger<arrow::Int8Builder>(*field, builder, v);
+      case arrow::Type::INT16:
+        return AppendInteger<arrow::Int16Builder>(*field, builder, v);
+      case arrow::Type::INT32:
+        return AppendInteger<arrow::Int32Builder>(*field, builder, v);
+      case arrow::Type::INT64:
+        return AppendInteger<arrow::Int64Builder>(*field, builder, v);
+      case arrow::Type::FLOAT:
+        return Check(static_cast<arrow::FloatBuilder*>(builder)->Append(
+            static_cast<float>(v)));
+      case arrow::Type::DOUBLE:
+        return Check(static_cast<arrow::DoubleBuilder*>(builder)->Append(
+            static_cast<double>(v)));
+      default:
+        return Mismatch(*field, "number");
+    }
+  }
+
+  auto Check(const arrow::Status& status) -> bool {
+    if (!status.ok()) {
+      status_ = Status(Error::ArrowError, status.ToString());
+      return false;
+    }
+    return true;
+  }
+
+  auto Check(const Status& status) -> bool {
+    status_ = status;
+    return status.ok();
+  }
+
+  auto Fail(const std::string& msg) -> bool {
+    status_ = Status(Error::RapidJSONError, msg);
+    return false;
+  }
+
+  auto Mismatch(const arrow::Field& field, const std::string& json_type) -> bool {
+    return Fail("Field \"" + field.name() + "\" of type " + field.type()->ToString() +
+                " can't hold JSON " + json_type + ".");
+  }
+
+  std::shared_ptr<arrow::Schema> schema_;
+  bool skip_unknown_;
+  std::vector<std::unique_ptr<arrow::ArrayBuilder>> builders_;
+  std::vector<arrow::ArrayBuilder*> builder_ptrs_;
+  std::vector<Frame> stack_;
+  size_t depth_ = 0;
+  /// Number of nested objects and arrays of the skipped value being parsed.
+  size_t skip_depth_ = 0;
+  /// Whether the next value belongs to a skipped key.
+  bool skip_value_ = false;
+  int64_t num_rows_ = 0;
+  Status status_ = Status::OK();
+};
+
+RapidJSONParser::RapidJSONParser(std::shared_ptr<arrow::Schema> schema, bool seq_column,
+                                 bool skip_unknown)
+    : schema_(std::move(schema)), seq_column_(seq_column), skip_unknown_(skip_unknown) {}
+
+RapidJSONParser::~RapidJSONParser() = default;
+
+auto RapidJSONParser::Make(const std::shared_ptr<arrow::Schema>& schema, bool seq_column,
+                           std::shared_ptr<RapidJSONParser>* out, bool skip_unknown)
+    -> Status {
+  auto result = std::shared_ptr<RapidJSONParser>(
+      new RapidJSONParser(schema, seq_column, skip_unknown));
+  BOLSON_ROE(
+      SaxHandler::Make(schema, skip_unknown, result->memory_pool_, &result->handler_));
+  *out = result;
+  return Status::OK();
+}
+
+auto RapidJSONParser::set_memory_pool(arrow::MemoryPool* pool) -> Status {
+  memory_pool_ = pool;
+  return SaxHandler::Make(schema_, skip_unknown_, memory_pool_, &handler_);
+}
+
+auto RapidJSONParser::ParseBuffer(illex::JSONBuffer* in, ParsedBatch* out) -> Status {
+  const auto num_jsons = static_cast<int64_t>(in->range().last - in->range().first + 1);
+  BOLSON_ROE(handler_->Reset(num_jsons));
+
+  // Terminate the in-situ stream in the padding byte behind the buffer.
+  auto* data = reinterpret_cast<char*>(in->mutable_data());
+  data[in->size()] = '\0';
+
+  constexpr unsigned kFlags =
+      rapidjson::kParseInsituFlag | rapidjson::kParseStopWhenDoneFlag;
+  rapidjson::InsituStringStream stream(data);
+  rapidjson::Reader reader;
+  while (true) {
+    rapidjson::SkipWhitespace(stream);
+    if (stream.Peek() == '\0') break;
+    auto result = reader.Parse<kFlags>(stream, *handler_);
+    if (result.IsError()) {
+      if (!handler_->status().ok()) {
+        return handler_->status();
+      }
+      return Status(Error::RapidJSONError,
+                    std::string(rapidjson::GetParseError_En(result.Code())) +
+                        " At offset " + std::to_string(result.Offset()) + ".");
+    }
+  }
+
+  if (handler_->num_rows() != num_jsons) {
+    return Status(Error::RapidJSONError,
+                  "Parsed " + std::to_string(handler_->num_rows()) +
+                      " JSONs, but sequence range holds " + std::to_string(num_jsons) +
+                      ".");
+  }
+
+  arrow::ArrayVector columns;
+  BOLSON_ROE(handler_->Finish(&columns));
+  auto batch = arrow::RecordBatch::Make(schema_, num_jsons, columns);
+
+  // Mirror the output of the Arrow parser.
+  if (seq_column_) {
+    BOLSON_ROE(AddSeqColumn(batch, in->range(), &batch, memory_pool_));
+  } else {
+    batch = AddSeqAsSchemaMeta(batch, in->range());
+  }
+  BOLSON_ROE(ConvertTimestamps(&batch));
+
+  *out = ParsedBatch(batch, in->range());
+  return Status::OK();
+}
+
+auto RapidJSONParser::Parse(const std::vector<illex::JSONBuffer*>& buffers_in,
+                            std::vector<ParsedBatch>* batches_out) -> Status {
+  assert(batches_out != nullptr);
+  for (auto* in : buffers_in) {
+    assert(in != nullptr);
+    ParsedBatch parsed;
+    BOLSON_ROE(ParseBuffer(in, &parsed));
+    batches_out->push_back(parsed);
+  }
+  return Status::OK();
+}
+
+auto RapidJSONParserContext::Make(const ArrowOptions& opts, size_t num_parsers,
+                                  std::shared_ptr<ParserContext>* out) -> Status {
+  auto result = std::make_shared<RapidJSONParserContext>();
+
+  // Use a host memory allocator, with room for the terminator of the in-situ stream.
+  result->allocator_ = buffer::MakeHostAllocator(opts.buf_pages, opts.buf_page_aligned);
+  result->buffer_padding_ = 1;
+
+  std::shared_ptr<arrow::Schema> schema;
+  BOLSON_ROE(opts.ProjectedSchema(&schema));
+  // Dictionary-encoded fields are parsed as their values, and encoded when serialized.
+  BOLSON_ROE(DecodeDictionaries(*schema, &result->input_schema_));
+
+  // Add the sequence number field to the output schema if specified.
+  if (opts.seq_column) {
+    BOLSON_ROE(WithSeqField(*schema, &result->output_schema_));
+  } else {
+    result->output_schema_ = schema;
+  }
+  // Timestamp strings are parsed to Arrow timestamps after parsing the JSONs.
+  BOLSON_ROE(WithTimestampFields(*result->output_schema_, opts.timestamps,
+                                 &result->output_schema_));
+
+  // Every parser has its own handler and builders, so they can't be shared.
+  for (size_t p = 0; p < num_parsers; p++) {
+    std::shared_ptr<RapidJSONParser> parser;
+    BOLSON_ROE(RapidJSONParser::Make(result->input_schema_, opts.seq_column, &parser,
+                                     !opts.columns.empty()));
+    parser->set_timestamp_columns(opts.timestamps);
+    result->parsers_.push_back(parser);
+  }
+  *out = std::static_pointer_cast<ParserContext>(result);
+
+  // Allocate buffers. Use number of parsers if number of buffers is 0 in options.
+  auto num_buffers = opts.num_buffers == 0 ? num_parsers : opts.num_buffers;
+  BOLSON_ROE(result->AllocateBuffers(num_buffers, opts.buf_capacity));
+
+  return Status::OK();
+}
+
+auto RapidJSONParserContext::parsers() -> std::vector<std::shared_ptr<Parser>> {
+  return CastPtrs<Parser>(parsers_);
+}
+
+auto RapidJSONParserContext::input_schema() const -> std::shared_ptr<arrow::Schema> {
+  return input_schema_;
+}
+
+auto RapidJSONParserContext::output_schema() const -> std::shared_ptr<arrow::Schema> {
+  return output_schema_;
+}
+
+}  // namespace bolson::parse
@@ -0,0 +1,380 @@
+// Copyright 2020 Teratide B.V.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "bolson/parse/simd.h"
+
+#include <arrow/api.h>
+#include <simdjson.h>
+
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include <string_view>
+
+#include "bolson/log.h"
+#include "bolson/parse/parser.h"
+#include "bolson/parse/timestamp.h"
+
+/// Convert simdjson error code and return on error.
+#define SIMDJSON_ROE(s)                                                                \
+  {                                                                                    \
+    auto __error = (s);                                                                \
+    if (__error) return Status(Error::SimdjsonError, simdjson::error_message(__error)); \
+  }                                                                                    \
+  void()
+
+namespace bolson::parse {
+
+using simdjson::ondemand::json_type;
+
+static auto AppendValue(simdjson::ondemand::value value, const arrow::Field& field,
+                        arrow::ArrayBuilder* builder) -> Status;
+
+/// \brief Append an unsigned integer value, checking whether it fits the Arrow type.
+template <typename BuilderType>
+static auto AppendUnsigned(simdjson::ondemand::value value, arrow::ArrayBuilder* builder)
+    -> Status {
+  using CType = typename BuilderType::value_type;
+  uint64_t v = 0;
+  SIMDJSON_ROE(value.get_uint64().get(v));
+  if (v > std::numeric_limits<CType>::max()) {
+    return Status(Error::SimdjsonError, "Value " + std::to_string(v) + " out of range.");
+  }
+  ARROW_ROE(static_cast<BuilderType*>(builder)->Append(static_cast<CType>(v)));
+  return Status::OK();
+}
+
+/// \brief Append a signed integer value, checking whether it fits the Arrow type.
+template <typename BuilderType>
+static auto AppendSigned(simdjson::ondemand::value value, arrow::ArrayBuilder* builder)
+    -> Status {
+  using CType = typename BuilderType::value_type;
+  int64_t v = 0;
+  SIMDJSON_ROE(value.get_int64().get(v));
+  if ((v < std::numeric_limits<CType>::min()) ||
+      (v > std::numeric_limits<CType>::max())) {
+    return Status(Error::SimdjsonError, "Value " + std::to_string(v) + " out of range.");
+  }
+  ARROW_ROE(static_cast<BuilderType*>(builder)->Append(static_cast<CType>(v)));
+  return Status::OK();
+}
+
+/**
+ * \brief Append the fields of a JSON object to the builders of matching schema fields.
+ *
+ * Fields absent from the object are appended as nulls if the schema field is nullable.
+ * Fields absent from the schema result in an error, like Arrow's parser does, unless
+ * skip_unknown is set. Skipped values are never materialized.
+ */
+static auto AppendFields(simdjson::ondemand::object object,
+                         const arrow::FieldVector& fields,
+                         const std::vector<arrow::ArrayBuilder*>& builders,
+                         bool skip_unknown = false) -> Status {
+  if (fields.empty()) {
+    return Status::OK();
+  }
+  const auto length = builders[0]->length();
+  // Objects typically list their fields in schema order, so try the next one first.
+  size_t next = 0;
+  for (auto json_field : object) {
+    std::string_view key;
+    SIMDJSON_ROE(json_field.unescaped_key().get(key));
+    size_t f = next < fields.size() && fields[next]->name() == key ? next : fields.size();
+    if (f == fields.size()) {
+      for (f = 0; f < fields.size(); f++) {
+        if (fields[f]->name() == key) break;
+      }
+      if (f == fields.size()) {
+        if (skip_unknown) continue;
+        return Status(Error::SimdjsonError,
+                      "JSON field \"" + std::string(key) + "\" not in schema.");
+      }
+    }
+    simdjson::ondemand::value value;
+    SIMDJSON_ROE(json_field.value().get(value));
+    BOLSON_ROE(AppendValue(value, *fields[f], builders[f]));
+    next = f + 1;
+  }
+  // Fill in fields that were not present in the object.
+  for (size_t f = 0; f < fields.size(); f++) {
+    if (builders[f]->length() == length) {
+      if (!fields[f]->nullable()) {
+        return Status(Error::SimdjsonError,
+                      "Non-nullable field \"" + fields[f]->name() + "\" missing.");
+      }
+      BOLSON_ROE(AppendNull(builders[f]));
+    } else if (builders[f]->length() != length + 1) {
+      return Status(Error::SimdjsonError,
+                    "Duplicate JSON field \"" + fields[f]->name() + "\".");
+    }
+  }
+  return Status::OK();
+}
+
+/// \brief Append a list value to a list builder.
+template <typename BuilderType>
+static auto AppendList(simdjson::ondemand::value value, const arrow::Field& item_field,
+                       BuilderType* builder, int32_t fixed_size = -1) -> Status {
+  simdjson::ondemand::array array;
+  SIMDJSON_ROE(value.get_array().get(array));
+  ARROW_ROE(builder->Append());
+  int32_t num_items = 0;
+  for (auto element : array) {
+    simdjson::ondemand::value item;
+    SIMDJSON_ROE(element.get(item));
+    BOLSON_ROE(AppendValue(item, item_field, builder->value_builder()));
+    num_items++;
+  }
+  if ((fixed_size >= 0) && (num_items != fixed_size)) {
+    return Status(Error::SimdjsonError, "Expected " + std::to_string(fixed_size) +
+                                            " list items, got " +
+                                            std::to_string(num_items) + ".");
+  }
+  return Status::OK();
+}
+
+static auto AppendValue(simdjson::ondemand::value value, const arrow::Field& field,
+                        arrow::ArrayBuilder* builder) -> Status {
+  json_type type;
+  SIMDJSON_ROE(value.type().get(type));
+  if (type == json_type::null) {
+    if (!field.nullable()) {
+      return Status(Error::SimdjsonError,
+                    "Null value for non-nullable field \"" + field.name() + "\".");
+    }
+    return AppendNull(builder);
+  }
+
+  switch (field.type()->id()) {
+    case arrow::Type::BOOL: {
+      bool v = false;
+      SIMDJSON_ROE(value.get_bool().get(v));
+      ARROW_ROE(static_cast<arrow::BooleanBuilder*>(builder)->Append(v));
+      return Status::OK();
+    }
+    case arrow::Type::UINT8:
+      return AppendUnsigned<arrow::UInt8Builder>(value, builder);
+    case arrow::Type::UINT16:
+      return AppendUnsigned<arrow::UInt16Builder>(value, builder);
+    case arrow::Type::UINT32:
+      return AppendUnsigned<arrow::UInt32Builder>(value, builder);
+    case arrow::Type::UINT64:
+      return AppendUnsigned<arrow::UInt64Builder>(value, builder);
+    case arrow::Type::INT8:
+      return AppendSigned<arrow::Int8Builder>(value, builder);
+    case arrow::Type::INT16:
+      return AppendSigned<arrow::Int16Builder>(value, builder);
+    case arrow::Type::INT32:
+      return AppendSigned<arrow::Int32Builder>(value, builder);
+    case arrow::Type::INT64:
+      return AppendSigned<arrow::Int64Builder>(value, builder);
+    case arrow::Type::FLOAT: {
+      double v = 0.0;
+      SIMDJSON_ROE(value.get_double().get(v));
+      auto* float_builder = static_cast<arrow::FloatBuilder*>(builder);
+      ARROW_ROE(float_builder->Append(static_cast<float>(v)));
+      return Status::OK();
+    }
+    case arrow::Type::DOUBLE: {
+      double v = 0.0;
+      SIMDJSON_ROE(value.get_double().get(v));
+      ARROW_ROE(static_cast<arrow::DoubleBuilder*>(builder)->Append(v));
+      return Status::OK();
+    }
+    case arrow::Type::STRING: {
+      std::string_view v;
+      SIMDJSON_ROE(value.get_string().get(v));
+      ARROW_ROE(static_cast<arrow::StringBuilder*>(builder)->Append(
+          v.data(), static_cast<int32_t>(v.size())));
+      return Status::OK();
+    }
+    case arrow::Type::LIST: {
+      const auto& list_type = static_cast<const arrow::ListType&>(*field.type());
+      return AppendList(value, *list_type.value_field(),
+                        static_cast<arrow::ListBuilder*>(builder));
+    }
+    case arrow::Type::FIXED_SIZE_LIST: {
+      const auto& list_type = static_cast<const arrow::FixedSizeListType&>(*field.type());
+      return AppendList(value, *list_type.value_field(),
+                        static_cast<arrow::FixedSizeListBuilder*>(builder),
+                        list_type.list_size());
+    }
+    case arrow::Type::STRUCT: {
+      simdjson::ondemand::object object;
+      SIMDJSON_ROE(value.get_object().get(object));
+      auto* struct_builder = static_cast<arrow::StructBuilder*>(builder);
+      std::vector<arrow::ArrayBuilder*> children;
+      for (int c = 0; c < struct_builder->num_children(); c++) {
+        children.push_back(struct_builder->field_builder(c));
+      }
+      BOLSON_ROE(AppendFields(object, field.type()->fields(), children));
+      ARROW_ROE(struct_builder->Append());
+      return Status::OK();
+    }
+    default:
+      return Status(Error::SimdjsonError, "Arrow type " + field.type()->ToString() +
+                                              " of field \"" + field.name() +
+                                              "\" not supported by simdjson parser.");
+  }
+}
+
+auto SimdParser::Make(const std::shared_ptr<arrow::Schema>& schema, bool seq_column,
+                      std::shared_ptr<SimdParser>* out, bool skip_unknown) -> Status {
+  auto result =
+      std::shared_ptr<SimdParser>(new SimdParser(schema, seq_column, skip_unknown));
+  BOLSON_ROE(result->MakeBuilders());
+  *out = result;
+  return Status::OK();
+}
+
+auto SimdParser::MakeBuilders() -> Status {
+  builders_.clear();
+  builder_ptrs_.clear();
+  for (const auto& field : schema_->fields()) {
+    std::unique_ptr<arrow::ArrayBuilder> builder;
+    ARROW_ROE(arrow::MakeBuilder(memory_pool_, field->type(), &builder));
+    builder_ptrs_.push_back(builder.get());
+    builders_.push_back(std::move(builder));
+  }
+  return Status::OK();
+}
+
+auto SimdParser::set_memory_pool(arrow::MemoryPool* pool) -> Status {
+  memory_pool_ = pool;
+  return MakeBuilders();
+}
+
+auto SimdParser::ParseBuffer(const illex::JSONBuffer& in, ParsedBatch* out) -> Status {
+  const auto num_jsons = static_cast<int64_t>(in.range().last - in.range().first + 1);
+  for (auto& builder : builders_) {
+    ARROW_ROE(builder->Reserve(num_jsons));
+  }
+
+  // The whole buffer is parsed as a single batch, so documents may be as large as it is.
+  simdjson::ondemand::document_stream docs;
+  SIMDJSON_ROE(parser_
+                   .iterate_many(reinterpret_cast<const uint8_t*>(in.data()), in.size(),
+                                 std::max<size_t>(in.size(), 1))
+                   .get(docs));
+  int64_t num_rows = 0;
+  for (auto doc_result : docs) {
+    simdjson::ondemand::object object;
+    SIMDJSON_ROE(doc_result.get_object().get(object));
+    BOLSON_ROE(AppendFields(object, schema_->fields(), builder_ptrs_, skip_unknown_));
+    num_rows++;
+  }
+  if (docs.truncated_bytes() != 0) {
+    return Status(Error::SimdjsonError, "Buffer ends with an incomplete JSON.");
+  }
+  if (num_rows != num_jsons) {
+    return Status(Error::SimdjsonError,
+                  "Parsed " + std::to_string(num_rows) + " JSONs, but sequence range " +
+                      "holds " + std::to_string(num_jsons) + ".");
+  }
+
+  arrow::ArrayVector columns;
+  for (auto& builder : builders_) {
+    std::shared_ptr<arrow::Array> column;
+    ARROW_ROE(builder->Finish(&column));
+    columns.push_back(column);
+  }
+  auto batch = arrow::RecordBatch::Make(schema_, num_rows, columns);
+
+  // Mirror the output of the Arrow parser.
+  if (seq_column_) {
+    BOLSON_ROE(AddSeqColumn(batch, in.range(), &batch, memory_pool_));
+  } else {
+    batch = AddSeqAsSchemaMeta(batch, in.range());
+  }
+  BOLSON_ROE(ConvertTimestamps(&batch));
+
+  *out = ParsedBatch(batch, in.range());
+  return Status::OK();
+}
+
+auto SimdParser::Parse(const std::vector<illex::JSONBuffer*>& buffers_in,
+                       std::vector<ParsedBatch>* batches_out) -> Status {
+  assert(batches_out != nullptr);
+  for (auto* in : buffers_in) {
+    assert(in != nullptr);
+    ParsedBatch parsed;
+    auto status = ParseBuffer(*in, &parsed);
+    if (!status.ok()) {
+      // Builders may hold a partial batch, reset them for the next buffer.
+      for (auto& builder : builders_) {
+        builder->Reset();
+      }
+      SPDLOG_DEBUG("Encountered error while parsing: {}",
+                   std::string(reinterpret_cast<const char*>(in->data()), in->size()));
+      return status;
+    }
+    batches_out->push_back(parsed);
+  }
+  return Status::OK();
+}
+
+auto SimdParserContext::Make(const ArrowOptions& opts, size_t num_parsers,
+                             std::shared_ptr<ParserContext>* out) -> Status {
+  auto result = std::make_shared<SimdParserContext>();
+
+  // Use a host memory allocator, but pad the buffers for simdjson.
+  result->allocator_ = buffer::MakeHostAllocator(opts.buf_pages, opts.buf_page_aligned);
+  result->buffer_padding_ = simdjson::SIMDJSON_PADDING;
+
+  std::shared_ptr<arrow::Schema> schema;
+  BOLSON_ROE(opts.ProjectedSchema(&schema));
+  // Dictionary-encoded fields are parsed as their values, and encoded when serialized.
+  BOLSON_ROE(DecodeDictionaries(*schema, &result->input_schema_));
+
+  // Add the sequence number field to the output schema if specified.
+  if (opts.seq_column) {
+    BOLSON_ROE(WithSeqField(*schema, &result->output_schema_));
+  } else {
+    result->output_schema_ = schema;
+  }
+  // Timestamp strings are parsed to Arrow timestamps after parsing the JSONs.
+  BOLSON_ROE(WithTimestampFields(*result->output_schema_, opts.timestamps,
+                                 &result->output_schema_));
+
+  // Every parser has its own simdjson parser and builders, so they can't be shared.
+  for (size_t p = 0; p < num_parsers; p++) {
+    std::shared_ptr<SimdParser> parser;
+    BOLSON_ROE(SimdParser::Make(result->input_schema_, opts.seq_column, &parser,
+                                !opts.columns.empty()));
+    parser->set_timestamp_columns(opts.timestamps);
+    result->parsers_.push_back(parser);
+  }
+  *out = std::static_pointer_cast<ParserContext>(result);
+
+  // Allocate buffers. Use number of parsers if number of buffers is 0 in options.
+  auto num_buffers = opts.num_buffers == 0 ? num_parsers : opts.num_buffers;
+  BOLSON_ROE(result->AllocateBuffers(num_buffers, opts.buf_capacity));
+
+  return Status::OK();
+}
+
+auto SimdParserContext::parsers() -> std::vector<std::shared_ptr<Parser>> {
+  return CastPtrs<Parser>(parsers_);
+}
+
+auto SimdParserContext::input_schema() const -> std::shared_ptr<arrow::Schema> {
+  return input_schema_;
+}
+
+auto SimdParserContext::output_schema() const -> std::shared_ptr<arrow::Schema> {
+  return output_schema_;
+}
+
+}  // namespace bolson::parse
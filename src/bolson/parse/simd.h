@@ -0,0 +1,98 @@
+// Copyright 2020 Teratide B.V.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#pragma once
+
+#include <arrow/api.h>
+#include <simdjson.h>
+
+#include <memory>
+#include <vector>
+
+#include "bolson/parse/arrow.h"
+#include "bolson/parse/parser.h"
+#include "bolson/status.h"
+
+namespace bolson::parse {
+
+/**
+ * \brief Parser implementation using the simdjson On Demand API.
+ *
+ * Walks the explicit Arrow schema for every JSON object and appends the values directly
+ * to Arrow builders, which are reused across buffers.
+ */
+class SimdParser : public Parser {
+ public:
+  /**
+   * \brief Make a new simdjson parser.
+   * \param schema      The explicit Arrow schema of the JSON objects.
+   * \param seq_column  Whether to store sequence numbers as a column.
+   * \param out         The resulting parser.
+   * \param skip_unknown Whether to skip top-level JSON fields absent from the schema,
+   *                     rather than failing on them.
+   * \return Status::OK() if successful, some error otherwise.
+   */
+  static auto Make(const std::shared_ptr<arrow::Schema>& schema, bool seq_column,
+                   std::shared_ptr<SimdParser>* out, bool skip_unknown = false)
+      -> Status;
+
+  auto Parse(const std::vector<illex::JSONBuffer*>& buffers_in,
+             std::vector<ParsedBatch>* batches_out) -> Status override;
+
+  /// \brief Set the memory pool, rebuilding the builders from it.
+  auto set_memory_pool(arrow::MemoryPool* pool) -> Status override;
+
+ private:
+  SimdParser(std::shared_ptr<arrow::Schema> schema, bool seq_column, bool skip_unknown)
+      : schema_(std::move(schema)),
+        seq_column_(seq_column),
+        skip_unknown_(skip_unknown) {}
+
+  auto ParseBuffer(const illex::JSONBuffer& in, ParsedBatch* out) -> Status;
+
+  /// \brief Make a builder for every field, allocating from the memory pool.
+  auto MakeBuilders() -> Status;
+
+  std::shared_ptr<arrow::Schema> schema_;
+  bool seq_column_;
+  bool skip_unknown_;
+  simdjson::ondemand::parser parser_;
+  std::vector<std::unique_ptr<arrow::ArrayBuilder>> builders_;
+  std::vector<arrow::ArrayBuilder*> builder_ptrs_;
+};
+
+/**
+ * \brief Context for simdjson parsers.
+ *
+ * Uses the Arrow parser options. Input buffers are padded with SIMDJSON_PADDING bytes,
+ * so buffers not allocated by this context are not accepted.
+ */
+class SimdParserContext : public ParserContext {
+ public:
+  static auto Make(const ArrowOptions& opts, size_t num_parsers,
+                   std::shared_ptr<ParserContext>* out) -> Status;
+
+  auto parsers() -> std::vector<std::shared_ptr<Parser>> override;
+
+  [[nodiscard]] auto input_schema() const -> std::shared_ptr<arrow::Schema> override;
+  [[nodiscard]] auto output_schema() const -> std::shared_ptr<arrow::Schema> override;
+
+ private:
+  std::shared_ptr<arrow::Schema> input_schema_;
+  std::shared_ptr<arrow::Schema> output_schema_;
+  std::vector<std::shared_ptr<SimdParser>> parsers_;
+};
+
+}  // namespace bolson::parse
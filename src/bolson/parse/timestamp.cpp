@@ -0,0 +1,176 @@
+// Copyright 2020 Teratide B.V.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "bolson/parse/timestamp.h"
+
+#include <arrow/util/bitmap_ops.h>
+
+namespace bolson::parse {
+
+auto TimestampType() -> std::shared_ptr<arrow::DataType> {
+  static auto result = arrow::timestamp(arrow::TimeUnit::NANO, "UTC");
+  return result;
+}
+
+/// \brief Parse two decimal digits, without branches.
+static inline auto ParseDigits2(const char* str, uint32_t* out) -> bool {
+  auto hi = static_cast<uint32_t>(static_cast<unsigned char>(str[0]) - '0');
+  auto lo = static_cast<uint32_t>(static_cast<unsigned char>(str[1]) - '0');
+  *out = hi * 10 + lo;
+  return (hi < 10) & (lo < 10);
+}
+
+/// \brief Return the number of days since the epoch of a date in the Gregorian calendar.
+static inline auto DaysFromCivil(int64_t y, uint32_t m, uint32_t d) -> int64_t {
+  y -= static_cast<int64_t>(m <= 2);
+  const int64_t era = (y >= 0 ? y : y - 399) / 400;
+  const auto yoe = static_cast<uint32_t>(y - era * 400);
+  const uint32_t doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+  const uint32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  return era * 146097 + static_cast<int64_t>(doe) - 719468;
+}
+
+static inline auto DaysInMonth(uint32_t y, uint32_t m) -> uint32_t {
+  static constexpr uint8_t days[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+  const bool leap = ((y % 4 == 0) && (y % 100 != 0)) || (y % 400 == 0);
+  return days[m - 1] + static_cast<uint32_t>(leap && (m == 2));
+}
+
+auto ParseISO8601(std::string_view str, int64_t* out) -> bool {
+  // Date and time are at fixed positions: YYYY-MM-DDThh:mm:ss
+  if (str.size() < 19) return false;
+  const char* s = str.data();
+  uint32_t yh = 0, yl = 0, mon = 0, day = 0, hour = 0, min = 0, sec = 0;
+  bool ok = ParseDigits2(s, &yh) & ParseDigits2(s + 2, &yl) & ParseDigits2(s + 5, &mon) &
+            ParseDigits2(s + 8, &day) & ParseDigits2(s + 11, &hour) &
+            ParseDigits2(s + 14, &min) & ParseDigits2(s + 17, &sec);
+  ok &= (s[4] == '-') & (s[7] == '-') & ((s[10] == 'T') | (s[10] == ' ')) &
+        (s[13] == ':') & (s[16] == ':');
+  if (!ok) return false;
+  const uint32_t year = yh * 100 + yl;
+  if ((mon < 1) || (mon > 12) || (day < 1) || (day > DaysInMonth(year, mon)) ||
+      (hour > 23) || (min > 59) || (sec > 59)) {
+    return false;
+  }
+
+  size_t pos = 19;
+  // Optional fraction of a second, up to nanoseconds.
+  int64_t nanos = 0;
+  if ((pos < str.size()) && (s[pos] == '.')) {
+    pos++;
+    size_t digits = 0;
+    while ((pos < str.size()) && (s[pos] >= '0') && (s[pos] <= '9')) {
+      if (++digits > 9) return false;
+      nanos = nanos * 10 + (s[pos] - '0');
+      pos++;
+    }
+    if (digits == 0) return false;
+    for (; digits < 9; digits++) nanos *= 10;
+  }
+
+  // Optional UTC offset.
+  int64_t offset = 0;
+  if (pos < str.size()) {
+    if (s[pos] == 'Z') {
+      pos++;
+    } else if ((s[pos] == '+') || (s[pos] == '-')) {
+      const int64_t sign = s[pos] == '-' ? -1 : 1;
+      pos++;
+      uint32_t off_hour = 0, off_min = 0;
+      if ((str.size() - pos < 2) || !ParseDigits2(s + pos, &off_hour)) return false;
+      pos += 2;
+      if ((pos < str.size()) && (s[pos] == ':')) pos++;
+      if ((str.size() - pos < 2) || !ParseDigits2(s + pos, &off_min)) return false;
+      pos += 2;
+      if ((off_hour > 23) || (off_min > 59)) return false;
+      offset = sign * (off_hour * 3600 + off_min * 60);
+    }
+  }
+  if (pos != str.size()) return false;
+
+  const int64_t days = DaysFromCivil(year, mon, day);
+  const int64_t seconds = days * 86400 + hour * 3600 + min * 60 + sec - offset;
+  *out = seconds * 1000000000 + nanos;
+  return true;
+}
+
+auto ParseTimestamps(const arrow::StringArray& strings, arrow::MemoryPool* pool,
+                     std::shared_ptr<arrow::Array>* out) -> Status {
+  const int64_t length = strings.length();
+  auto values_result = arrow::AllocateBuffer(length * sizeof(int64_t), pool);
+  if (!values_result.ok()) {
+    return Status(Error::ArrowError, values_result.status().message());
+  }
+  std::shared_ptr<arrow::Buffer> values = std::move(values_result).ValueOrDie();
+  auto* raw = reinterpret_cast<int64_t*>(values->mutable_data());
+
+  // Scan the string data in a single pass, writing the timestamps in place.
+  const bool has_nulls = strings.null_count() > 0;
+  for (int64_t i = 0; i < length; i++) {
+    if (has_nulls && strings.IsNull(i)) {
+      raw[i] = 0;
+      continue;
+    }
+    auto str = strings.GetView(i);
+    if (!ParseISO8601(std::string_view(str.data(), str.size()), &raw[i])) {
+      return Status(Error::GenericError, "Unable to parse \"" +
+                                             std::string(str.data(), str.size()) +
+                                             "\" as ISO-8601 timestamp.");
+    }
+  }
+
+  std::shared_ptr<arrow::Buffer> validity;
+  if (has_nulls) {
+    auto validity_result = arrow::internal::CopyBitmap(pool, strings.null_bitmap_data(),
+                                                       strings.offset(), length);
+    if (!validity_result.ok()) {
+      return Status(Error::ArrowError, validity_result.status().message());
+    }
+    validity = validity_result.ValueOrDie();
+  }
+
+  *out = std::make_shared<arrow::TimestampArray>(TimestampType(), length, values,
+                                                 validity, strings.null_count());
+  return Status::OK();
+}
+
+auto WithTimestampFields(const arrow::Schema& schema,
+                         const std::vector<std::string>& columns,
+                         std::shared_ptr<arrow::Schema>* out) -> Status {
+  auto result = std::make_shared<arrow::Schema>(schema);
+  for (const auto& column : columns) {
+    auto index = result->GetFieldIndex(column);
+    if (index < 0) {
+      return Status(Error::GenericError, "Timestamp column \"" + column +
+                                             "\" is not a unique field of schema: " +
+                                             schema.ToString());
+    }
+    auto field = result->field(index);
+    if (field->type()->id() != arrow::Type::STRING) {
+      return Status(Error::GenericError, "Timestamp column \"" + column +
+                                             "\" is of type " +
+                                             field->type()->ToString() +
+                                             ", expected utf8.");
+    }
+    auto set_result = result->SetField(index, field->WithType(TimestampType()));
+    if (!set_result.ok()) {
+      return Status(Error::ArrowError, set_result.status().message());
+    }
+    result = set_result.ValueOrDie();
+  }
+  *out = result;
+  return Status::OK();
+}
+
+}  // namespace bolson::parse
@@ -0,0 +1,64 @@
+// Copyright 2020 Teratide B.V.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <arrow/api.h>
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "bolson/status.h"
+
+namespace bolson::parse {
+
+/// \brief Return the Arrow type of parsed timestamps: nanoseconds since the epoch, UTC.
+auto TimestampType() -> std::shared_ptr<arrow::DataType>;
+
+/**
+ * \brief Parse an ISO-8601 timestamp.
+ *
+ * Accepts timestamps of the form YYYY-MM-DD[T ]hh:mm:ss[.fffffffff][Z|(+|-)hh[:]mm].
+ * Timestamps without a UTC offset are taken to be in UTC.
+ *
+ * \param str The timestamp string.
+ * \param out Nanoseconds since the Unix epoch.
+ * \return True if str is a valid timestamp, false otherwise.
+ */
+auto ParseISO8601(std::string_view str, int64_t* out) -> bool;
+
+/**
+ * \brief Parse an array of ISO-8601 timestamp strings to an array of TimestampType().
+ * \param strings The timestamp strings.
+ * \param pool    The memory pool to allocate the timestamps from.
+ * \param out     The timestamps.
+ * \return Status::OK() if successful, some error otherwise.
+ */
+auto ParseTimestamps(const arrow::StringArray& strings, arrow::MemoryPool* pool,
+                     std::shared_ptr<arrow::Array>* out) -> Status;
+
+/**
+ * \brief Return a schema with string fields converted to timestamp fields.
+ * \param schema  The schema.
+ * \param columns Names of the top-level utf8 fields to convert.
+ * \param out     The schema with the fields of TimestampType().
+ * \return Status::OK() if successful, some error otherwise.
+ */
+auto WithTimestampFields(const arrow::Schema& schema,
+                         const std::vector<std::string>& columns,
+                         std::shared_ptr<arrow::Schema>* out) -> Status;
+
+}  // namespace bolson::parse
@@ -0,0 +1,126 @@
+// Copyright 2020 Teratide B.V.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "bolson/parse/wait.h"
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+namespace bolson::parse {
+
+auto ToString(WaitStrategy strategy) -> std::string {
+  switch (strategy) {
+    case WaitStrategy::SLEEP:
+      return "Sleep";
+    case WaitStrategy::SPIN:
+      return "Spin";
+    case WaitStrategy::YIELD:
+      return "Spin, then yield";
+    case WaitStrategy::BACKOFF:
+      return "Exponential backoff";
+  }
+  return "Corrupt bolson::parse::WaitStrategy enum value.";
+}
+
+void AddWaitOptionsToCLI(CLI::App* sub, WaitOptions* out) {
+  sub->add_option("--opae-wait", out->strategy,
+                  "Strategy to wait for OPAE kernels. \"sleep\" polls at a fixed "
+                  "interval, \"spin\" polls continuously, \"yield\" spins and then "
+                  "yields between polls, \"backoff\" sleeps for the expected kernel time "
+                  "and then backs off exponentially.")
+      ->transform(CLI::CheckedTransformer(
+          std::map<std::string, WaitStrategy>{{"sleep", WaitStrategy::SLEEP},
+                                              {"spin", WaitStrategy::SPIN},
+                                              {"yield", WaitStrategy::YIELD},
+                                              {"backoff", WaitStrategy::BACKOFF}},
+          CLI::ignore_case))
+      ->default_val(WaitStrategy::SLEEP);
+  sub->add_option("--opae-wait-interval-us", out->interval_us,
+                  "Poll interval of the sleep strategy, and maximum backoff interval, "
+                  "in microseconds.")
+      ->default_val(BOLSON_QUEUE_WAIT_US);
+  sub->add_option("--opae-wait-spin-polls", out->spin_polls,
+                  "Number of polls the yield strategy spins before yielding.")
+      ->default_val(BOLSON_DEFAULT_WAIT_SPIN_POLLS);
+  sub->add_option("--opae-wait-throughput", out->throughput,
+                  "Initial estimate of the kernel throughput in MB/s, used by the "
+                  "backoff strategy to derive the expected kernel time.")
+      ->check(CLI::PositiveNumber)
+      ->default_val(BOLSON_DEFAULT_WAIT_THROUGHPUT);
+}
+
+auto WaitMetrics::operator+=(const WaitMetrics& r) -> WaitMetrics& {
+  num_waits += r.num_waits;
+  num_polls += r.num_polls;
+  time += r.time;
+  return *this;
+}
+
+Waiter::Waiter(const WaitOptions& opts)
+    : opts_(opts), bytes_per_us_(opts.throughput) {}  // MB/s equals B/us.
+
+auto Waiter::Wait(const PollFunc& poll, size_t bytes) -> Status {
+  using us = std::chrono::duration<double, std::micro>;
+  const auto start = std::chrono::steady_clock::now();
+  // Time of the last poll that found the device busy.
+  auto busy = start;
+  const us max_backoff(std::max<size_t>(opts_.interval_us, 1));
+  us backoff(1);
+  size_t polls = 0;
+
+  if (opts_.strategy == WaitStrategy::BACKOFF) {
+    std::this_thread::sleep_for(us(static_cast<double>(bytes) / bytes_per_us_));
+  }
+
+  bool done = false;
+  while (true) {
+    BOLSON_ROE(poll(&done));
+    polls++;
+    if (done) break;
+    busy = std::chrono::steady_clock::now();
+    switch (opts_.strategy) {
+      case WaitStrategy::SLEEP:
+        std::this_thread::sleep_for(us(opts_.interval_us));
+        break;
+      case WaitStrategy::SPIN:
+        break;
+      case WaitStrategy::YIELD:
+        if (polls > opts_.spin_polls) {
+          std::this_thread::yield();
+        }
+        break;
+      case WaitStrategy::BACKOFF:
+        std::this_thread::sleep_for(backoff);
+        backoff = std::min(backoff * 2, max_backoff);
+        break;
+    }
+  }
+  const auto end = std::chrono::steady_clock::now();
+
+  // The run completed somewhere between the last busy poll and the final poll.
+  if ((opts_.strategy == WaitStrategy::BACKOFF) && (bytes > 0)) {
+    us run_time = (busy - start) + (end - busy) / 2;
+    if (run_time.count() > 0) {
+      bytes_per_us_ = (bytes_per_us_ + static_cast<double>(bytes) / run_time.count()) / 2;
+    }
+  }
+
+  metrics_.num_waits++;
+  metrics_.num_polls += polls;
+  metrics_.time += std::chrono::duration<double>(end - start).count();
+  return Status::OK();
+}
+
+}  // namespace bolson::parse
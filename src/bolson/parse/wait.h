@@ -0,0 +1,102 @@
+// Copyright 2020 Teratide B.V.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <CLI/CLI.hpp>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+#include "bolson/latency.h"
+#include "bolson/status.h"
+
+/// Default number of polls the yield strategy spins before yielding.
+#define BOLSON_DEFAULT_WAIT_SPIN_POLLS 1024
+/// Default initial estimate of device throughput in MB/s for the backoff strategy.
+#define BOLSON_DEFAULT_WAIT_THROUGHPUT 1000.0
+
+namespace bolson::parse {
+
+/// Strategies to wait for a device to complete a run.
+enum class WaitStrategy {
+  SLEEP,   ///< Sleep a fixed interval between polls.
+  SPIN,    ///< Poll continuously.
+  YIELD,   ///< Spin for a number of polls, then yield the thread between polls.
+  BACKOFF  ///< Sleep for the expected run time, then poll with exponential backoff.
+};
+
+/// \brief Return human-readable WaitStrategy enum.
+auto ToString(WaitStrategy strategy) -> std::string;
+
+/// Options for waiting on devices.
+struct WaitOptions {
+  /// The strategy to wait with.
+  WaitStrategy strategy = WaitStrategy::SLEEP;
+  /// Sleep interval of the sleep strategy, and maximum backoff, in microseconds.
+  size_t interval_us = BOLSON_QUEUE_WAIT_US;
+  /// Number of polls the yield strategy spins before yielding.
+  size_t spin_polls = BOLSON_DEFAULT_WAIT_SPIN_POLLS;
+  /// Initial estimate of the device throughput in MB/s, refined after every run.
+  double throughput = BOLSON_DEFAULT_WAIT_THROUGHPUT;
+};
+
+/// \brief Options exposed to CLI.
+void AddWaitOptionsToCLI(CLI::App* sub, WaitOptions* out);
+
+/// Statistics of waiting on a device.
+struct WaitMetrics {
+  /// Number of runs waited on.
+  size_t num_waits = 0;
+  /// Number of times the device was polled.
+  size_t num_polls = 0;
+  /// Total time spent waiting in seconds.
+  double time = 0.0;
+
+  auto operator+=(const WaitMetrics& r) -> WaitMetrics&;
+};
+
+/**
+ * \brief Waits for a device to complete runs, according to some strategy.
+ *
+ * The backoff strategy estimates when a run completes from the number of bytes submitted
+ * and the device throughput observed in earlier runs. It sleeps until then, and polls
+ * with exponentially increasing intervals after.
+ */
+class Waiter {
+ public:
+  /// A function that polls the device, setting done when the run has completed.
+  using PollFunc = std::function<Status(bool* done)>;
+
+  explicit Waiter(const WaitOptions& opts = WaitOptions());
+
+  /**
+   * \brief Wait for a run to complete.
+   * \param poll  The function to poll the device with.
+   * \param bytes The number of bytes submitted to the device for the run.
+   * \return Status::OK() if successful, the first failing poll status otherwise.
+   */
+  auto Wait(const PollFunc& poll, size_t bytes) -> Status;
+
+  /// \brief Return the statistics of all waits.
+  [[nodiscard]] auto metrics() const -> WaitMetrics { return metrics_; }
+
+ private:
+  WaitOptions opts_;
+  /// Estimate of the device throughput in bytes per microsecond.
+  double bytes_per_us_;
+  WaitMetrics metrics_;
+};
+
+}  // namespace bolson::parse
@@ -102,7 +102,10 @@ auto ConcurrentPublisher::Make(const Options& opts, IpcQueue* ipc_queue,
 
     // Attempt to read the schema from the message.
     auto arrow_reader = arrow::io::BufferReader(message_buffer);
-    arrow::ipc::DictionaryMemo arrow_dict;  // is ignored for now.
+    // Dictionary ids are assigned in the order of the dictionary-encoded fields, which
+    // Equals() below compares including their index and value types. A matching schema
+    // therefore also matches the ids of the dictionary batches the serializers write.
+    arrow::ipc::DictionaryMemo arrow_dict;
 
     // Attempt to read a schema from the message.
     auto read_schema_result = arrow::ipc::ReadSchema(&arrow_reader, &arrow_dict);
@@ -147,13 +150,17 @@ auto ConcurrentPublisher::Make(const Options& opts, IpcQueue* ipc_queue,
   return Status::OK();
 }
 
-void ConcurrentPublisher::Start(std::atomic<bool>* shutdown) {
+void ConcurrentPublisher::Start(std::atomic<bool>* shutdown, const Topology* topology) {
   shutdown_ = shutdown;
-  for (auto& producer : producers) {
+  for (size_t p = 0; p < producers.size(); p++) {
     std::promise<Metrics> s;
     metrics_futures.push_back(s.get_future());
-    threads.emplace_back(PublishThread, producer.get(), queue_, shutdown_, published_,
-                         std::move(s));
+    threads.emplace_back(PublishThread, producers[p].get(), queue_, shutdown_,
+                         published_, std::move(s));
+    if (topology != nullptr) {
+      const auto& node = topology->nodes[topology->node(p)];
+      WarnOnPlacementFailure(PinThread(&threads.back(), node));
+    }
   }
 }
 
@@ -206,6 +213,12 @@ void PublishThread(pulsar::Producer* producer, IpcQueue* queue,
   while (!shutdown->load()) {
     if (queue->wait_dequeue_timed(ipc_item,
                                   std::chrono::microseconds(BOLSON_QUEUE_WAIT_US))) {
+      // Records discarded by a filter are done without publishing anything.
+      if (ipc_item.message == nullptr) {
+        count->fetch_add(RecordSizeOf(ipc_item));
+        continue;
+      }
+
       // Start measuring time to handle an IPC message on the Pulsar side.
       publish_timer.Start();
 
@@ -234,7 +247,7 @@ void PublishThread(pulsar::Producer* producer, IpcQueue* queue,
 
       // Update some statistics.
       s.ipc++;
-      s.rows += RecordSizeOf(ipc_item);
+      s.rows += static_cast<size_t>(ipc_item.num_rows);
       publish_timer.Stop();
       s.publish_time += publish_timer.seconds();
       // Dump the latency stats.
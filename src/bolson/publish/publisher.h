@@ -28,6 +28,7 @@
 
 #include "bolson/convert/serializer.h"
 #include "bolson/log.h"
+#include "bolson/numa.h"
 #include "bolson/publish/metrics.h"
 #include "bolson/status.h"
 
@@ -119,8 +120,9 @@ struct ConcurrentPublisher {
   /**
    * \brief Start Pulsar producer threads.
    * \param[in] shutdown Shutdown signal.
+   * \param[in] topology If not nullptr, pin the threads to its nodes round-robin.
    */
-  void Start(std::atomic<bool>* shutdown);
+  void Start(std::atomic<bool>* shutdown, const Topology* topology = nullptr);
 
   /**
    * \brief Finish producing, shutting down all threads and closing client and producers.
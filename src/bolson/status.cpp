@@ -49,6 +49,10 @@ auto ToString(Error e) -> std::string {
       return "IOError";
     case Error::OpaeError:
       return "OpaeError";
+    case Error::SimdjsonError:
+      return "SimdjsonError";
+    case Error::RapidJSONError:
+      return "RapidJSONError";
   }
   return "Error enum value corrupted.";
 }
@@ -17,9 +17,12 @@
 #include <putong/timer.h>
 
 #include <memory>
+#include <string>
 #include <thread>
 #include <vector>
 
+#include "bolson/client/client.h"
+#include "bolson/client/file.h"
 #include "bolson/latency.h"
 #include "bolson/metrics.h"
 #include "bolson/publish/publisher.h"
@@ -50,9 +53,26 @@ struct StreamThreads {
   }
 };
 
+/// \brief Return the endpoints to connect to, if the input is not a file.
+static auto Endpoints(const StreamOptions& opt) -> std::vector<illex::ClientOptions> {
+  return opt.endpoints.empty() ? std::vector{opt.client} : opt.endpoints;
+}
+
+/// \brief Return a human-readable description of the input source.
+static auto InputSource(const StreamOptions& opt) -> std::string {
+  if (!opt.input_file.empty()) {
+    return opt.input_file;
+  }
+  std::string result;
+  for (const auto& e : Endpoints(opt)) {
+    result += (result.empty() ? "" : ", ") + e.host + ":" + std::to_string(e.port);
+  }
+  return result;
+}
+
 /// \brief Log the statistics.
 static auto LogStreamMetrics(const StreamOptions& opt, const StreamTimers& timers,
-                             const illex::BufferingClient& client,
+                             const client::Clients& clients,
                              const convert::Converter& converter,
                              const publish::ConcurrentPublisher& publisher) -> Status {
   // Report some statistics.
@@ -62,25 +82,55 @@ static auto LogStreamMetrics(const StreamOptions& opt, const StreamTimers& timer
     } else {
       auto c = Aggregate(converter.metrics());
       auto p = Aggregate(publisher.metrics());
+      const bool tcp = opt.input_file.empty();
 
       spdlog::info("Initialization");
       spdlog::info("  Time                    : {}", timers.init.seconds());
       spdlog::info("  Conversion impl.        : {}", ToString(opt.converter.parser.impl));
       spdlog::info("  Conversion threads      : {}", opt.converter.num_threads);
-      spdlog::info("  TCP clients             : {}", 1);
+      spdlog::info("  Buffer handoff          : {}", ToString(converter.handoff()));
+      spdlog::info("  Input source            : {}", InputSource(opt));
+      if (tcp) {
+        spdlog::info("  TCP connections         : {}", opt.connections);
+        spdlog::info("  Receive engine          : {}", ToString(opt.engine));
+        spdlog::info("  Max. buffer delay       : {} us", opt.max_buffer_delay_us);
+      }
+      spdlog::info("  Input compression       : {}", ToString(opt.compression));
+      for (const auto& f : opt.converter.filter) {
+        spdlog::info("  Filter                  : {}", f);
+      }
+      spdlog::info("  Placement               : {}", ToString(opt.converter.placement));
+      if (converter.topology() != nullptr) {
+        spdlog::info("  Topology                : {}", converter.topology()->ToString());
+      }
       opt.pulsar.Log();
 
-      // TCP client statistics.
-      auto tcp_MiB = static_cast<double>(client.bytes_received()) / (1024.0 * 1024.0);
-      auto tcp_MB = static_cast<double>(client.bytes_received()) / 1E6;
-      auto tcp_MJs = client.jsons_received() / 1E6;
+      // Client statistics.
+      auto recv_bytes = client::BytesReceived(clients);
+      auto recv_jsons = client::JSONsReceived(clients);
+      auto recv_MiB = static_cast<double>(recv_bytes) / (1024.0 * 1024.0);
+      auto recv_MB = static_cast<double>(recv_bytes) / 1E6;
+      auto recv_MJs = recv_jsons / 1E6;
 
-      spdlog::info("TCP client:");
-      spdlog::info("  JSONs received          : {}", client.jsons_received());
-      spdlog::info("  Bytes received          : {} MiB", tcp_MiB);
+      spdlog::info(tcp ? "TCP client(s):" : "File client:");
+      spdlog::info("  JSONs received          : {}", recv_jsons);
+      spdlog::info("  Bytes received          : {} MiB", recv_MiB);
       spdlog::info("  Time                    : {} s", timers.tcp.seconds());
-      spdlog::info("  Throughput              : {} MJ/s", tcp_MJs / timers.tcp.seconds());
-      spdlog::info("  Throughput              : {} MB/s", tcp_MB / timers.tcp.seconds());
+      spdlog::info("  Throughput              : {} MJ/s",
+                   recv_MJs / timers.tcp.seconds());
+      spdlog::info("  Throughput              : {} MB/s", recv_MB / timers.tcp.seconds());
+      if (opt.compression != client::Compression::NONE) {
+        auto d = client::DecompressMetricsOf(clients);
+        auto ratio = d.compressed_bytes > 0 ? static_cast<double>(d.decompressed_bytes) /
+                                                  static_cast<double>(d.compressed_bytes)
+                                            : 0.0;
+        spdlog::info("  Compressed bytes        : {} MiB",
+                     static_cast<double>(d.compressed_bytes) / (1024.0 * 1024.0));
+        spdlog::info("  Decompressed bytes      : {} MiB",
+                     static_cast<double>(d.decompressed_bytes) / (1024.0 * 1024.0));
+        spdlog::info("  Compression ratio       : {}", ratio);
+        spdlog::info("  Decompression time      : {} s", d.seconds);
+      }
 
       spdlog::info("JSONs to IPC conversion:");
       LogConvertMetrics(c, "  ");
@@ -124,7 +174,7 @@ auto ProduceFromStream(const StreamOptions& opt) -> Status {
   publish::IpcQueue ipc_queue(
       BOLSON_PUBLISH_IPC_QUEUE_SIZE);  // IPC queue to Pulsar producer.
 
-  illex::BufferingClient client;                            // TCP client.
+  client::Clients clients;                                  // TCP clients.
   std::shared_ptr<convert::Converter> converter;            // Converters.
   std::shared_ptr<publish::ConcurrentPublisher> publisher;  // Pulsar producers.
 
@@ -140,39 +190,57 @@ auto ProduceFromStream(const StreamOptions& opt) -> Status {
   BOLSON_ROE(publish::ConcurrentPublisher::Make(pulsar_options, &ipc_queue,
                                                 &threads.publish_count, &publisher));
 
-  spdlog::info("Initializing stream source client...");
-  BILLEX_ROE(illex::BufferingClient::Create(
-      opt.client, converter->parser_context()->mutable_buffers(),
-      converter->parser_context()->mutexes(), &client));
+  std::atomic<uint64_t> seq = 0;
+  if (!opt.input_file.empty()) {
+    spdlog::info("Initializing file source {}...", opt.input_file);
+    std::shared_ptr<client::Client> file;
+    BOLSON_ROE(client::FileClient::Make(opt.input_file, converter->handoff(),
+                                        converter->parser_context().get(), &file,
+                                        opt.compression));
+    clients.push_back(file);
+  } else {
+    // Distribute the connections round-robin over the endpoints.
+    auto endpoints = Endpoints(opt);
+    std::vector<illex::ClientOptions> connections;
+    for (size_t c = 0; c < opt.connections; c++) {
+      connections.push_back(endpoints[c % endpoints.size()]);
+    }
+    spdlog::info("Initializing {} stream source client(s) to {} endpoint(s)...",
+                 opt.connections, endpoints.size());
+    BOLSON_ROE(client::MakeClients(
+        connections, opt.engine, converter->handoff(),
+        std::chrono::microseconds(opt.max_buffer_delay_us),
+        converter->parser_context().get(), &seq, &clients, opt.compression));
+  }
   timers.init.Stop();
 
   spdlog::info("Starting JSON-to-Arrow converter thread(s)...");
   converter->Start(&threads.shutdown);
 
   spdlog::info("Starting Pulsar publish thread(s)...");
-  publisher->Start(&threads.shutdown);
+  publisher->Start(&threads.shutdown, converter->topology());
 
   spdlog::info("Receiving, converting, and publishing JSONs...");
-  // Receive JSONs (blocking) until the server closes the connection.
+  // Receive JSONs (blocking) until all servers close the connections.
   // Concurrently, the conversion and publish thread will do their job.
   timers.tcp.Start();
-  SHUTDOWN_ON_FAILURE(client.ReceiveJSONs());
+  SHUTDOWN_ON_FAILURE(client::ReceiveJSONs(clients, converter->topology()));
   timers.tcp.Stop();
-  SHUTDOWN_ON_FAILURE(client.Close());
 
-  spdlog::info("Source server disconnected, emptying buffers...");
+  spdlog::info("Source server(s) disconnected, emptying buffers...");
 
   // Once the server disconnects, we can work towards finishing this function.
   // Wait until all JSONs have been published, or if either the publish or converter
   // thread have asserted the shutdown signal, the latter indicating some error.
-  while ((client.jsons_received() != threads.publish_count.load()) &&
+  const auto jsons_received = client::JSONsReceived(clients);
+  while ((jsons_received != threads.publish_count.load()) &&
          !threads.shutdown.load()) {
     // Sleep this thread for a bit.
     std::this_thread::sleep_for(std::chrono::milliseconds(BOLSON_QUEUE_WAIT_US));
 #ifndef NDEBUG
     // Sleep a bit longer in debug.
     std::this_thread::sleep_for(std::chrono::milliseconds(100 * BOLSON_QUEUE_WAIT_US));
-    SPDLOG_DEBUG("Received: {}, Published: {}", client.jsons_received(),
+    SPDLOG_DEBUG("Received: {}, Published: {}", jsons_received,
                  threads.publish_count.load());
 #endif
   }
@@ -182,7 +250,7 @@ auto ProduceFromStream(const StreamOptions& opt) -> Status {
   BOLSON_ROE(threads.Shutdown(converter, publisher));
   spdlog::info("----------------------------------------------------------------");
 
-  BOLSON_ROE(LogStreamMetrics(opt, timers, client, *converter, *publisher));
+  BOLSON_ROE(LogStreamMetrics(opt, timers, clients, *converter, *publisher));
 
   return Status::OK();
 }
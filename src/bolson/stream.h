@@ -20,7 +20,9 @@
 
 #include <utility>
 #include <variant>
+#include <vector>
 
+#include "bolson/client/client.h"
 #include "bolson/convert/converter.h"
 #include "bolson/latency.h"
 #include "bolson/publish/publisher.h"
@@ -31,6 +33,18 @@ namespace bolson {
 struct StreamOptions {
   /// The client options.
   illex::ClientOptions client;
+  /// All endpoints to connect to, starting with the one in the client options.
+  std::vector<illex::ClientOptions> endpoints;
+  /// Number of TCP connections, distributed round-robin over all endpoints.
+  size_t connections = 1;
+  /// The receive engine.
+  client::Engine engine = client::Engine::POSIX;
+  /// Maximum time in microseconds the oldest JSON in a buffer waits to be converted.
+  size_t max_buffer_delay_us = 0;
+  /// The compression of the input streams or file.
+  client::Compression compression = client::Compression::NONE;
+  /// Newline-delimited JSON file to replay instead of connecting to a TCP server.
+  std::string input_file;
   /// The Pulsar options.
   publish::Options pulsar;
   /// Enable statistics.
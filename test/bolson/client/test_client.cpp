@@ -0,0 +1,186 @@
+// Copyright 2020 Teratide B.V.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <arpa/inet.h>
+#include <gtest/gtest.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bolson/client/file.h"
+#include "bolson/client/tcp.h"
+#include "bolson/parse/arrow.h"
+
+namespace bolson::client {
+
+#define FAIL_ON_ERROR(status)   \
+  {                             \
+    auto __status = (status);   \
+    if (!__status.ok()) {       \
+      FAIL() << __status.msg(); \
+    }                           \
+  }
+
+/// A batch parsed from a buffer handed over by a client.
+struct Handed {
+  illex::SeqRange range;
+  int64_t rows;
+};
+
+/// \brief Make an Arrow parser context for JSONs with a single "id" field.
+static auto MakeContext(size_t num_buffers, size_t capacity,
+                        std::shared_ptr<parse::ParserContext>* out) -> Status {
+  parse::ArrowOptions opts;
+  opts.schema = arrow::schema({arrow::field("id", arrow::uint64(), false)});
+  opts.num_buffers = num_buffers;
+  opts.buf_capacity = capacity;
+  opts.seq_column = false;
+  return parse::ArrowParserContext::Make(opts, 1, out);
+}
+
+/// \brief Parse handed over buffers like a converter thread, until a number of JSONs.
+static auto Drain(parse::ParserContext* context, size_t num_jsons,
+                  std::vector<Handed>* out) -> Status {
+  auto parser = context->parsers()[0];
+  size_t drained = 0;
+  while (drained < num_jsons) {
+    illex::JSONBuffer* buffer = nullptr;
+    if (!context->ready_queue()->wait_dequeue_timed(buffer, std::chrono::seconds(5))) {
+      return Status(Error::GenericError, "Timed out waiting for a buffer.");
+    }
+    std::vector<parse::ParsedBatch> batches;
+    BOLSON_ROE(parser->Parse({buffer}, &batches));
+    for (const auto& batch : batches) {
+      out->push_back({batch.seq_range, batch.batch->num_rows()});
+      drained += batch.seq_range.last - batch.seq_range.first + 1;
+    }
+    buffer->Reset();
+    context->free_queue()->enqueue(buffer);
+  }
+  return Status::OK();
+}
+
+/// \brief Check that batches hold as many rows as their ranges, which cover [0, n).
+static void ExpectContiguous(const std::vector<Handed>& handed, uint64_t num_jsons) {
+  uint64_t next = 0;
+  for (const auto& h : handed) {
+    EXPECT_EQ(h.range.first, next);
+    EXPECT_EQ(static_cast<uint64_t>(h.rows), h.range.last - h.range.first + 1);
+    next = h.range.last + 1;
+  }
+  EXPECT_EQ(next, num_jsons);
+}
+
+/// \brief Test replaying a file with blank lines and an unterminated last line.
+TEST(CLIENT, FILE_BLANK_LINES) {
+  // Slices of 32 bytes: a JSON padded with spaces, only blank lines, JSONs with blank
+  // lines in between, and an unterminated JSON.
+  const std::string contents = "{\"id\": 0}\n" + std::string(21, ' ') + "\n" +
+                               std::string(30, ' ') + "\n\n" +
+                               "{\"id\": 1}\n\n{\"id\": 2}\r\n \t\n{\"id\": 3}";
+  const auto path = ::testing::TempDir() + "bolson_file_blank_lines.ndjson";
+  std::ofstream(path, std::ios::binary) << contents;
+
+  std::shared_ptr<parse::ParserContext> context;
+  FAIL_ON_ERROR(MakeContext(2, 32, &context));
+  std::shared_ptr<Client> client;
+  FAIL_ON_ERROR(FileClient::Make(path, parse::Handoff::QUEUE, context.get(), &client));
+
+  Status receive_status;
+  std::thread receiver([&]() { receive_status = client->ReceiveJSONs(); });
+  std::vector<Handed> handed;
+  auto drain_status = Drain(context.get(), 4, &handed);
+  receiver.join();
+  FAIL_ON_ERROR(drain_status);
+  FAIL_ON_ERROR(receive_status);
+  FAIL_ON_ERROR(client->Close());
+
+  ASSERT_EQ(client->jsons_received(), static_cast<size_t>(4));
+  ASSERT_EQ(client->bytes_received(), contents.size());
+  ExpectContiguous(handed, 4);
+}
+
+/// \brief Listen on a loopback port chosen by the kernel.
+static auto Listen(int* fd, uint16_t* port) -> Status {
+  *fd = socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_in addr{};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  socklen_t len = sizeof(addr);
+  if ((*fd < 0) || (bind(*fd, reinterpret_cast<sockaddr*>(&addr), len) != 0) ||
+      (listen(*fd, 1) != 0) ||
+      (getsockname(*fd, reinterpret_cast<sockaddr*>(&addr), &len) != 0)) {
+    return Status(Error::IOError, "Unable to listen on loopback.");
+  }
+  *port = ntohs(addr.sin_port);
+  return Status::OK();
+}
+
+/// \brief Test handing over partially filled buffers when their deadline passes.
+TEST(CLIENT, TCP_MAX_BUFFER_DELAY) {
+  // A single buffer, so the client must hand it over before taking the next one.
+  std::shared_ptr<parse::ParserContext> context;
+  FAIL_ON_ERROR(MakeContext(1, 1024, &context));
+
+  int listener = -1;
+  illex::ClientOptions opts;
+  opts.host = "127.0.0.1";
+  uint16_t port = 0;
+  FAIL_ON_ERROR(Listen(&listener, &port));
+  opts.port = port;
+  std::shared_ptr<Client> client;
+  FAIL_ON_ERROR(TcpClient::Make(opts, context.get(), &client, nullptr,
+                                std::chrono::microseconds(10000)));
+  int server = accept(listener, nullptr, nullptr);
+  close(listener);
+  ASSERT_GE(server, 0);
+
+  Status receive_status;
+  std::thread receiver([&]() { receive_status = client->ReceiveJSONs(); });
+
+  // The first JSON is handed over once its deadline passes, while the connection idles.
+  const std::string first = "{\"id\": 0}\n";
+  const std::string rest = "{\"id\": 1}\n{\"id\": 2}";
+  send(server, first.data(), first.size(), 0);
+  std::vector<Handed> handed;
+  auto drain_status = Drain(context.get(), 1, &handed);
+  const auto handed_first = handed;
+
+  // The last JSON is only complete once the connection is closed.
+  send(server, rest.data(), rest.size(), 0);
+  close(server);
+  if (drain_status.ok()) {
+    drain_status = Drain(context.get(), 2, &handed);
+  }
+  receiver.join();
+  FAIL_ON_ERROR(drain_status);
+  FAIL_ON_ERROR(receive_status);
+  FAIL_ON_ERROR(client->Close());
+
+  ASSERT_EQ(handed_first.size(), static_cast<size_t>(1));
+  ASSERT_EQ(handed_first[0].range.first, static_cast<uint64_t>(0));
+  ASSERT_EQ(handed_first[0].range.last, static_cast<uint64_t>(0));
+  ASSERT_EQ(client->jsons_received(), static_cast<size_t>(3));
+  ASSERT_EQ(client->bytes_received(), first.size() + rest.size());
+  ExpectContiguous(handed, 3);
+}
+
+}  // namespace bolson::client
@@ -0,0 +1,209 @@
+// Copyright 2020 Teratide B.V.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <arrow/util/compression.h>
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "bolson/client/decompress.h"
+#include "bolson/parse/pool.h"
+
+namespace bolson::client {
+
+#define FAIL_ON_ERROR(status)   \
+  {                             \
+    auto __status = (status);   \
+    if (!__status.ok()) {       \
+      FAIL() << __status.msg(); \
+    }                           \
+  }
+
+using Frames = std::vector<std::pair<size_t, size_t>>;
+
+/// \brief Generate newline-delimited JSONs.
+static auto GenerateNDJSON(size_t first, size_t num_jsons) -> std::string {
+  std::string result;
+  for (size_t i = first; i < first + num_jsons; i++) {
+    result += "{\"id\": " + std::to_string(i) + ", \"name\": \"json " +
+              std::to_string(i % 7) + "\", \"valid\": true}\n";
+  }
+  return result;
+}
+
+/// \brief Append a compressed frame holding some data.
+static void AppendFrame(Compression compression, const std::string& data,
+                        std::vector<std::byte>* out) {
+  auto type = compression == Compression::ZSTD ? arrow::Compression::ZSTD
+                                               : arrow::Compression::LZ4_FRAME;
+  auto codec = arrow::util::Codec::Create(type).ValueOrDie();
+  const auto* in = reinterpret_cast<const uint8_t*>(data.data());
+  const auto in_size = static_cast<int64_t>(data.size());
+  const auto offset = out->size();
+  out->resize(offset + codec->MaxCompressedLen(in_size, in));
+  auto size = codec
+                  ->Compress(in_size, in, static_cast<int64_t>(out->size() - offset),
+                             reinterpret_cast<uint8_t*>(out->data() + offset))
+                  .ValueOrDie();
+  out->resize(offset + size);
+}
+
+/// \brief Append a skippable frame with some payload.
+static void AppendSkippableFrame(size_t size, std::vector<std::byte>* out) {
+  const uint32_t header[] = {0x184D2A5Bu, static_cast<uint32_t>(size)};
+  const auto offset = out->size();
+  out->resize(offset + sizeof(header) + size, std::byte{0xAB});
+  std::memcpy(out->data() + offset, header, sizeof(header));
+}
+
+/// \brief Decompress a stream in pieces that fit an output of some capacity.
+static auto StreamDecompress(Compression compression, const std::vector<std::byte>& in,
+                             size_t out_capacity, std::string* out) -> Status {
+  std::unique_ptr<StreamDecompressor> decompressor;
+  BOLSON_ROE(StreamDecompressor::Make(compression, &decompressor));
+  std::vector<std::byte> output(out_capacity);
+  size_t offset = 0;
+  while ((offset < in.size()) || decompressor->has_output()) {
+    size_t consumed = 0;
+    size_t produced = 0;
+    BOLSON_ROE(decompressor->Decompress(in.data() + offset, in.size() - offset,
+                                        output.data(), output.size(), &consumed,
+                                        &produced));
+    if ((consumed == 0) && (produced == 0)) break;
+    offset += consumed;
+    out->append(reinterpret_cast<const char*>(output.data()), produced);
+  }
+  if ((offset != in.size()) || !decompressor->finished()) {
+    return Status(Error::IOError, "Stream ended in the middle of a frame.");
+  }
+  return Status::OK();
+}
+
+/// \brief Test finding and decompressing concatenated and skippable frames.
+TEST(DECOMPRESS, CONCATENATED_FRAMES) {
+  for (auto compression : {Compression::ZSTD, Compression::LZ4}) {
+    const std::vector<std::string> jsons = {GenerateNDJSON(0, 1000),
+                                            GenerateNDJSON(1000, 1),
+                                            GenerateNDJSON(1001, 10000)};
+    std::vector<std::byte> data;
+    AppendSkippableFrame(13, &data);
+    AppendFrame(compression, jsons[0], &data);
+    AppendFrame(compression, jsons[1], &data);
+    AppendSkippableFrame(0, &data);
+    AppendFrame(compression, jsons[2], &data);
+
+    Frames frames;
+    FAIL_ON_ERROR(FindFrames(compression, data.data(), data.size(), &frames));
+    ASSERT_EQ(frames.size(), static_cast<size_t>(5)) << ToString(compression);
+    ASSERT_EQ(frames[0], std::make_pair(static_cast<size_t>(0), static_cast<size_t>(21)));
+    ASSERT_EQ(frames[3].second, static_cast<size_t>(8));
+    for (size_t f = 1; f < frames.size(); f++) {
+      ASSERT_EQ(frames[f].first, frames[f - 1].first + frames[f - 1].second);
+    }
+    ASSERT_EQ(frames.back().first + frames.back().second, data.size());
+
+    const auto expected = jsons[0] + jsons[1] + jsons[2];
+    parse::TaskPool pool(2);
+    std::vector<std::byte> decompressed;
+    DecompressMetrics metrics;
+    FAIL_ON_ERROR(DecompressFrames(compression, data.data(), data.size(), &pool,
+                                   &decompressed, &metrics));
+    ASSERT_EQ(std::string(reinterpret_cast<const char*>(decompressed.data()),
+                          decompressed.size()),
+              expected)
+        << ToString(compression);
+    ASSERT_EQ(metrics.compressed_bytes, data.size());
+    ASSERT_EQ(metrics.decompressed_bytes, expected.size());
+
+    std::string streamed;
+    FAIL_ON_ERROR(StreamDecompress(compression, data, 64 * 1024, &streamed));
+    ASSERT_EQ(streamed, expected) << ToString(compression);
+  }
+}
+
+/// \brief Test that truncated frames are errors.
+TEST(DECOMPRESS, TRUNCATED_FRAME) {
+  for (auto compression : {Compression::ZSTD, Compression::LZ4}) {
+    std::vector<std::byte> data;
+    AppendFrame(compression, GenerateNDJSON(0, 1000), &data);
+    const auto frame_size = data.size();
+    AppendFrame(compression, GenerateNDJSON(1000, 1000), &data);
+
+    // Cut off the second frame in its blocks, in its header and just after its magic.
+    const std::vector<size_t> cuts = {data.size() - 1, frame_size + 9, frame_size + 4};
+    for (auto cut : cuts) {
+      Frames frames;
+      auto status = FindFrames(compression, data.data(), cut, &frames);
+      ASSERT_FALSE(status.ok()) << ToString(compression) << " cut at " << cut;
+
+      parse::TaskPool pool(0);
+      std::vector<std::byte> decompressed;
+      DecompressMetrics metrics;
+      status = DecompressFrames(compression, data.data(), cut, &pool, &decompressed,
+                                &metrics);
+      ASSERT_FALSE(status.ok()) << ToString(compression) << " cut at " << cut;
+
+      std::string streamed;
+      std::vector<std::byte> truncated(data.begin(), data.begin() + cut);
+      status = StreamDecompress(compression, truncated, 64 * 1024, &streamed);
+      ASSERT_FALSE(status.ok()) << ToString(compression) << " cut at " << cut;
+    }
+
+    // Cut off the skippable frame payload.
+    std::vector<std::byte> skippable;
+    AppendSkippableFrame(16, &skippable);
+    Frames frames;
+    auto status = FindFrames(compression, skippable.data(), 20, &frames);
+    ASSERT_FALSE(status.ok()) << ToString(compression);
+  }
+}
+
+/// \brief Test decompressing into an output smaller than a frame.
+TEST(DECOMPRESS, SMALL_OUTPUT) {
+  for (auto compression : {Compression::ZSTD, Compression::LZ4}) {
+    const auto first = GenerateNDJSON(0, 100);
+    const auto second = GenerateNDJSON(100, 100);
+    std::vector<std::byte> data;
+    AppendFrame(compression, first, &data);
+    AppendFrame(compression, second, &data);
+
+    // Output capacities that don't divide the frames, and one that ends on a frame.
+    const std::vector<size_t> capacities = {1, 7, 4096, first.size()};
+    for (auto capacity : capacities) {
+      std::string streamed;
+      FAIL_ON_ERROR(StreamDecompress(compression, data, capacity, &streamed));
+      ASSERT_EQ(streamed, first + second)
+          << ToString(compression) << " capacity " << capacity;
+    }
+
+    // Decompressed data that did not fit the output is pending until taken.
+    std::unique_ptr<StreamDecompressor> decompressor;
+    FAIL_ON_ERROR(StreamDecompressor::Make(compression, &decompressor));
+    std::vector<std::byte> output(16);
+    size_t consumed = 0;
+    size_t produced = 0;
+    FAIL_ON_ERROR(decompressor->Decompress(data.data(), data.size(), output.data(),
+                                           output.size(), &consumed, &produced));
+    ASSERT_EQ(produced, output.size());
+    ASSERT_TRUE(decompressor->has_output());
+    ASSERT_FALSE(decompressor->finished());
+    ASSERT_EQ(std::memcmp(output.data(), first.data(), output.size()), 0);
+  }
+}
+
+}  // namespace bolson::client
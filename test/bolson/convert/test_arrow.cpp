@@ -0,0 +1,328 @@
+// Copyright 2020 Teratide B.V.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <arrow/api.h>
+#include <arrow/compute/api.h>
+#include <arrow/io/api.h>
+#include <gtest/gtest.h>
+
+#include "bolson/bench.h"
+#include "bolson/convert/converter.h"
+#include "bolson/convert/test_convert.h"
+#include "bolson/parse/timestamp.h"
+
+namespace bolson::convert {
+
+static auto generate_schema() -> std::shared_ptr<arrow::Schema> {
+  static auto kvm = arrow::key_value_metadata({"illex_MIN", "illex_MAX"}, {"0", "2047"});
+  static auto result = arrow::schema(
+      {arrow::field("id", arrow::uint64(), false)->WithMetadata(kvm),
+       arrow::field("name", arrow::utf8(), false),
+       arrow::field("valid", arrow::boolean(), false),
+       arrow::field("values",
+                    arrow::list(arrow::field("item", arrow::uint64(), false)
+                                    ->WithMetadata(kvm)),
+                    false)});
+  return result;
+}
+
+/// \brief Test Arrow impl. vs. Arrow impl. parsing buffers in chunks.
+TEST(ARROW, ARROW_CHUNKED_VS_ARROW) {
+  const size_t num_threads = 4;                             // Number of threads.
+  const size_t num_jsons = 64 * 1024;                       // Number of JSONs to test.
+  const size_t max_ipc_size = 5 * 1024 * 1024 - 10 * 1024;  // Max IPC size.
+
+  // Generate a bunch of JSONs
+  std::vector<illex::JSONItem> jsons_in;
+  auto gen_result =
+      GenerateJSONs(num_jsons, *generate_schema(), illex::GenerateOptions(0), &jsons_in);
+
+  // Set chunked Arrow Converter options.
+  ConverterOptions chunked_opts;
+  chunked_opts.parser.impl = parse::Impl::ARROW;
+  chunked_opts.parser.arrow.schema = generate_schema();
+  chunked_opts.parser.arrow.buf_capacity = gen_result.second * num_jsons;
+  chunked_opts.parser.arrow.chunk_size = 64 * 1024;
+  chunked_opts.parser.arrow.chunk_threads = 2 * num_threads;
+  chunked_opts.num_threads = num_threads;
+  chunked_opts.max_batch_rows = 1024;
+  chunked_opts.max_ipc_size = max_ipc_size;
+
+  // Set Arrow Converter options, using the same options but without chunking.
+  ConverterOptions arrow_opts = chunked_opts;
+  arrow_opts.parser.arrow.chunk_size = 0;
+
+  // Run both implementations.
+  std::vector<publish::IpcQueueItem> arrow_out;
+  std::vector<publish::IpcQueueItem> chunked_out;
+  FAIL_ON_ERROR(Convert(arrow_opts, jsons_in, &arrow_out));
+  FAIL_ON_ERROR(Convert(chunked_opts, jsons_in, &chunked_out));
+
+  // Sort outputs by seq. no.
+  std::sort(arrow_out.begin(), arrow_out.end());
+  std::sort(chunked_out.begin(), chunked_out.end());
+
+  // Chunks result in different batch boundaries, so compare all rows at once.
+  auto schema = WithSeqColumn(generate_schema());
+  std::vector<std::shared_ptr<arrow::RecordBatch>> arrow_batches;
+  std::vector<std::shared_ptr<arrow::RecordBatch>> chunked_batches;
+  for (const auto& item : arrow_out) {
+    arrow_batches.push_back(GetRecordBatch(schema, item.message));
+  }
+  for (const auto& item : chunked_out) {
+    ASSERT_LE(item.message->size(), max_ipc_size);
+    chunked_batches.push_back(GetRecordBatch(schema, item.message));
+  }
+  auto arrow_table = arrow::Table::FromRecordBatches(schema, arrow_batches).ValueOrDie();
+  auto chunked_table =
+      arrow::Table::FromRecordBatches(schema, chunked_batches).ValueOrDie();
+  ASSERT_EQ(arrow_table->num_rows(), num_jsons);
+  ASSERT_TRUE(arrow_table->Equals(*chunked_table));
+}
+
+/// \brief Test Arrow impl. vs. Arrow impl. allocating from cached system memory pools.
+TEST(ARROW, ARROW_POOL_CACHE_VS_ARROW) {
+  const size_t num_threads = 4;                             // Number of threads.
+  const size_t num_jsons = 64 * 1024;                       // Number of JSONs to test.
+  const size_t max_ipc_size = 5 * 1024 * 1024 - 10 * 1024;  // Max IPC size.
+
+  // Generate a bunch of JSONs
+  std::vector<illex::JSONItem> jsons_in;
+  auto gen_result =
+      GenerateJSONs(num_jsons, *generate_schema(), illex::GenerateOptions(0), &jsons_in);
+
+  // Set Arrow Converter options, with a cache in every memory pool.
+  ConverterOptions cached_opts;
+  cached_opts.parser.impl = parse::Impl::ARROW;
+  cached_opts.parser.arrow.schema = generate_schema();
+  cached_opts.parser.arrow.buf_capacity = gen_result.second * num_jsons;
+  cached_opts.pool.backend = buffer::PoolBackend::SYSTEM;
+  cached_opts.pool.cache_entries = 16;
+  cached_opts.num_threads = num_threads;
+  cached_opts.max_batch_rows = 1024;
+  cached_opts.max_ipc_size = max_ipc_size;
+
+  // Set Arrow Converter options, using the same options but default memory pools.
+  ConverterOptions arrow_opts = cached_opts;
+  arrow_opts.pool = buffer::MemoryPoolOptions();
+
+  // Run both implementations.
+  std::vector<publish::IpcQueueItem> arrow_out;
+  std::vector<publish::IpcQueueItem> cached_out;
+  FAIL_ON_ERROR(Convert(arrow_opts, jsons_in, &arrow_out));
+  FAIL_ON_ERROR(Convert(cached_opts, jsons_in, &cached_out));
+
+  // Sort outputs by seq. no.
+  std::sort(arrow_out.begin(), arrow_out.end());
+  std::sort(cached_out.begin(), cached_out.end());
+
+  std::vector<std::shared_ptr<arrow::RecordBatch>> arrow_batches;
+  std::vector<std::shared_ptr<arrow::RecordBatch>> cached_batches;
+  DeserializeMessages(arrow_out, cached_out, WithSeqColumn(generate_schema()),
+                      max_ipc_size, &arrow_batches, &cached_batches);
+  CompareBatches(arrow_batches, cached_batches, num_jsons);
+}
+
+/// \brief Test Arrow impl. filtering records vs. filtering the output of Arrow impl.
+TEST(ARROW, ARROW_FILTER_VS_ARROW) {
+  const size_t num_threads = 4;                             // Number of threads.
+  const size_t num_jsons = 64 * 1024;                       // Number of JSONs to test.
+  const size_t max_ipc_size = 5 * 1024 * 1024 - 10 * 1024;  // Max IPC size.
+
+  // Generate a bunch of JSONs
+  std::vector<illex::JSONItem> jsons_in;
+  auto gen_result =
+      GenerateJSONs(num_jsons, *generate_schema(), illex::GenerateOptions(0), &jsons_in);
+
+  // Set Arrow Converter options, keeping only about half of the records.
+  ConverterOptions filter_opts;
+  filter_opts.parser.impl = parse::Impl::ARROW;
+  filter_opts.parser.arrow.schema = generate_schema();
+  filter_opts.parser.arrow.buf_capacity = gen_result.second * num_jsons;
+  filter_opts.filter = {"id >= 1024"};
+  filter_opts.num_threads = num_threads;
+  filter_opts.max_batch_rows = 1024;
+  filter_opts.max_ipc_size = max_ipc_size;
+
+  // Set Arrow Converter options, using the same options but without filter.
+  ConverterOptions arrow_opts = filter_opts;
+  arrow_opts.filter = {};
+
+  // Run both implementations. Conversion only completes if discarded records are still
+  // accounted for.
+  std::vector<publish::IpcQueueItem> arrow_out;
+  std::vector<publish::IpcQueueItem> filter_out;
+  FAIL_ON_ERROR(Convert(arrow_opts, jsons_in, &arrow_out));
+  FAIL_ON_ERROR(Convert(filter_opts, jsons_in, &filter_out));
+
+  // Sort outputs by seq. no.
+  std::sort(arrow_out.begin(), arrow_out.end());
+  std::sort(filter_out.begin(), filter_out.end());
+
+  // Filter the output of the unfiltered conversion, and compare all rows at once.
+  auto schema = WithSeqColumn(generate_schema());
+  std::vector<std::shared_ptr<arrow::RecordBatch>> arrow_batches;
+  std::vector<std::shared_ptr<arrow::RecordBatch>> filter_batches;
+  for (const auto& item : arrow_out) {
+    auto batch = GetRecordBatch(schema, item.message);
+    auto mask = arrow::compute::CallFunction(
+                    "greater_equal",
+                    {batch->GetColumnByName("id"), arrow::MakeScalar(uint64_t{1024})})
+                    .ValueOrDie();
+    arrow_batches.push_back(
+        arrow::compute::Filter(batch, mask).ValueOrDie().record_batch());
+  }
+  for (const auto& item : filter_out) {
+    if (item.message != nullptr) {
+      filter_batches.push_back(GetRecordBatch(schema, item.message));
+    }
+  }
+  auto arrow_table = arrow::Table::FromRecordBatches(schema, arrow_batches).ValueOrDie();
+  auto filter_table =
+      arrow::Table::FromRecordBatches(schema, filter_batches).ValueOrDie();
+  ASSERT_LT(filter_table->num_rows(), num_jsons);
+  ASSERT_TRUE(arrow_table->Equals(*filter_table));
+}
+
+/// \brief Test Arrow impl. dictionary-encoding a column vs. Arrow impl.
+TEST(ARROW, ARROW_DICTIONARY_VS_ARROW) {
+  const size_t num_threads = 4;                             // Number of threads.
+  const size_t num_jsons = 64 * 1024;                       // Number of JSONs to test.
+  const size_t max_ipc_size = 5 * 1024 * 1024 - 10 * 1024;  // Max IPC size.
+
+  // Generate a bunch of JSONs
+  std::vector<illex::JSONItem> jsons_in;
+  auto gen_result =
+      GenerateJSONs(num_jsons, *generate_schema(), illex::GenerateOptions(0), &jsons_in);
+
+  // Set Arrow Converter options, dictionary-encoding the "name" column.
+  auto dict_schema =
+      generate_schema()
+          ->SetField(1, arrow::field("name",
+                                     arrow::dictionary(arrow::int32(), arrow::utf8()),
+                                     false))
+          .ValueOrDie();
+  ConverterOptions dict_opts;
+  dict_opts.parser.impl = parse::Impl::ARROW;
+  dict_opts.parser.arrow.schema = dict_schema;
+  dict_opts.parser.arrow.buf_capacity = gen_result.second * num_jsons;
+  dict_opts.num_threads = num_threads;
+  dict_opts.max_batch_rows = 1024;
+  dict_opts.max_ipc_size = max_ipc_size;
+
+  // Set Arrow Converter options, using the same options but the plain schema.
+  ConverterOptions arrow_opts = dict_opts;
+  arrow_opts.parser.arrow.schema = generate_schema();
+
+  // Run both implementations.
+  std::vector<publish::IpcQueueItem> arrow_out;
+  std::vector<publish::IpcQueueItem> dict_out;
+  FAIL_ON_ERROR(Convert(arrow_opts, jsons_in, &arrow_out));
+  FAIL_ON_ERROR(Convert(dict_opts, jsons_in, &dict_out));
+
+  // Sort outputs by seq. no.
+  std::sort(arrow_out.begin(), arrow_out.end());
+  std::sort(dict_out.begin(), dict_out.end());
+  ASSERT_EQ(arrow_out.size(), dict_out.size());
+
+  // Every message must be decodable on its own, prefixed by the schema as a consumer
+  // would read it from the topic.
+  auto schema = WithSeqColumn(generate_schema());
+  auto stream_schema =
+      arrow::ipc::SerializeSchema(*WithSeqColumn(dict_schema)).ValueOrDie();
+  for (size_t i = 0; i < arrow_out.size(); i++) {
+    auto stream = arrow::ConcatenateBuffers({stream_schema, dict_out[i].message})
+                      .ValueOrDie();
+    auto reader = arrow::ipc::RecordBatchStreamReader::Open(
+                      std::make_shared<arrow::io::BufferReader>(stream))
+                      .ValueOrDie();
+    std::shared_ptr<arrow::RecordBatch> dict_batch;
+    ASSERT_TRUE(reader->ReadNext(&dict_batch).ok());
+    ASSERT_NE(dict_batch, nullptr);
+
+    // Decode the dictionary, and compare with the plain output.
+    auto arrow_batch = GetRecordBatch(schema, arrow_out[i].message);
+    auto names = std::static_pointer_cast<arrow::DictionaryArray>(
+        dict_batch->GetColumnByName("name"));
+    auto decoded = arrow::compute::Take(*names->dictionary(), *names->indices())
+                       .ValueOrDie();
+    ASSERT_EQ(arrow_batch->num_columns(), dict_batch->num_columns());
+    for (int c = 0; c < arrow_batch->num_columns(); c++) {
+      auto name = arrow_batch->schema()->field(c)->name();
+      auto column = name == "name" ? decoded : dict_batch->GetColumnByName(name);
+      ASSERT_TRUE(arrow_batch->column(c)->Equals(*column));
+    }
+  }
+}
+
+/// \brief Test ISO-8601 timestamp conversion by the Arrow, simdjson and RapidJSON impl.
+TEST(ARROW, ARROW_TIMESTAMPS) {
+  const size_t num_jsons = 4 * 1024;                        // Number of JSONs to test.
+  const size_t max_ipc_size = 5 * 1024 * 1024 - 10 * 1024;  // Max IPC size.
+
+  // Timestamps with and without fractions and UTC offsets, and their expected values.
+  const std::vector<std::pair<std::string, int64_t>> timestamps = {
+      {"1970-01-01T00:00:00Z", 0},
+      {"2005-09-09T11:59:06-10:01", 1126303206000000000},
+      {"2021-02-28 23:59:59.5+01:00", 1614553199500000000},
+      {"2000-02-29T12:00:00", 951825600000000000}};
+
+  std::vector<illex::JSONItem> jsons_in;
+  size_t json_bytes = 0;
+  for (size_t i = 0; i < num_jsons; i++) {
+    auto json = "{\"id\": " + std::to_string(i) + ", \"timestamp\": \"" +
+                timestamps[i % timestamps.size()].first + "\"}";
+    json_bytes += json.size() + 1;
+    jsons_in.push_back(illex::JSONItem{i, json});
+  }
+
+  auto schema = arrow::schema({arrow::field("id", arrow::uint64(), false),
+                               arrow::field("timestamp", arrow::utf8(), false)});
+  auto expected_schema = WithSeqColumn(
+      arrow::schema({arrow::field("id", arrow::uint64(), false),
+                     arrow::field("timestamp", parse::TimestampType(), false)}));
+
+  for (auto impl : {parse::Impl::ARROW, parse::Impl::SIMDJSON, parse::Impl::RAPIDJSON}) {
+    ConverterOptions opts;
+    opts.parser.impl = impl;
+    opts.parser.arrow.schema = schema;
+    opts.parser.arrow.buf_capacity = json_bytes;
+    opts.parser.arrow.timestamps = {"timestamp"};
+    opts.num_threads = 1;
+    opts.max_batch_rows = 1024;
+    opts.max_ipc_size = max_ipc_size;
+
+    std::vector<publish::IpcQueueItem> out;
+    FAIL_ON_ERROR(Convert(opts, jsons_in, &out));
+
+    size_t rows = 0;
+    for (const auto& item : out) {
+      auto batch = GetRecordBatch(expected_schema, item.message);
+      auto seq = std::static_pointer_cast<arrow::UInt64Array>(
+          batch->GetColumnByName("bolson_seq"));
+      auto ts = std::static_pointer_cast<arrow::TimestampArray>(
+          batch->GetColumnByName("timestamp"));
+      ASSERT_TRUE(ts->type()->Equals(parse::TimestampType()));
+      for (int64_t r = 0; r < batch->num_rows(); r++) {
+        ASSERT_EQ(ts->Value(r), timestamps[seq->Value(r) % timestamps.size()].second)
+            << parse::ToString(impl);
+      }
+      rows += batch->num_rows();
+    }
+    ASSERT_EQ(rows, num_jsons);
+  }
+}
+
+}  // namespace bolson::convert
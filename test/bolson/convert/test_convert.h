@@ -19,9 +19,13 @@
 #include <gtest/gtest.h>
 #include <illex/client_queueing.h>
 
+#include <algorithm>
 #include <memory>
+#include <string>
+#include <vector>
 
 #include "bolson/bench.h"
+#include "bolson/buffer/memory_pool.h"
 #include "bolson/convert/converter.h"
 #include "bolson/convert/test_convert.h"
 #include "bolson/log.h"
@@ -50,6 +54,14 @@ auto GetRecordBatch(const std::shared_ptr<arrow::Schema>& schema,
   return batch;
 }
 
+/// \brief Return the schema with the sequence number column prepended by parsers.
+auto WithSeqColumn(const std::shared_ptr<arrow::Schema>& schema)
+    -> std::shared_ptr<arrow::Schema> {
+  auto fields = schema->fields();
+  fields.insert(fields.begin(), arrow::field("bolson_seq", arrow::uint64(), false));
+  return arrow::schema(fields);
+}
+
 /**
  * \brief Convert a bunch of JSONs to Arrow IPC messages with given options.
  * \param opts  Converter options.
@@ -63,7 +75,11 @@ auto Convert(const ConverterOptions& opts, const std::vector<illex::JSONItem>& i
   publish::IpcQueue out_queue;
   std::shared_ptr<Converter> conv;
   BOLSON_ROE(Converter::Make(opts, &out_queue, &conv));
-  BOLSON_ROE(FillBuffers(conv->parser_context()->mutable_buffers(), in));
+  auto ctx = conv->parser_context();
+  const bool queued = conv->handoff() == parse::Handoff::QUEUE;
+  if (queued) ctx->ClaimBuffers();
+  BOLSON_ROE(FillBuffers(ctx->mutable_buffers(), in));
+  if (queued) ctx->PublishBuffers();
   std::atomic<bool> shutdown = false;
   conv->Start(&shutdown);
 
@@ -179,4 +195,111 @@ void CompareBatches(const std::vector<std::shared_ptr<arrow::RecordBatch>>& ref_
   ASSERT_EQ(uut_rows, expected_rows);
 }
 
+/**
+ * \brief Convert JSONs with the Arrow impl. and another impl., and compare the output.
+ * \param uut_opts  Converter options of the implementation under test. The Arrow impl. is
+ *                  run with the same options.
+ * \param jsons     JSON input.
+ * \param schema    The schema to which the output should comply.
+ */
+void CompareToArrow(const ConverterOptions& uut_opts,
+                    const std::vector<illex::JSONItem>& jsons,
+                    const std::shared_ptr<arrow::Schema>& schema) {
+  ConverterOptions arrow_opts = uut_opts;
+  arrow_opts.parser.impl = parse::Impl::ARROW;
+
+  // Run both implementations.
+  std::vector<publish::IpcQueueItem> arrow_out;
+  std::vector<publish::IpcQueueItem> uut_out;
+  FAIL_ON_ERROR(Convert(arrow_opts, jsons, &arrow_out));
+  FAIL_ON_ERROR(Convert(uut_opts, jsons, &uut_out));
+
+  // Sort outputs by seq. no.
+  std::sort(arrow_out.begin(), arrow_out.end());
+  std::sort(uut_out.begin(), uut_out.end());
+
+  std::vector<std::shared_ptr<arrow::RecordBatch>> arrow_batches;
+  std::vector<std::shared_ptr<arrow::RecordBatch>> uut_batches;
+  DeserializeMessages(arrow_out, uut_out, schema, uut_opts.max_ipc_size, &arrow_batches,
+                      &uut_batches);
+  CompareBatches(arrow_batches, uut_batches, jsons.size());
+}
+
+/**
+ * \brief Parse JSONs with a single parser of some parser context.
+ * \tparam Context The parser context, made from Arrow options.
+ * \param opts     The Arrow options. The buffer options are overridden.
+ * \param jsons    The JSONs to parse, without newlines.
+ * \param out      The parsed batches.
+ * \param pool     The memory pool the parser allocates from, or nullptr for its default.
+ * \return The status returned by the parser.
+ */
+template <typename Context>
+auto ParseJSONs(parse::ArrowOptions opts, const std::vector<std::string>& jsons,
+                std::vector<parse::ParsedBatch>* out, arrow::MemoryPool* pool = nullptr)
+    -> Status {
+  std::vector<illex::JSONItem> items;
+  size_t json_bytes = 0;
+  for (size_t i = 0; i < jsons.size(); i++) {
+    items.push_back(illex::JSONItem{i, jsons[i]});
+    json_bytes += jsons[i].size() + 1;
+  }
+  opts.num_buffers = 1;
+  opts.buf_capacity = json_bytes;
+
+  std::shared_ptr<parse::ParserContext> ctx;
+  BOLSON_ROE(Context::Make(opts, 1, &ctx));
+  auto buffers = ctx->mutable_buffers();
+  BOLSON_ROE(FillBuffers(buffers, items));
+  auto parser = ctx->parsers()[0];
+  if (pool != nullptr) {
+    BOLSON_ROE(parser->set_memory_pool(pool));
+  }
+  return parser->Parse(buffers, out);
+}
+
+/**
+ * \brief Check that a parser allocates its batches from the memory pool it is given.
+ * \tparam Context The parser context, made from Arrow options.
+ * \param opts     The Arrow options. The buffer options are overridden.
+ * \param jsons    Valid JSONs to parse, without newlines.
+ */
+template <typename Context>
+void ExpectParsedFromPool(const parse::ArrowOptions& opts,
+                          const std::vector<std::string>& jsons) {
+  buffer::ThreadMemoryPool* pool = nullptr;
+  FAIL_ON_ERROR(buffer::ThreadMemoryPool::Make(buffer::MemoryPoolOptions(), &pool));
+  std::vector<parse::ParsedBatch> expected;
+  std::vector<parse::ParsedBatch> pooled;
+  FAIL_ON_ERROR(ParseJSONs<Context>(opts, jsons, &expected));
+  FAIL_ON_ERROR(ParseJSONs<Context>(opts, jsons, &pooled, pool));
+
+  // The parser is gone, so whatever is still allocated belongs to the batches.
+  EXPECT_GT(pool->metrics().num_allocations, static_cast<uint64_t>(0));
+  EXPECT_GT(pool->bytes_allocated(), 0);
+  ASSERT_EQ(pooled.size(), expected.size());
+  for (size_t i = 0; i < pooled.size(); i++) {
+    ASSERT_TRUE(pooled[i].batch->Equals(*expected[i].batch));
+  }
+  pooled.clear();
+  EXPECT_EQ(pool->bytes_allocated(), 0);
+  buffer::ThreadMemoryPool::Release(pool);
+}
+
+/// \brief Schema to test the errors of parsers that take an explicit schema.
+auto ParseErrorSchema() -> std::shared_ptr<arrow::Schema> {
+  return arrow::schema({arrow::field("id", arrow::uint64(), false),
+                        arrow::field("level", arrow::uint8(), false),
+                        arrow::field("pos", arrow::fixed_size_list(arrow::int32(), 2))});
+}
+
+/// \brief Assert a status is an error with a message containing some text.
+#define ASSERT_ERROR_CONTAINS(status, text)                             \
+  {                                                                     \
+    auto __status = (status);                                           \
+    ASSERT_FALSE(__status.ok()) << "Expected error: " << (text);        \
+    ASSERT_NE(__status.msg().find(text), std::string::npos)             \
+        << "Expected error: " << (text) << ", got: " << __status.msg(); \
+  }
+
 }  // namespace bolson::convert
\ No newline at end of file
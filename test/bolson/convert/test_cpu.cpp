@@ -0,0 +1,166 @@
+// Copyright 2020 Teratide B.V.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <arrow/api.h>
+#include <arrow/io/api.h>
+#include <gtest/gtest.h>
+
+#include "bolson/bench.h"
+#include "bolson/convert/converter.h"
+#include "bolson/convert/test_convert.h"
+#include "bolson/parse/cpu/battery.h"
+#include "bolson/parse/cpu/trip.h"
+
+namespace bolson::convert {
+
+/// \brief Return the schema of a CPU parser, with generated values bounded.
+static auto bounded_schema(const arrow::Schema& schema)
+    -> std::shared_ptr<arrow::Schema> {
+  auto kvm = arrow::key_value_metadata({"illex_MIN", "illex_MAX"}, {"0", "2047"});
+  auto item = arrow::field("item", arrow::uint64(), false)->WithMetadata(kvm);
+  arrow::FieldVector fields;
+  for (const auto& field : schema.fields()) {
+    switch (field->type()->id()) {
+      case arrow::Type::UINT64:
+        fields.push_back(field->WithMetadata(kvm));
+        break;
+      case arrow::Type::LIST:
+        fields.push_back(arrow::field(field->name(), arrow::list(item), false)
+                             ->WithMetadata(arrow::key_value_metadata(
+                                 {"illex_MIN_LENGTH", "illex_MAX_LENGTH"}, {"1", "16"})));
+        break;
+      case arrow::Type::FIXED_SIZE_LIST: {
+        const auto& type = static_cast<const arrow::FixedSizeListType&>(*field->type());
+        auto size = type.list_size();
+        fields.push_back(
+            arrow::field(field->name(), arrow::fixed_size_list(item, size), false));
+        break;
+      }
+      default:
+        fields.push_back(field);
+    }
+  }
+  return arrow::schema(fields);
+}
+
+/// \brief Convert JSONs with the Arrow impl. and a CPU impl. and compare the results.
+static void CompareWithArrow(parse::Impl impl,
+                             const std::shared_ptr<arrow::Schema>& schema) {
+  const size_t num_threads = 4;                             // Number of threads.
+  const size_t num_jsons = 64 * 1024;                      // Number of JSONs to test.
+  const size_t max_ipc_size = 5 * 1024 * 1024 - 10 * 1024;  // Max IPC size.
+
+  // Generate a bunch of JSONs
+  std::vector<illex::JSONItem> jsons_in;
+  auto gen_result =
+      GenerateJSONs(num_jsons, *schema, illex::GenerateOptions(0), &jsons_in);
+
+  // Set CPU Converter options.
+  ConverterOptions cpu_opts;
+  cpu_opts.parser.impl = impl;
+  cpu_opts.parser.arrow.schema = schema;
+  cpu_opts.parser.arrow.buf_capacity = gen_result.second * num_jsons;
+  cpu_opts.num_threads = num_threads;
+  cpu_opts.max_batch_rows = 1024;
+  cpu_opts.max_ipc_size = max_ipc_size;
+
+  // Set Arrow Converter options, using the same options.
+  ConverterOptions arrow_opts = cpu_opts;
+  arrow_opts.parser.impl = parse::Impl::ARROW;
+
+  // Run both implementations.
+  std::vector<publish::IpcQueueItem> arrow_out;
+  std::vector<publish::IpcQueueItem> cpu_out;
+  FAIL_ON_ERROR(Convert(arrow_opts, jsons_in, &arrow_out));
+  FAIL_ON_ERROR(Convert(cpu_opts, jsons_in, &cpu_out));
+
+  // Sort outputs by seq. no.
+  std::sort(arrow_out.begin(), arrow_out.end());
+  std::sort(cpu_out.begin(), cpu_out.end());
+
+  std::vector<std::shared_ptr<arrow::RecordBatch>> arrow_batches;
+  std::vector<std::shared_ptr<arrow::RecordBatch>> cpu_batches;
+  DeserializeMessages(arrow_out, cpu_out, WithSeqColumn(schema), max_ipc_size,
+                      &arrow_batches, &cpu_batches);
+  CompareBatches(arrow_batches, cpu_batches, num_jsons);
+}
+
+/// \brief Test Arrow impl. vs. CPU impl. for battery status.
+TEST(CPU, CPU_BATTERY_VS_ARROW) {
+  CompareWithArrow(parse::Impl::CPU_BATTERY,
+                   bounded_schema(*parse::cpu::BatterySchema::input_schema()));
+}
+
+/// \brief Test Arrow impl. vs. CPU impl. for trip report.
+TEST(CPU, CPU_TRIP_VS_ARROW) {
+  CompareWithArrow(parse::Impl::CPU_TRIP,
+                   bounded_schema(*parse::cpu::TripSchema::input_schema()));
+}
+
+/// \brief Parse a buffer on which a CPU parser fails halfway, then a valid buffer.
+template <typename Context>
+static void ParseAfterError(const std::shared_ptr<arrow::Schema>& schema) {
+  std::vector<illex::JSONItem> jsons;
+  GenerateJSONs(4, *schema, illex::GenerateOptions(0), &jsons);
+  std::vector<std::string> strings;
+  for (const auto& json : jsons) {
+    strings.push_back(json.string);
+  }
+  // Cut off the second JSON halfway.
+  std::vector<illex::JSONItem> bad = {jsons[0], jsons[1], jsons[2]};
+  bad[1].string = bad[1].string.substr(0, bad[1].string.size() / 2);
+
+  parse::ArrowOptions opts;
+  opts.num_buffers = 1;
+  opts.buf_capacity = 64 * 1024;
+  std::shared_ptr<parse::ParserContext> ctx;
+  FAIL_ON_ERROR(Context::Make(opts, 1, &ctx));
+  auto parser = ctx->parsers()[0];
+  auto buffers = ctx->mutable_buffers();
+
+  std::vector<parse::ParsedBatch> batches;
+  FAIL_ON_ERROR(FillBuffers(buffers, bad));
+  ASSERT_FALSE(parser->Parse(buffers, &batches).ok());
+
+  // The same parser must not carry values over from the failed buffer.
+  batches.clear();
+  FAIL_ON_ERROR(FillBuffers(buffers, jsons));
+  FAIL_ON_ERROR(parser->Parse(buffers, &batches));
+  std::vector<parse::ParsedBatch> expected;
+  FAIL_ON_ERROR(ParseJSONs<Context>(opts, strings, &expected));
+  ASSERT_EQ(batches.size(), static_cast<size_t>(1));
+  ASSERT_EQ(expected.size(), static_cast<size_t>(1));
+  ASSERT_TRUE(batches[0].batch->Equals(*expected[0].batch));
+}
+
+/// \brief Test the CPU impl. for battery status after an error.
+TEST(CPU, CPU_BATTERY_AFTER_ERROR) {
+  ParseAfterError<parse::cpu::BatteryParserContext>(
+      bounded_schema(*parse::cpu::BatterySchema::input_schema()));
+}
+
+/// \brief Test the CPU impl. for trip report after an error.
+TEST(CPU, CPU_TRIP_AFTER_ERROR) {
+  ParseAfterError<parse::cpu::TripParserContext>(
+      bounded_schema(*parse::cpu::TripSchema::input_schema()));
+}
+
+/// \brief Test that the CPU impl. allocates its batches from its memory pool.
+TEST(CPU, CPU_BATTERY_MEMORY_POOL) {
+  ExpectParsedFromPool<parse::cpu::BatteryParserContext>(
+      parse::ArrowOptions(), {"{\"voltage\": [1, 2, 3]}", "{\"voltage\": [4]}"});
+}
+
+}  // namespace bolson::convert
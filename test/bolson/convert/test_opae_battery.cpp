@@ -42,8 +42,9 @@ auto generate_schema() -> std::shared_ptr<arrow::Schema> {
   return result;
 }
 
-/// \brief Test Arrow impl. vs. Opae FPGA impl. for battery status.
-TEST(OPAE, OPAE_BATTERY_8_KERNELS) {
+/// \brief Test Arrow impl. vs. Opae FPGA impl. for battery status on some platform.
+void TestBattery8Kernels(parse::opae::Platform platform,
+                         parse::WaitStrategy wait = parse::WaitStrategy::SLEEP) {
   // [FNC01]: The system performs the Convert JSON objects function, where JSON Objects
   //  are streamed into the system, aggregated in JSON Objects Messages, and converted to
   //  Pulsar Messages containing Arrow IPC messages containing Arrow RecordBatches.
@@ -60,6 +61,8 @@ TEST(OPAE, OPAE_BATTERY_8_KERNELS) {
   // Set OPAE Converter options.
   ConverterOptions opae_opts;
   opae_opts.parser.impl = parse::Impl::OPAE_BATTERY;
+  opae_opts.parser.opae_platform = platform;
+  opae_opts.parser.opae_wait.strategy = wait;
   opae_opts.num_threads = opae_battery_parsers_instances;
   opae_opts.max_batch_rows = 1024;
   opae_opts.max_ipc_size = max_ipc_size;
@@ -87,4 +90,16 @@ TEST(OPAE, OPAE_BATTERY_8_KERNELS) {
   CompareBatches(arrow_batches, opae_batches, num_jsons);
 }
 
+/// \brief Test Arrow impl. vs. Opae FPGA impl. for battery status.
+TEST(OPAE, OPAE_BATTERY_8_KERNELS) { TestBattery8Kernels(parse::opae::Platform::OPAE); }
+
+/// \brief Test Arrow impl. vs. Opae impl. for battery status, with emulated kernels.
+TEST(OPAE, EMU_BATTERY_8_KERNELS) { TestBattery8Kernels(parse::opae::Platform::EMU); }
+
+/// \brief Test Arrow impl. vs. Opae impl. for battery status, with emulated kernels that
+/// are waited on with exponential backoff.
+TEST(OPAE, EMU_BATTERY_8_KERNELS_BACKOFF) {
+  TestBattery8Kernels(parse::opae::Platform::EMU, parse::WaitStrategy::BACKOFF);
+}
+
 }  // namespace bolson::convert
@@ -198,8 +198,18 @@ void CompareTripBatches(
   ASSERT_EQ(uut_rows, expected_rows);
 }
 
-/// \brief Test Arrow impl. vs. Opae FPGA impl. for battery status.
-TEST(OPAE, OPAE_TRIP_3_KERNELS) {
+/// \brief Concatenate batches into a single batch.
+static auto Concatenate(const std::vector<std::shared_ptr<arrow::RecordBatch>>& batches)
+    -> std::shared_ptr<arrow::RecordBatch> {
+  auto table = arrow::Table::FromRecordBatches(batches).ValueOrDie();
+  arrow::TableBatchReader reader(*table->CombineChunks().ValueOrDie());
+  std::shared_ptr<arrow::RecordBatch> result;
+  EXPECT_TRUE(reader.ReadNext(&result).ok());
+  return result;
+}
+
+/// \brief Test Arrow impl. vs. Opae FPGA impl. for trip report on some platform.
+void TestTrip3Kernels(parse::opae::Platform platform, bool double_buffer = false) {
   StartLogger();
   const size_t opae_trip_instances = 3;
   const size_t num_jsons = 64 * 1024;
@@ -214,6 +224,8 @@ TEST(OPAE, OPAE_TRIP_3_KERNELS) {
   ConverterOptions opae_opts;
   opae_opts.parser.impl = parse::Impl::OPAE_TRIP;
   opae_opts.parser.trip.num_parsers = opae_trip_instances;
+  opae_opts.parser.opae_platform = platform;
+  opae_opts.parser.trip.double_buffer = double_buffer;
   opae_opts.max_batch_rows = num_jsons;
   opae_opts.max_ipc_size = max_ipc_size;
 
@@ -234,7 +246,72 @@ TEST(OPAE, OPAE_TRIP_3_KERNELS) {
   DeserializeMessages(arrow_out, opae_out, parse::opae::TripParser::output_schema(),
                       max_ipc_size, &arrow_batches, &opae_batches);
 
+  // Double buffering splits the input over multiple runs, and thus multiple batches.
+  if (double_buffer) {
+    arrow_batches = {Concatenate(arrow_batches)};
+    opae_batches = {Concatenate(opae_batches)};
+  }
+
   CompareTripBatches(arrow_batches, opae_batches, num_jsons);
 }
 
+/// \brief Test Arrow impl. vs. Opae FPGA impl. for trip report.
+TEST(OPAE, OPAE_TRIP_3_KERNELS) { TestTrip3Kernels(parse::opae::Platform::OPAE); }
+
+/// \brief Test Arrow impl. vs. Opae impl. for trip report, with emulated kernels.
+TEST(OPAE, EMU_TRIP_3_KERNELS) { TestTrip3Kernels(parse::opae::Platform::EMU); }
+
+/// \brief Test Arrow impl. vs. Opae impl. for trip report, with emulated kernels and
+/// double-buffered runs.
+TEST(OPAE, EMU_TRIP_3_KERNELS_DOUBLE_BUFFERED) {
+  TestTrip3Kernels(parse::opae::Platform::EMU, true);
+}
+
+/// \brief Test packing bytes into bitmaps vs. a scalar reference, around vector widths.
+TEST(OPAE, OPAE_TRIP_PACK_BYTES) {
+  for (int64_t length : {0, 1, 7, 8, 15, 16, 17, 31, 32, 33, 100}) {
+    // Mix zeros with values that have and don't have the sign bit set.
+    std::vector<uint8_t> bytes(length);
+    for (int64_t i = 0; i < length; i++) {
+      bytes[i] = (i * 7) % 3 == 0 ? 0 : static_cast<uint8_t>(i * 37 + 1);
+    }
+    const auto num_bytes = arrow::BitUtil::BytesForBits(length);
+    std::vector<uint8_t> expected(num_bytes, 0);
+    for (int64_t i = 0; i < length; i++) {
+      if (bytes[i] != 0) arrow::BitUtil::SetBit(expected.data(), i);
+    }
+
+    // Guard the bytes behind the bitmap, and clear the padding bits.
+    const uint8_t guard = 0xA5;
+    std::vector<uint8_t> bits(num_bytes + 8, guard);
+    parse::opae::PackBytes(bytes.data(), length, bits.data());
+    for (int64_t b = 0; b < num_bytes; b++) {
+      ASSERT_EQ(bits[b], expected[b]) << "length " << length << ", byte " << b;
+    }
+    for (size_t b = num_bytes; b < bits.size(); b++) {
+      ASSERT_EQ(bits[b], guard) << "length " << length << ", byte " << b;
+    }
+  }
+}
+
+/// \brief Test turning interleaved tags of multiple parser instances into seq. numbers.
+TEST(OPAE, OPAE_TRIP_TAGS_TO_SEQ) {
+  const std::vector<uint64_t> tags = {0, 1, 0, 2, 2, 1, 0, 2, 1, 1};
+  const std::vector<uint64_t> expected = {10, 20, 11, 30, 31, 21, 12, 32, 22, 23};
+  std::vector<uint64_t> seq_nos = {10, 20, 30, 40};
+
+  arrow::UInt64Builder builder;
+  ASSERT_TRUE(builder.AppendValues(tags).ok());
+  std::shared_ptr<arrow::Array> array;
+  ASSERT_TRUE(builder.Finish(&array).ok());
+  const auto& uint64_array = static_cast<const arrow::UInt64Array&>(*array);
+
+  parse::opae::ConvertTagsToSeq(uint64_array, &seq_nos);
+  for (size_t i = 0; i < tags.size(); i++) {
+    ASSERT_EQ(uint64_array.Value(i), expected[i]) << "row " << i;
+  }
+  // The next sequence number of every instance is advanced by its number of rows.
+  ASSERT_EQ(seq_nos, std::vector<uint64_t>({13, 24, 33, 40}));
+}
+
 }  // namespace bolson::convert
\ No newline at end of file
@@ -0,0 +1,165 @@
+// Copyright 2020 Teratide B.V.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <arrow/api.h>
+#include <gtest/gtest.h>
+
+#include "bolson/bench.h"
+#include "bolson/convert/converter.h"
+#include "bolson/convert/test_convert.h"
+#include "bolson/parse/rapidjson.h"
+
+namespace bolson::convert {
+
+static auto generate_schema() -> std::shared_ptr<arrow::Schema> {
+  static auto kvm = arrow::key_value_metadata({"illex_MIN", "illex_MAX"}, {"0", "2047"});
+  static auto result = arrow::schema(
+      {arrow::field("id", arrow::uint64(), false)->WithMetadata(kvm),
+       arrow::field("name", arrow::utf8(), false),
+       arrow::field("valid", arrow::boolean(), false),
+       arrow::field("values",
+                    arrow::list(arrow::field("item", arrow::uint64(), false)
+                                    ->WithMetadata(kvm)),
+                    false)});
+  return result;
+}
+
+/// \brief Test Arrow impl. vs. RapidJSON impl.
+TEST(RAPIDJSON, RAPIDJSON_VS_ARROW) {
+  const size_t num_jsons = 64 * 1024;  // Number of JSONs to test.
+
+  // Generate a bunch of JSONs
+  std::vector<illex::JSONItem> jsons_in;
+  auto gen_result =
+      GenerateJSONs(num_jsons, *generate_schema(), illex::GenerateOptions(0), &jsons_in);
+
+  ConverterOptions opts;
+  opts.parser.impl = parse::Impl::RAPIDJSON;
+  opts.parser.arrow.schema = generate_schema();
+  opts.parser.arrow.buf_capacity = gen_result.second * num_jsons;
+  opts.num_threads = 4;
+  opts.max_batch_rows = 1024;
+  opts.max_ipc_size = 5 * 1024 * 1024 - 10 * 1024;
+
+  CompareToArrow(opts, jsons_in, WithSeqColumn(generate_schema()));
+}
+
+/// \brief Test Arrow impl. vs. RapidJSON impl. parsing only some fields.
+TEST(RAPIDJSON, RAPIDJSON_PROJECTION_VS_ARROW) {
+  const size_t num_jsons = 64 * 1024;  // Number of JSONs to test.
+  const std::vector<std::string> columns = {"valid", "name"};
+
+  // Generate a bunch of JSONs
+  std::vector<illex::JSONItem> jsons_in;
+  auto gen_result =
+      GenerateJSONs(num_jsons, *generate_schema(), illex::GenerateOptions(0), &jsons_in);
+
+  // Skip the other fields.
+  ConverterOptions opts;
+  opts.parser.impl = parse::Impl::RAPIDJSON;
+  opts.parser.arrow.schema = generate_schema();
+  opts.parser.arrow.columns = columns;
+  opts.parser.arrow.buf_capacity = gen_result.second * num_jsons;
+  opts.num_threads = 4;
+  opts.max_batch_rows = 1024;
+  opts.max_ipc_size = 5 * 1024 * 1024 - 10 * 1024;
+
+  // Both outputs only hold the projected fields.
+  std::shared_ptr<arrow::Schema> projected;
+  FAIL_ON_ERROR(parse::ProjectSchema(generate_schema(), columns, &projected));
+  ASSERT_EQ(projected->num_fields(), static_cast<int>(columns.size()));
+
+  CompareToArrow(opts, jsons_in, WithSeqColumn(projected));
+}
+
+/// \brief Parse JSONs with a RapidJSON parser.
+static auto Parse(const std::vector<std::string>& jsons) -> Status {
+  parse::ArrowOptions opts;
+  opts.schema = ParseErrorSchema();
+  std::vector<parse::ParsedBatch> batches;
+  return ParseJSONs<parse::RapidJSONParserContext>(opts, jsons, &batches);
+}
+
+/// \brief Test that a missing non-nullable field is an error.
+TEST(RAPIDJSON, RAPIDJSON_MISSING_FIELD) {
+  auto status = Parse({"{\"id\": 0, \"level\": 1, \"pos\": [0, 1]}",
+                       "{\"id\": 1, \"pos\": [0, 1]}"});
+  ASSERT_ERROR_CONTAINS(status, "Non-nullable field \"level\" missing.");
+}
+
+/// \brief Test that a key appearing twice in an object is an error.
+TEST(RAPIDJSON, RAPIDJSON_DUPLICATE_KEY) {
+  auto status = Parse({"{\"id\": 0, \"level\": 1, \"pos\": [0, 1], \"level\": 2}"});
+  ASSERT_ERROR_CONTAINS(status, "Duplicate JSON field \"level\".");
+}
+
+/// \brief Test that integers not fitting the Arrow type are an error.
+TEST(RAPIDJSON, RAPIDJSON_OUT_OF_RANGE) {
+  auto status = Parse({"{\"id\": 0, \"level\": 255, \"pos\": [0, 1]}"});
+  FAIL_ON_ERROR(status);
+
+  status = Parse({"{\"id\": 0, \"level\": 256, \"pos\": [0, 1]}"});
+  ASSERT_ERROR_CONTAINS(status, "Value 256 of field \"level\" out of range.");
+
+  status = Parse({"{\"id\": 0, \"level\": -1, \"pos\": [0, 1]}"});
+  ASSERT_ERROR_CONTAINS(status, "Value -1 of field \"level\" out of range.");
+
+  status = Parse({"{\"id\": 0, \"level\": 1, \"pos\": [0, 2147483648]}"});
+  ASSERT_ERROR_CONTAINS(status, "Value 2147483648 of field \"item\" out of range.");
+}
+
+/// \brief Test that fixed-size lists of the wrong length are an error.
+TEST(RAPIDJSON, RAPIDJSON_FIXED_SIZE_LIST_LENGTH) {
+  auto status = Parse({"{\"id\": 0, \"level\": 1, \"pos\": [0]}"});
+  ASSERT_ERROR_CONTAINS(status, "Expected 2 list items, got 1.");
+
+  status = Parse({"{\"id\": 0, \"level\": 1, \"pos\": [0, 1, 2]}"});
+  ASSERT_ERROR_CONTAINS(status, "Expected 2 list items, got 3.");
+}
+
+/// \brief Test that unknown keys are an error, unless only some columns are parsed.
+TEST(RAPIDJSON, RAPIDJSON_UNKNOWN_KEY) {
+  const std::vector<std::string> jsons = {
+      "{\"id\": 0, \"level\": 1, \"pos\": [0, 1]}",
+      "{\"id\": 1, \"extra\": {\"a\": [1, {}]}, \"level\": 2, \"pos\": [0, 1]}"};
+
+  auto status = Parse(jsons);
+  ASSERT_ERROR_CONTAINS(status, "JSON field \"extra\" not in schema.");
+
+  parse::ArrowOptions opts;
+  opts.schema = ParseErrorSchema();
+  opts.columns = {"level", "id"};
+  std::vector<parse::ParsedBatch> batches;
+  FAIL_ON_ERROR(ParseJSONs<parse::RapidJSONParserContext>(opts, jsons, &batches));
+  ASSERT_EQ(batches.size(), static_cast<size_t>(1));
+  auto level = std::static_pointer_cast<arrow::UInt8Array>(
+      batches[0].batch->GetColumnByName("level"));
+  ASSERT_NE(level, nullptr);
+  ASSERT_EQ(level->length(), 2);
+  ASSERT_EQ(level->Value(0), 1);
+  ASSERT_EQ(level->Value(1), 2);
+  ASSERT_EQ(batches[0].batch->GetColumnByName("pos"), nullptr);
+}
+
+/// \brief Test that the parser allocates its batches from its memory pool.
+TEST(RAPIDJSON, RAPIDJSON_MEMORY_POOL) {
+  parse::ArrowOptions opts;
+  opts.schema = ParseErrorSchema();
+  ExpectParsedFromPool<parse::RapidJSONParserContext>(
+      opts, {"{\"id\": 0, \"level\": 1, \"pos\": [0, 1]}",
+             "{\"id\": 1, \"level\": 2, \"pos\": [2, 3]}"});
+}
+
+}  // namespace bolson::convert
@@ -0,0 +1,76 @@
+// Copyright 2020 Teratide B.V.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <arrow/api.h>
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "bolson/convert/resizer.h"
+#include "bolson/convert/test_convert.h"
+
+namespace bolson::convert {
+
+/// \brief Make a batch with a single uint64 column.
+static auto MakeBatch(const std::string& name, const std::vector<uint64_t>& values)
+    -> std::shared_ptr<arrow::RecordBatch> {
+  arrow::UInt64Builder builder;
+  EXPECT_TRUE(builder.AppendValues(values).ok());
+  std::shared_ptr<arrow::Array> column;
+  EXPECT_TRUE(builder.Finish(&column).ok());
+  auto schema = arrow::schema({arrow::field(name, arrow::uint64(), false)});
+  return arrow::RecordBatch::Make(schema, column->length(), {column});
+}
+
+/// \brief Test that slices of a filtered batch cover the sequence numbers of their rows.
+TEST(RESIZER, FILTERED_SEQ_RANGES) {
+  // A filter discarded sequence numbers 11, 12, 14 and 18-19 of range 10-19.
+  auto batch = MakeBatch("bolson_seq", {10, 13, 15, 16, 17});
+  Resizer resizer(2);
+  ResizedBatches resized;
+  FAIL_ON_ERROR(resizer.Resize(parse::ParsedBatch(batch, {10, 19}), &resized));
+
+  const std::vector<illex::SeqRange> expected = {{10, 14}, {15, 16}, {17, 19}};
+  ASSERT_EQ(resized.size(), expected.size());
+  for (size_t i = 0; i < expected.size(); i++) {
+    ASSERT_EQ(resized[i].seq_range.first, expected[i].first);
+    ASSERT_EQ(resized[i].seq_range.last, expected[i].last);
+    auto meta = resized[i].batch->schema()->metadata();
+    ASSERT_EQ(meta->Get("bolson_seq_first").ValueOrDie(),
+              std::to_string(expected[i].first));
+    ASSERT_EQ(meta->Get("bolson_seq_last").ValueOrDie(),
+              std::to_string(expected[i].last));
+  }
+}
+
+/// \brief Test that slices of a batch without sequence numbers partition its range.
+TEST(RESIZER, UNFILTERED_SEQ_RANGES) {
+  auto batch = MakeBatch("value", {0, 1, 2, 3, 4});
+  Resizer resizer(2);
+  ResizedBatches resized;
+  FAIL_ON_ERROR(resizer.Resize(parse::ParsedBatch(batch, {5, 9}), &resized));
+
+  const std::vector<illex::SeqRange> expected = {{5, 6}, {7, 8}, {9, 9}};
+  ASSERT_EQ(resized.size(), expected.size());
+  for (size_t i = 0; i < expected.size(); i++) {
+    ASSERT_EQ(resized[i].seq_range.first, expected[i].first);
+    ASSERT_EQ(resized[i].seq_range.last, expected[i].last);
+    ASSERT_EQ(resized[i].batch->num_rows(),
+              static_cast<int64_t>(expected[i].last - expected[i].first + 1));
+  }
+}
+
+}  // namespace bolson::convert